@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchsuite.h"
+#include "eval.h"
+#include "profile.h"
+#include "search.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * \brief Один замер: число операций и контрольная сумма их результатов.
+ *
+ * Контрольная сумма не дает компилятору выбросить работу и заодно
+ * показывает, что замер считал то же, что и раньше.
+ */
+struct Sample {
+    uint64_t operations = 0;
+    uint64_t checksum = 0;
+    double ns = 0; ///< Время, замеренное самим телом без подготовки (0 — время всего тела)
+};
+
+/**
+ * \brief Итог замера по всем повторам.
+ */
+struct BenchResult {
+    std::string name;
+    uint64_t operations = 0;
+    uint64_t checksum = 0;
+    double median = 0; ///< нс на операцию
+    double best = 0; ///< нс на операцию в самом быстром повторе
+};
+
+BenchResult measure(const std::string& name, int repeats, const std::function<Sample()>& body) {
+    BenchResult result;
+    result.name = name;
+    std::vector<double> times;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = Clock::now();
+        Sample sample = body();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (sample.ns > 0) ns = sample.ns;
+        times.push_back(ns / double(std::max<uint64_t>(sample.operations, 1)));
+        result.operations = sample.operations;
+        result.checksum = sample.checksum;
+    }
+    std::sort(times.begin(), times.end());
+    result.median = times[times.size() / 2];
+    result.best = times[0];
+    return result;
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results, uint64_t signature) {
+    out << "{\n  \"signature\": " << signature << ",\n  \"benchmarks\": {";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        out << (i ? "," : "") << "\n    \"" << result.name << "\": {\"operations\": " << result.operations
+            << ", \"checksum\": " << result.checksum << std::fixed << std::setprecision(2)
+            << ", \"nsPerOp\": " << result.median << ", \"bestNsPerOp\": " << result.best << std::defaultfloat << "}";
+    }
+    out << "\n  }\n}\n";
+}
+
+} // namespace
+
+/**
+ * \brief Микрозамеры горячих путей на постоянном наборе позиций.
+ *
+ * Каждый замер повторяется несколько раз и сообщает медиану и лучшее
+ * время на операцию: генерация ходов, ход и его отмена, проверки взятий,
+ * оценка (по одной и пачкой), perft и перебор в один поток с очищенной
+ * таблицей. Подпись — сумма узлов perft и перебора: она меняется, только
+ * если изменилось поведение генератора или перебора, а не скорость.
+ *
+ * С --json результаты пишутся в файл для сравнения между сборками. В
+ * сборке с CHECKERS_PROFILE после замеров печатаются счетчики profile.h.
+ *
+ * Использование: bench [-r повторов] [-p глубина perft] [-d глубина перебора] [--json файл]
+ */
+int main(int argc, char* argv[]) {
+    int repeats = 5;
+    int perftDepth = 6;
+    int searchDepth = 10;
+    std::string jsonPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-r" && hasValue) repeats = atoi(argv[++i]);
+        else if (arg == "-p" && hasValue) perftDepth = atoi(argv[++i]);
+        else if (arg == "-d" && hasValue) searchDepth = atoi(argv[++i]);
+        else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+        else {
+            std::cerr << "Usage: bench [-r repeats] [-p perft depth] [-d search depth] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+    if (repeats < 1 || perftDepth < 1 || searchDepth < 1) {
+        std::cerr << "Invalid arguments" << std::endl;
+        return 1;
+    }
+
+    std::vector<GameState> suite(BENCH_POSITION_COUNT);
+    for (size_t i = 0; i < BENCH_POSITION_COUNT; ++i) parseFen(BENCH_POSITIONS[i], suite[i]);
+    // Для пачки — позиции набора и случайные продолжения из них, всегда одни и те же
+    std::vector<GameState> batch;
+    for (size_t i = 0; batch.size() < 4096; ++i) {
+        GameState state = suite[i % suite.size()];
+        MoveList list;
+        for (size_t ply = 0; ply < 16; ++ply) {
+            generateMoves(state, list);
+            if (list.empty()) break;
+            makeMove(state, list[int((i * 31 + ply * 7) % size_t(list.size()))]);
+            batch.push_back(state);
+        }
+    }
+    batch.resize(4096);
+
+    profileReset();
+    std::vector<BenchResult> results;
+    results.push_back(measure("generateMoves", repeats, [&] {
+        Sample sample;
+        MoveList list;
+        for (int n = 0; n < 100000; ++n) {
+            for (const GameState& state : suite) {
+                generateMoves(state, list);
+                sample.checksum += uint64_t(list.size());
+                ++sample.operations;
+            }
+        }
+        return sample;
+    }));
+    results.push_back(measure("makeUnmake", repeats, [&] {
+        Sample sample;
+        MoveList list;
+        for (GameState state : suite) {
+            generateMoves(state, list);
+            for (int n = 0; n < 20000; ++n) {
+                for (const Move& move : list) {
+                    Undo undo;
+                    makeMove(state, move, undo);
+                    sample.checksum += state.hash & 0xFF;
+                    unmakeMove(state, undo);
+                    ++sample.operations;
+                }
+            }
+        }
+        return sample;
+    }));
+    results.push_back(measure("captureChecks", repeats, [&] {
+        // mustCapture, canCapture каждой фигуры и isValidMove каждого шага на соседнее поле; операция — один вызов
+        Sample sample;
+        for (int n = 0; n < 20000; ++n) {
+            for (const GameState& state : suite) {
+                sample.checksum += mustCapture(state);
+                ++sample.operations;
+                Bitboard pieces = state.board.white | state.board.black;
+                for (Bitboard rest = pieces; rest; rest &= rest - 1) {
+                    int s = lowestSquare(rest);
+                    int x = squareX(s), y = squareY(s);
+                    sample.checksum += canCapture(state, x, y);
+                    ++sample.operations;
+                    for (int dx = -1; dx <= 1; dx += 2) {
+                        for (int dy = -1; dy <= 1; dy += 2) {
+                            bool capture;
+                            if (isPlayableSquare(x + dx, y + dy)) {
+                                sample.checksum += isValidMove(state, x, y, x + dx, y + dy, capture);
+                                ++sample.operations;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return sample;
+    }));
+    results.push_back(measure("evaluate", repeats, [&] {
+        Sample sample;
+        for (int n = 0; n < 250; ++n) {
+            for (const GameState& state : batch) {
+                sample.checksum += uint64_t(evaluate(state));
+                ++sample.operations;
+            }
+        }
+        return sample;
+    }));
+    results.push_back(measure(std::string("evaluateBatch/") + evalKernelName(EVAL_BEST), repeats, [&] {
+        Sample sample;
+        std::vector<int> scores(batch.size());
+        for (int n = 0; n < 250; ++n) {
+            evaluateBatch(batch.data(), batch.size(), scores.data());
+            sample.checksum += uint64_t(scores[size_t(n) % scores.size()]);
+            sample.operations += batch.size();
+        }
+        return sample;
+    }));
+    results.push_back(measure("perft" + std::to_string(perftDepth), repeats, [&] {
+        Sample sample;
+        for (const GameState& state : suite) {
+            uint64_t nodes = perft(state, perftDepth);
+            sample.checksum += nodes;
+            sample.operations += nodes;
+        }
+        return sample;
+    }));
+    Searcher searcher;
+    searcher.setHashSize(16);
+    results.push_back(measure("search" + std::to_string(searchDepth), repeats, [&] {
+        Sample sample;
+        SearchLimits limits;
+        limits.depth = searchDepth;
+        for (const GameState& state : suite) {
+            // Очистка таблицы не входит во время перебора
+            searcher.clear();
+            auto start = Clock::now();
+            SearchResult result = searcher.search(state, limits);
+            sample.ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            sample.checksum += result.nodes;
+            sample.operations += result.nodes;
+        }
+        return sample;
+    }));
+
+    uint64_t signature = results[results.size() - 2].checksum + results.back().checksum;
+    std::cout << BENCH_POSITION_COUNT << " positions, " << repeats << " repeats" << std::endl;
+    std::cout << "benchmark               operations   ns/op median     ns/op best" << std::endl;
+    for (const BenchResult& result : results) {
+        std::cout << std::left << std::setw(20) << result.name << std::right << std::setw(14) << result.operations
+                  << std::fixed << std::setprecision(2) << std::setw(15) << result.median << std::setw(15)
+                  << result.best << std::defaultfloat << std::endl;
+    }
+    std::cout << "Signature: " << signature << std::endl;
+    if (profileEnabled()) {
+        std::cout << "Profile counters:" << std::endl;
+        writeProfileJson(std::cout, profileTotals());
+    }
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath, std::ios::trunc);
+        writeJson(out, results, signature);
+        if (!out) {
+            std::cerr << "Cannot write " << jsonPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+/**
+ * \file benchsuite.h
+ * \brief Постоянный набор позиций для замеров скорости (bench, smpbench).
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "notation.h"
+
+/// Начальная позиция, середины партий и эндшпиль с дамками
+const char* const BENCH_POSITIONS[] = {
+    START_FEN,
+    "B:W18,21,24,28,29,30,31,32:B1,2,3,4,7,8,12,13",
+    "B:W13,19,20,21,25,28,29,31,32:B1,2,4,6,8,9,10,11,14",
+    "B:W17,19,29,30,31,32:B1,2,3,4,8,9,12",
+    "B:W12,19,20,23,26,28,29,30,31:B2,3,4,7,10,11,14,18",
+    "B:W9,22,24,25,31:B1,4,5,8,13,16",
+    "B:W16,19,21,30,32:B1,4,8,10,11,12,13,18",
+    "B:WK1,19,22,23,27:B5,6,K14,16,K31",
+};
+
+const size_t BENCH_POSITION_COUNT = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
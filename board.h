@@ -0,0 +1,344 @@
+/**
+ * \file board.h
+ * \brief Битбордовое представление позиции для игры в шашки.
+ *
+ * Используются только 32 тёмных поля доски. Поле с координатами (x, y)
+ * имеет номер y * 4 + x / 2, поэтому вся позиция умещается в три 32-битные
+ * маски: белые шашки, чёрные шашки и дамки обоих цветов.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+const int size = 8; ///< Размер доски 8x8
+const int squareCount = 32; ///< Количество игровых (тёмных) полей
+
+/// Типы шашек на доске.
+enum Piece {
+    EMPTY, ///< Пустая клетка
+    BLACK, ///< Черная шашка
+    WHITE, ///< Белая шашка
+    BLACK_KING, ///< Черная шашка (дамка)
+    WHITE_KING ///< Белая шашка (дамка)
+};
+
+/// Очередность ходов.
+enum Turn {
+    BLACK_TURN, ///< Ход черных
+    WHITE_TURN ///< Ход белых
+};
+
+/// Набор полей: бит с номером s соответствует полю s.
+typedef uint32_t Bitboard;
+
+/// Направления по диагоналям (ось Y направлена вниз, черные ходят вниз).
+enum Direction {
+    UP_LEFT,
+    UP_RIGHT,
+    DOWN_LEFT,
+    DOWN_RIGHT
+};
+
+const Bitboard EVEN_ROWS = 0x0F0F0F0Fu; ///< Ряды 0, 2, 4, 6 (тёмные поля на нечётных x)
+const Bitboard ODD_ROWS = 0xF0F0F0F0u; ///< Ряды 1, 3, 5, 7 (тёмные поля на чётных x)
+const Bitboard FIRST_COLUMN = 0x11111111u; ///< Первое тёмное поле каждого ряда
+const Bitboard LAST_COLUMN = 0x88888888u; ///< Последнее тёмное поле каждого ряда
+const Bitboard TOP_ROW = 0x0000000Fu; ///< Ряд превращения белых
+const Bitboard BOTTOM_ROW = 0xF0000000u; ///< Ряд превращения черных
+
+/**
+ * \brief Позиция на доске: три маски вместо массива из 64 клеток.
+ */
+struct Position {
+    Bitboard white; ///< Белые шашки и дамки
+    Bitboard black; ///< Черные шашки и дамки
+    Bitboard kings; ///< Дамки обоих цветов
+};
+
+inline bool operator==(const Position& a, const Position& b) {
+    return a.white == b.white && a.black == b.black && a.kings == b.kings;
+}
+
+inline bool operator!=(const Position& a, const Position& b) {
+    return !(a == b);
+}
+
+/**
+ * \brief Проверяет, является ли клетка игровым полем доски.
+ */
+inline bool isPlayableSquare(int x, int y) {
+    return x >= 0 && x < size && y >= 0 && y < size && (x + y) % 2 == 1;
+}
+
+/**
+ * \brief Номер поля по координатам тёмной клетки.
+ */
+inline int squareIndex(int x, int y) {
+    return y * (size / 2) + x / 2;
+}
+
+/**
+ * \brief Координата X поля с номером s.
+ */
+inline int squareX(int s) {
+    return 2 * (s % (size / 2)) + ((s / (size / 2)) % 2 == 0 ? 1 : 0);
+}
+
+/**
+ * \brief Координата Y поля с номером s.
+ */
+inline int squareY(int s) {
+    return s / (size / 2);
+}
+
+/**
+ * \brief Маска клетки (x, y); для светлых клеток и клеток вне доски возвращает 0.
+ */
+inline Bitboard squareMask(int x, int y) {
+    return isPlayableSquare(x, y) ? Bitboard(1) << squareIndex(x, y) : 0;
+}
+
+/**
+ * \brief Количество установленных битов.
+ */
+inline int popCount(Bitboard b) {
+#if defined(__GNUC__)
+    return __builtin_popcount(b);
+#else
+    int n = 0;
+    for (; b; b &= b - 1) ++n;
+    return n;
+#endif
+}
+
+/**
+ * \brief Номер младшего установленного бита (b != 0).
+ */
+inline int lowestSquare(Bitboard b) {
+#if defined(__GNUC__)
+    return __builtin_ctz(b);
+#else
+    int s = 0;
+    while (!(b & 1)) {
+        b >>= 1;
+        ++s;
+    }
+    return s;
+#endif
+}
+
+/**
+ * \brief Сдвигает все поля набора на одну клетку по диагонали.
+ *
+ * Соседние поля отличаются по номеру на 3, 4 или 5 в зависимости от
+ * чётности ряда, поэтому сдвиг делается отдельно для чётных и нечётных
+ * рядов, а выходящие за край доски поля отсекаются масками.
+ */
+inline Bitboard shift(Bitboard b, Direction dir) {
+    switch (dir) {
+    case UP_LEFT:
+        return ((b & EVEN_ROWS) >> 4) | ((b & ODD_ROWS & ~FIRST_COLUMN) >> 5);
+    case UP_RIGHT:
+        return ((b & EVEN_ROWS & ~LAST_COLUMN) >> 3) | ((b & ODD_ROWS) >> 4);
+    case DOWN_LEFT:
+        return ((b & EVEN_ROWS) << 4) | ((b & ODD_ROWS & ~FIRST_COLUMN) << 3);
+    case DOWN_RIGHT:
+        return ((b & EVEN_ROWS & ~LAST_COLUMN) << 5) | ((b & ODD_ROWS) << 4);
+    }
+    return 0;
+}
+
+/**
+ * \brief Противоположное направление.
+ */
+inline Direction opposite(Direction dir) {
+    return Direction(3 - dir);
+}
+
+/**
+ * \brief Лучи по диагоналям: ray[d][s] — поля от s в направлении d до края доски (без s).
+ */
+struct RayTable {
+    Bitboard ray[4][squareCount];
+};
+
+constexpr RayTable makeRayTable() {
+    RayTable table{};
+    for (int s = 0; s < squareCount; ++s) {
+        int x = 2 * (s % 4) + ((s / 4) % 2 == 0 ? 1 : 0);
+        int y = s / 4;
+        // Порядок как в Direction: UP_LEFT, UP_RIGHT, DOWN_LEFT, DOWN_RIGHT
+        const int dx[4] = {-1, 1, -1, 1};
+        const int dy[4] = {-1, -1, 1, 1};
+        for (int d = 0; d < 4; ++d) {
+            for (int cx = x + dx[d], cy = y + dy[d]; cx >= 0 && cx < 8 && cy >= 0 && cy < 8; cx += dx[d], cy += dy[d]) {
+                table.ray[d][s] |= Bitboard(1) << (cy * 4 + cx / 2);
+            }
+        }
+    }
+    return table;
+}
+
+/// Лучи всех полей, построенные при компиляции.
+constexpr RayTable RAYS = makeRayTable();
+
+/**
+ * \brief Номер старшего установленного бита (b != 0).
+ */
+inline int highestSquare(Bitboard b) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(b);
+#else
+    int s = 31;
+    while (!(b >> s)) --s;
+    return s;
+#endif
+}
+
+/**
+ * \brief Первая фигура на луче от поля s в направлении dir или -1.
+ *
+ * Номера полей убывают вверх и растут вниз, поэтому ближайшее поле
+ * луча вверх — старший бит пересечения, вниз — младший.
+ */
+inline int firstBlocker(int s, Direction dir, Bitboard empty) {
+    Bitboard blockers = RAYS.ray[dir][s] & ~empty;
+    if (!blockers) return -1;
+    return dir == UP_LEFT || dir == UP_RIGHT ? highestSquare(blockers) : lowestSquare(blockers);
+}
+
+/**
+ * \brief Свободные поля луча от s в направлении dir до первой фигуры: ходы дамки.
+ */
+inline Bitboard slide(int s, Direction dir, Bitboard empty) {
+    int stop = firstBlocker(s, dir, empty);
+    Bitboard ray = RAYS.ray[dir][s];
+    return stop < 0 ? ray : ray & ~RAYS.ray[dir][stop] & empty;
+}
+
+/**
+ * \brief Направление по знакам смещения; смещение должно быть диагональным.
+ */
+inline Direction directionOf(int dx, int dy) {
+    if (dy < 0) return dx < 0 ? UP_LEFT : UP_RIGHT;
+    return dx < 0 ? DOWN_LEFT : DOWN_RIGHT;
+}
+
+/**
+ * \brief Шашки и дамки стороны side.
+ */
+inline Bitboard ownPieces(const Position& pos, Turn side) {
+    return side == WHITE_TURN ? pos.white : pos.black;
+}
+
+/**
+ * \brief Шашки и дамки соперника стороны side.
+ */
+inline Bitboard enemyPieces(const Position& pos, Turn side) {
+    return side == WHITE_TURN ? pos.black : pos.white;
+}
+
+/**
+ * \brief Свободные поля.
+ */
+inline Bitboard emptySquares(const Position& pos) {
+    return ~(pos.white | pos.black);
+}
+
+/**
+ * \brief Тип фигуры на клетке (x, y).
+ */
+inline Piece pieceAt(const Position& pos, int x, int y) {
+    Bitboard m = squareMask(x, y);
+    if (pos.white & m) return (pos.kings & m) ? WHITE_KING : WHITE;
+    if (pos.black & m) return (pos.kings & m) ? BLACK_KING : BLACK;
+    return EMPTY;
+}
+
+/**
+ * \brief Ставит фигуру на клетку (x, y), заменяя прежнее содержимое.
+ */
+inline void setPiece(Position& pos, int x, int y, Piece piece) {
+    Bitboard m = squareMask(x, y);
+    pos.white &= ~m;
+    pos.black &= ~m;
+    pos.kings &= ~m;
+    if (piece == WHITE || piece == WHITE_KING) pos.white |= m;
+    if (piece == BLACK || piece == BLACK_KING) pos.black |= m;
+    if (piece == WHITE_KING || piece == BLACK_KING) pos.kings |= m;
+}
+
+/**
+ * \brief Направления хода простой шашки стороны side.
+ */
+inline Bitboard forwardMoves(Bitboard men, Turn side) {
+    return side == WHITE_TURN ? shift(men, UP_LEFT) | shift(men, UP_RIGHT)
+                              : shift(men, DOWN_LEFT) | shift(men, DOWN_RIGHT);
+}
+
+/**
+ * \brief Фигуры стороны side, у которых есть тихий (не бьющий) ход.
+ */
+inline Bitboard movers(const Position& pos, Turn side) {
+    Bitboard own = ownPieces(pos, side);
+    Bitboard empty = emptySquares(pos);
+    Bitboard men = own & ~pos.kings;
+    Bitboard kings = own & pos.kings;
+    Bitboard result;
+    if (side == WHITE_TURN) {
+        result = men & (shift(empty, DOWN_RIGHT) | shift(empty, DOWN_LEFT));
+    }
+    else {
+        result = men & (shift(empty, UP_RIGHT) | shift(empty, UP_LEFT));
+    }
+    Bitboard any = shift(empty, UP_LEFT) | shift(empty, UP_RIGHT) | shift(empty, DOWN_LEFT) | shift(empty, DOWN_RIGHT);
+    return result | (kings & any);
+}
+
+/**
+ * \brief Может ли дамка на поле s бить: первая фигура на каком-то луче — фигура
+ * соперника, и за ней свободное поле.
+ */
+inline bool kingCanCapture(int s, Bitboard enemy, Bitboard empty) {
+    for (int d = 0; d < 4; ++d) {
+        Direction dir = Direction(d);
+        int victim = firstBlocker(s, dir, empty);
+        if (victim >= 0 && ((enemy >> victim) & 1) && (shift(Bitboard(1) << victim, dir) & empty)) return true;
+    }
+    return false;
+}
+
+/**
+ * \brief Фигуры из pieces, которые могут бить соседнюю фигуру соперника.
+ *
+ * Проверка выполняется сразу для всех фигур: от свободного поля за
+ * фигурой соперника делается шаг назад по диагонали.
+ */
+inline Bitboard adjacentJumpers(Bitboard pieces, Bitboard enemy, Bitboard empty) {
+    Bitboard result = 0;
+    for (int d = 0; d < 4; ++d) {
+        Direction back = opposite(Direction(d));
+        result |= shift(shift(empty, back) & enemy, back) & pieces;
+    }
+    return result;
+}
+
+/**
+ * \brief Фигуры стороны side, которые могут бить.
+ *
+ * Простые шашки бьют вперед и назад через соседнее поле: это проверяется
+ * сразу для всех шашек сдвигом масок. Дамки бьют на любом расстоянии:
+ * для каждой дамки первая фигура на луче берется из таблицы лучей.
+ */
+inline Bitboard jumpers(const Position& pos, Turn side) {
+    Bitboard own = ownPieces(pos, side);
+    Bitboard enemy = enemyPieces(pos, side);
+    Bitboard empty = emptySquares(pos);
+    Bitboard result = adjacentJumpers(own, enemy, empty);
+    for (Bitboard kings = own & pos.kings & ~result; kings; kings &= kings - 1) {
+        int s = lowestSquare(kings);
+        if (kingCanCapture(s, enemy, empty)) result |= Bitboard(1) << s;
+    }
+    return result;
+}
@@ -0,0 +1,199 @@
+#include "book.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const char BOOK_MAGIC[4] = {'C', 'K', 'B', 'K'};
+const uint32_t BOOK_VERSION = 1;
+const uint32_t BOOK_COUNT_LIMIT = 65535;
+
+/**
+ * \brief Заголовок файла книги; за ним следуют count записей BookEntry.
+ */
+struct BookHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entrySize;
+    uint64_t count;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(BookHeader) == 32, "the book header must stay 32 bytes");
+
+int resultIndex(GameResult result, Turn mover) {
+    if (result == RESULT_DRAW) return 1;
+    return (result == RESULT_WHITE_WINS) == (mover == WHITE_TURN) ? 0 : 2;
+}
+
+} // namespace
+
+BookBuilder::BookBuilder(int maxPlies) : merged(0), maxPlies(maxPlies) {}
+
+void BookBuilder::addGame(const Game& game) {
+    if (game.result == RESULT_UNKNOWN) return;
+    GameState state = game.start;
+    size_t plies = std::min(game.moves.size(), size_t(std::max(maxPlies, 0)));
+    for (size_t ply = 0; ply < plies; ++ply) {
+        const Move& move = game.moves[ply];
+        Record record{state.hash, move.from, move.to, {0, 0, 0}};
+        record.results[resultIndex(game.result, state.currentTurn)] = 1;
+        records.push_back(record);
+        makeMove(state, move);
+    }
+    // Слитое начало занимает не меньше половины массива
+    if (records.size() >= 2 * merged + (1u << 20)) merge();
+}
+
+void BookBuilder::merge() {
+    auto less = [](const Record& a, const Record& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.from != b.from ? a.from < b.from : a.to < b.to;
+    };
+    std::sort(records.begin() + std::ptrdiff_t(merged), records.end(), less);
+    std::inplace_merge(records.begin(), records.begin() + std::ptrdiff_t(merged), records.end(), less);
+    size_t out = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (out > 0 && !less(records[out - 1], records[i])) {
+            for (int r = 0; r < 3; ++r) records[out - 1].results[r] += records[i].results[r];
+        }
+        else {
+            records[out++] = records[i];
+        }
+    }
+    records.resize(out);
+    merged = out;
+}
+
+size_t BookBuilder::size() {
+    merge();
+    return records.size();
+}
+
+long BookBuilder::write(const std::string& path, uint32_t minGames) {
+    merge();
+    std::vector<BookEntry> table;
+    for (size_t first = 0, last; first < records.size(); first = last) {
+        // Ходы одной позиции: счетчики делятся на общий делитель, чтобы поместиться в 16 бит
+        uint32_t most = 0;
+        for (last = first; last < records.size() && records[last].hash == records[first].hash; ++last) {
+            for (uint32_t count : records[last].results) most = std::max(most, count);
+        }
+        uint32_t divisor = (most + BOOK_COUNT_LIMIT - 1) / BOOK_COUNT_LIMIT;
+        for (size_t i = first; i < last; ++i) {
+            const Record& record = records[i];
+            if (record.results[0] + record.results[1] + record.results[2] < minGames) continue;
+            table.push_back(BookEntry{record.hash, record.from, record.to, uint16_t(record.results[0] / divisor),
+                                      uint16_t(record.results[1] / divisor), uint16_t(record.results[2] / divisor)});
+        }
+    }
+
+    BookHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = BOOK_VERSION;
+    header.headerSize = sizeof(BookHeader);
+    header.entrySize = sizeof(BookEntry);
+    header.count = table.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), std::streamsize(table.size() * sizeof(BookEntry)));
+    return out ? long(table.size()) : -1;
+}
+
+OpeningBook::OpeningBook() : entries(nullptr), count(0) {}
+
+OpeningBook::~OpeningBook() = default;
+
+bool OpeningBook::load(const std::string& path) {
+    file.reset();
+    entries = nullptr;
+    count = 0;
+    std::unique_ptr<MappedFile> mapped(new MappedFile);
+    if (!mapped->open(path) || mapped->size() < sizeof(BookHeader)) return false;
+    BookHeader header;
+    std::memcpy(&header, mapped->data(), sizeof(header));
+    if (std::memcmp(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 || header.version != BOOK_VERSION ||
+        header.headerSize != sizeof(BookHeader) || header.entrySize != sizeof(BookEntry) ||
+        header.count > (mapped->size() - sizeof(BookHeader)) / sizeof(BookEntry) ||
+        mapped->size() != sizeof(BookHeader) + header.count * sizeof(BookEntry)) {
+        return false;
+    }
+    file = std::move(mapped);
+    entries = reinterpret_cast<const BookEntry*>(file->data() + sizeof(BookHeader));
+    count = size_t(header.count);
+    return true;
+}
+
+size_t OpeningBook::find(uint64_t hash, const BookEntry*& first) const {
+    // Первая запись с хешем не меньше искомого лежит в [low, high]
+    size_t low = 0, high = count;
+    for (int step = 0; step < 8 && high - low > 8; ++step) {
+        uint64_t lowHash = entries[low].hash;
+        uint64_t highHash = entries[high - 1].hash;
+        if (hash <= lowHash) {
+            high = low;
+            break;
+        }
+        if (hash > highHash) {
+            low = high;
+            break;
+        }
+        // Место хеша между крайними записями, в предположении равномерного распределения
+        double fraction = double(hash - lowHash) / double(highHash - lowHash);
+        size_t mid = low + std::min(size_t(fraction * double(high - 1 - low)), high - 1 - low);
+        if (entries[mid].hash < hash) low = mid + 1;
+        else high = mid;
+    }
+    const BookEntry* begin = std::lower_bound(entries + low, entries + high, hash,
+                                              [](const BookEntry& entry, uint64_t key) { return entry.hash < key; });
+    first = begin;
+    const BookEntry* end = begin;
+    while (end < entries + count && end->hash == hash) ++end;
+    return size_t(end - begin);
+}
+
+std::vector<BookMove> OpeningBook::probe(const GameState& state) const {
+    std::vector<BookMove> result;
+    const BookEntry* first;
+    size_t found = find(state.hash, first);
+    if (!found) return result;
+    MoveList list;
+    generateMoves(state, list);
+    for (size_t i = 0; i < found; ++i) {
+        const BookEntry& entry = first[i];
+        // Совпадение хеша еще не доказывает, что это та же позиция: ход должен быть допустим
+        for (int m = 0; m < list.size(); ++m) {
+            if (list[m].from != entry.from || list[m].to != entry.to) continue;
+            BookMove move;
+            move.move = list[m];
+            move.wins = entry.wins;
+            move.draws = entry.draws;
+            move.losses = entry.losses;
+            result.push_back(move);
+            break;
+        }
+    }
+    return result;
+}
+
+bool OpeningBook::choose(const GameState& state, Move& move, uint32_t minGames) const {
+    bool found = false;
+    double bestScore = 0;
+    uint32_t bestGames = 0;
+    for (const BookMove& candidate : probe(state)) {
+        uint32_t games = candidate.games();
+        if (games == 0 || games < minGames) continue;
+        double score = (candidate.wins + 0.5 * candidate.draws + 0.5) / (games + 1);
+        if (!found || score > bestScore || (score == bestScore && games > bestGames)) {
+            found = true;
+            bestScore = score;
+            bestGames = games;
+            move = candidate.move;
+        }
+    }
+    return found;
+}
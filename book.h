@@ -0,0 +1,165 @@
+/**
+ * \file book.h
+ * \brief Дебютная книга: статистика ходов по позициям из архивов партий.
+ *
+ * Файл книги — заголовок и таблица записей фиксированной длины, по записи
+ * на пару (позиция, ход), отсортированная по хешу позиции. OpeningBook
+ * отображает файл в память и ищет в нем интерполяционным поиском: хеши
+ * Зобриста распределены равномерно, так что до нужной записи — несколько
+ * обращений к памяти. Загрузки нет, и все процессы на машине делят
+ * страницы одного файла.
+ *
+ * Файлы строит bookgen с помощью BookBuilder.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gamerecord.h"
+#include "mappedfile.h"
+#include "movegen.h"
+
+/**
+ * \brief Запись книги: ход из позиции и результаты партий с ним.
+ *
+ * Ход задан начальным и конечным полями; взятия с одинаковыми началом
+ * и концом, но разным путем, считаются одним ходом. Результаты — с точки
+ * зрения стороны, сделавшей ход. Если в позиции больше 65535 партий,
+ * счетчики всех ее ходов уменьшаются в одно и то же число раз.
+ */
+struct BookEntry {
+    uint64_t hash; ///< Хеш Зобриста позиции и очереди хода
+    uint8_t from; ///< Начальное поле хода
+    uint8_t to; ///< Конечное поле хода
+    uint16_t wins; ///< Выигрыши
+    uint16_t draws; ///< Ничьи
+    uint16_t losses; ///< Проигрыши
+};
+
+static_assert(sizeof(BookEntry) == 16, "book entries are 16 bytes on disk");
+
+/**
+ * \brief Ход из книги с результатами.
+ */
+struct BookMove {
+    Move move;
+    uint32_t wins = 0;
+    uint32_t draws = 0;
+    uint32_t losses = 0;
+
+    uint32_t games() const { return wins + draws + losses; }
+};
+
+/**
+ * \brief Сборка книги из партий.
+ *
+ * Записи накапливаются в массиве и время от времени сортируются и
+ * сливаются, так что память растет с числом различных пар (позиция, ход),
+ * а не с числом партий.
+ */
+class BookBuilder {
+public:
+    /**
+     * \param maxPlies Сколько первых полуходов каждой партии попадает в книгу
+     */
+    explicit BookBuilder(int maxPlies = 20);
+
+    /**
+     * \brief Добавить ходы партии. Партии без результата пропускаются.
+     */
+    void addGame(const Game& game);
+
+    /**
+     * \brief Записать книгу.
+     * \param path Файл книги
+     * \param minGames Ходы, сыгранные меньше этого числа раз, не записываются
+     * \return Число записей или -1 при ошибке записи.
+     */
+    long write(const std::string& path, uint32_t minGames = 1);
+
+    /**
+     * \brief Число различных пар (позиция, ход) на данный момент.
+     */
+    size_t size();
+
+private:
+    struct Record {
+        uint64_t hash;
+        uint8_t from;
+        uint8_t to;
+        uint32_t results[3]; ///< Выигрыши, ничьи и проигрыши сделавшей ход стороны
+    };
+
+    void merge();
+
+    std::vector<Record> records;
+    size_t merged; ///< Длина отсортированного и слитого начала records
+    int maxPlies;
+};
+
+/**
+ * \brief Дебютная книга, отображенная в память.
+ *
+ * После load() объект только читается, поэтому probe() и choose() можно
+ * вызывать из любого числа потоков.
+ */
+class OpeningBook {
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    /**
+     * \brief Отобразить файл книги в память.
+     * \return false, если файл не открылся или не является книгой.
+     */
+    bool load(const std::string& path);
+
+    /**
+     * \brief Число записей.
+     */
+    size_t size() const { return count; }
+
+    /**
+     * \brief Записи книги, отсортированные по хешу.
+     */
+    const BookEntry* data() const { return entries; }
+
+    /**
+     * \brief Найти записи позиции интерполяционным поиском.
+     * \param hash Хеш позиции
+     * \param first Первая запись позиции
+     * \return Число записей позиции (0, если ее нет в книге).
+     */
+    size_t find(uint64_t hash, const BookEntry*& first) const;
+
+    /**
+     * \brief Допустимые ходы позиции, известные книге.
+     */
+    std::vector<BookMove> probe(const GameState& state) const;
+
+    /**
+     * \brief Выбрать ход из книги.
+     *
+     * Берется ход с лучшим средним результатом, к которому добавлена одна
+     * ничья: редкий ход с единственным выигрышем не перевешивает
+     * проверенный. При равенстве — более частый.
+     * \param state Позиция
+     * \param move Выбранный ход
+     * \param minGames Ходы, сыгранные меньше этого числа раз, не рассматриваются
+     * \return false, если позиции нет в книге.
+     */
+    bool choose(const GameState& state, Move& move, uint32_t minGames = 1) const;
+
+private:
+    std::unique_ptr<MappedFile> file;
+    const BookEntry* entries;
+    size_t count;
+};
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "book.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Сравнение записей книги с хешем для std::equal_range.
+struct HashLess {
+    bool operator()(const BookEntry& entry, uint64_t hash) const { return entry.hash < hash; }
+    bool operator()(uint64_t hash, const BookEntry& entry) const { return hash < entry.hash; }
+};
+
+/**
+ * \brief Время одного поиска в книге, нс: хеши записей в случайном порядке.
+ */
+template <typename Find>
+double probeTime(const std::vector<uint64_t>& hashes, Find find, size_t& found) {
+    auto start = Clock::now();
+    found = 0;
+    for (uint64_t hash : hashes) found += find(hash);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds * 1e9 / double(std::max<size_t>(hashes.size(), 1));
+}
+
+} // namespace
+
+/**
+ * \brief Построение дебютной книги из архивов партий.
+ *
+ * Первые полуходы каждой партии с известным результатом сводятся в
+ * таблицу (позиция, ход) -> выигрыши, ничьи, проигрыши, которая пишется
+ * отсортированной по хешу позиции. После записи книга отображается в
+ * память и сравнивается время интерполяционного и двоичного поиска.
+ *
+ * Использование: bookgen [-p полуходов] [-m наименьшее число партий] [-o файл книги] архив...
+ */
+int main(int argc, char* argv[]) {
+    int plies = 20;
+    uint32_t minGames = 2;
+    std::string output = "opening.book";
+    std::vector<std::string> archives;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-p" && hasValue) plies = atoi(argv[++i]);
+        else if (arg == "-m" && hasValue) minGames = uint32_t(std::max(1, atoi(argv[++i])));
+        else if (arg == "-o" && hasValue) output = argv[++i];
+        else if (!arg.empty() && arg[0] != '-') archives.push_back(arg);
+        else {
+            archives.clear();
+            break;
+        }
+    }
+    if (archives.empty() || plies < 1) {
+        std::cerr << "Usage: bookgen [-p plies] [-m min games] [-o book] archive..." << std::endl;
+        return 1;
+    }
+
+    auto start = Clock::now();
+    BookBuilder builder(plies);
+    long games = 0;
+    for (const std::string& path : archives) {
+        long added = readArchive(path, [&](const Game& game) {
+            builder.addGame(game);
+            return true;
+        }, std::cerr);
+        if (added < 0) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+        games += added;
+    }
+    size_t pairs = builder.size();
+    long entries = builder.write(output, minGames);
+    if (entries < 0) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << games << " games, " << pairs << " position-move pairs, " << entries << " entries with at least "
+              << minGames << " games in " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+
+    OpeningBook book;
+    if (!book.load(output)) {
+        std::cerr << "Cannot map " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Book: " << book.size() << " entries x " << sizeof(BookEntry) << " bytes = "
+              << double(book.size() * sizeof(BookEntry)) / 1024 << " KB" << std::endl;
+    if (book.size() == 0) return 0;
+
+    std::vector<uint64_t> hashes;
+    std::mt19937_64 random(1);
+    for (int i = 0; i < 1000000; ++i) hashes.push_back(book.data()[random() % book.size()].hash);
+    size_t foundInterpolation, foundBinary;
+    double interpolation = probeTime(hashes, [&](uint64_t hash) {
+        const BookEntry* first;
+        return book.find(hash, first);
+    }, foundInterpolation);
+    double binary = probeTime(hashes, [&](uint64_t hash) {
+        auto range = std::equal_range(book.data(), book.data() + book.size(), hash, HashLess());
+        return size_t(range.second - range.first);
+    }, foundBinary);
+    std::cout << "Probe: interpolation " << interpolation << " ns, binary " << binary << " ns"
+              << (foundInterpolation == foundBinary ? "" : " (MISMATCH)") << std::endl;
+    return foundInterpolation == foundBinary ? 0 : 1;
+}
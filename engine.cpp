@@ -0,0 +1,169 @@
+#include "engine.h"
+
+AsyncEngine::AsyncEngine()
+    : quit(false), pending(false), lastId(0), searching(false), pondering(false), ponderDone(false),
+      postPonderResult(false), currentId(0), cancelledId(0), hitId(0) {
+    searchCore.setInfoCallback([this](const SearchResult& result) { onInfo(result); });
+    thread = std::thread(&AsyncEngine::run, this);
+}
+
+AsyncEngine::~AsyncEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        cancelLocked();
+    }
+    wakeUp.notify_all();
+    thread.join();
+}
+
+uint64_t AsyncEngine::go(const GameState& state, const SearchLimits& limits) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelLocked();
+        SearchLimits searchLimits = limits;
+        searchLimits.ponder = false;
+        id = startLocked(state, searchLimits);
+    }
+    wakeUp.notify_all();
+    return id;
+}
+
+uint64_t AsyncEngine::ponder(const GameState& state, const Move& expected, const SearchLimits& limits) {
+    GameState after = state;
+    makeMove(after, expected);
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelLocked();
+        SearchLimits ponderLimits = limits;
+        ponderLimits.ponder = true;
+        pondering = true;
+        expectedMove = expected;
+        id = startLocked(after, ponderLimits);
+    }
+    wakeUp.notify_all();
+    return id;
+}
+
+uint64_t AsyncEngine::opponentMoved(const GameState& state, const Move& move, const SearchLimits& limits) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pondering && sameMove(move, expectedMove)) {
+            pondering = false;
+            if (ponderDone) {
+                // Обдумывание уже закончено: его итог и есть ответ
+                ponderDone = false;
+                postPonderResult = true;
+            }
+            else if (pending) {
+                nextLimits.ponder = false;
+            }
+            else {
+                // Поток мог еще не войти в search(), поэтому onInfo() повторяет ponderHit()
+                hitId = lastId;
+                searchCore.ponderHit();
+            }
+            uint64_t id = lastId;
+            wakeUp.notify_all();
+            return id;
+        }
+    }
+    return go(state, limits);
+}
+
+void AsyncEngine::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelLocked();
+}
+
+void AsyncEngine::cancelLocked() {
+    pending = false;
+    if (searching) {
+        cancelledId = currentId.load();
+        searchCore.stop();
+    }
+    pondering = false;
+    ponderDone = false;
+    postPonderResult = false;
+}
+
+uint64_t AsyncEngine::startLocked(const GameState& state, const SearchLimits& limits) {
+    nextState = state;
+    nextLimits = limits;
+    pending = true;
+    return ++lastId;
+}
+
+void AsyncEngine::onInfo(const SearchResult& result) {
+    uint64_t id = currentId;
+    // search() сбрасывает флаг остановки при старте, поэтому отмена и
+    // ponderHit(), пришедшие до начала перебора, повторяются здесь
+    if (cancelledId == id) {
+        searchCore.stop();
+        return;
+    }
+    if (hitId == id) searchCore.ponderHit();
+
+    EngineEvent event;
+    event.type = ENGINE_INFO;
+    event.searchId = id;
+    event.result = result;
+    events.push(event); // Отчеты при полной очереди отбрасываются
+}
+
+void AsyncEngine::post(const EngineEvent& event) {
+    // Итог перебора терять нельзя: ждем, пока интерфейс разберет очередь
+    while (!events.push(event)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (quit) return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void AsyncEngine::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeUp.wait(lock, [&] { return quit || pending || postPonderResult; });
+        if (quit) return;
+
+        EngineEvent event;
+        event.type = ENGINE_BEST_MOVE;
+        if (postPonderResult) {
+            postPonderResult = false;
+            event.searchId = currentId;
+            event.result = ponderResult;
+            lock.unlock();
+            post(event);
+            lock.lock();
+            continue;
+        }
+
+        pending = false;
+        GameState state = nextState;
+        SearchLimits limits = nextLimits;
+        uint64_t id = lastId;
+        currentId = id;
+        searching = true;
+        lock.unlock();
+
+        SearchResult result = searchCore.search(state, limits);
+
+        lock.lock();
+        searching = false;
+        if (cancelledId == id) continue;
+        if (pondering && currentId == lastId) {
+            ponderDone = true;
+            ponderResult = result;
+            continue;
+        }
+        event.searchId = id;
+        event.result = result;
+        lock.unlock();
+        post(event);
+        lock.lock();
+    }
+}
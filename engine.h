@@ -0,0 +1,170 @@
+/**
+ * \file engine.h
+ * \brief Перебор в фоновом потоке для графического клиента.
+ *
+ * Клиент отдает команды (начать перебор, обдумывать, отменить) и в каждом
+ * кадре забирает события из очереди без блокировок: промежуточные отчеты
+ * и лучший ход. Поток интерфейса никогда не ждет перебора.
+ *
+ * Обдумывание: после своего хода движок перебирает позицию после
+ * ожидаемого ответа соперника. Если соперник сыграл этот ход, перебор
+ * продолжается уже как обычный (а законченный заранее отдается сразу),
+ * иначе он отменяется и начинается перебор настоящей позиции.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "search.h"
+
+/**
+ * \brief Очередь фиксированной вместимости для одного писателя и одного читателя без блокировок.
+ * \tparam T Тип элемента
+ * \tparam Capacity Вместимость, степень двойки
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    /**
+     * \brief Добавить элемент (только поток писателя).
+     * \return false, если очередь полна.
+     */
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Забрать элемент (только поток читателя).
+     * \return false, если очередь пуста.
+     */
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head; ///< Следующий элемент для чтения
+    alignas(64) std::atomic<size_t> tail; ///< Следующее место для записи
+};
+
+/// Тип события движка.
+enum EngineEventType {
+    ENGINE_INFO, ///< Отчет о завершенной итерации
+    ENGINE_BEST_MOVE ///< Перебор закончен, result.bestMove — ход движка
+};
+
+/**
+ * \brief Событие движка для потока интерфейса.
+ */
+struct EngineEvent {
+    EngineEventType type = ENGINE_INFO;
+    uint64_t searchId = 0; ///< Номер перебора, который вернули go() или ponder()
+    SearchResult result; ///< Отчет или итог перебора
+};
+
+/**
+ * \brief Движок в отдельном потоке.
+ *
+ * Все методы, кроме searcher(), вызываются из одного потока интерфейса.
+ * События отмененных переборов в очередь не попадают, кроме отчетов,
+ * отправленных до отмены; их можно отличить по searchId.
+ */
+class AsyncEngine {
+public:
+    AsyncEngine();
+    ~AsyncEngine();
+
+    AsyncEngine(const AsyncEngine&) = delete;
+    AsyncEngine& operator=(const AsyncEngine&) = delete;
+
+    /**
+     * \brief Перебор для настройки (потоки, таблица, базы); только пока движок свободен.
+     */
+    Searcher& searcher() { return searchCore; }
+
+    /**
+     * \brief Начать перебор позиции, отменив текущий.
+     * \return Номер перебора.
+     */
+    uint64_t go(const GameState& state, const SearchLimits& limits);
+
+    /**
+     * \brief Обдумывать ответ на ожидаемый ход соперника, отменив текущий перебор.
+     * \param state Позиция с ходом соперника
+     * \param expected Ожидаемый ход соперника
+     * \param limits Ограничения для собственного хода; время отсчитывается от хода соперника
+     * \return Номер перебора.
+     */
+    uint64_t ponder(const GameState& state, const Move& expected, const SearchLimits& limits);
+
+    /**
+     * \brief Соперник сыграл ход; движок начинает отвечать.
+     *
+     * При совпадении с ожидаемым ходом обдумывание продолжается как
+     * обычный перебор с ограничениями из ponder(), иначе начинается новый.
+     * \param state Позиция после хода соперника
+     * \param move Сыгранный ход
+     * \param limits Ограничения для нового перебора
+     * \return Номер перебора, итог которого будет ходом движка.
+     */
+    uint64_t opponentMoved(const GameState& state, const Move& move, const SearchLimits& limits);
+
+    /**
+     * \brief Отменить текущий перебор или обдумывание; лучший ход не придет.
+     */
+    void cancel();
+
+    /**
+     * \brief Забрать следующее событие.
+     * \return false, если событий нет.
+     */
+    bool poll(EngineEvent& event) { return events.pop(event); }
+
+private:
+    void run();
+    void onInfo(const SearchResult& result);
+    void post(const EngineEvent& event);
+    void cancelLocked();
+    uint64_t startLocked(const GameState& state, const SearchLimits& limits);
+
+    Searcher searchCore;
+    SpscQueue<EngineEvent, 64> events;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+
+    // Под mutex
+    bool quit;
+    bool pending; ///< Есть перебор, еще не начатый потоком
+    GameState nextState;
+    SearchLimits nextLimits;
+    uint64_t lastId; ///< Последний выданный номер перебора (номер ожидающего, если pending)
+    bool searching; ///< Поток перебирает позицию currentId
+    bool pondering; ///< Текущий (или законченный) перебор — обдумывание без ponderHit()
+    Move expectedMove; ///< Ожидаемый ход соперника при обдумывании
+    bool ponderDone; ///< Обдумывание закончилось раньше хода соперника
+    bool postPonderResult; ///< Поток должен отправить сохраненный итог обдумывания
+    SearchResult ponderResult;
+
+    std::atomic<uint64_t> currentId; ///< Номер перебора, идущего в потоке
+    std::atomic<uint64_t> cancelledId; ///< Номер отмененного перебора
+    std::atomic<uint64_t> hitId; ///< Номер обдумывания, для которого соперник сыграл ожидаемый ход
+};
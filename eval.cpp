@@ -0,0 +1,370 @@
+#include "eval.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "profile.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EVAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Продвижение раскладывается по битам числа пройденных рядов: маска k
+// содержит ряды, где этот бит равен 1, и продвижение шашек равно
+// popcount(men & A0) + 2 * popcount(men & A1) + 4 * popcount(men & A2)
+const Bitboard WHITE_ADVANCE[3] = {0x0F0F0F0Fu, 0x00FF00FFu, 0x0000FFFFu}; ///< Белые: 7 - y
+const Bitboard BLACK_ADVANCE[3] = {0xF0F0F0F0u, 0xFF00FF00u, 0xFFFF0000u}; ///< Черные: y
+
+/**
+ * \brief Члены оценки одной стороны, кроме темпа, в порядке EVAL_TERMS.
+ * \param men Простые шашки
+ * \param kings Дамки
+ * \param empty Свободные поля
+ * \param side Цвет фигур
+ * \param terms Число шашек, дамок, пройденных рядов, стражей первого ряда и тихих ходов
+ */
+inline void sideTerms(Bitboard men, Bitboard kings, Bitboard empty, Turn side, int terms[EVAL_TERM_COUNT - 1]) {
+    const Bitboard* advance = side == WHITE_TURN ? WHITE_ADVANCE : BLACK_ADVANCE;
+    Bitboard home = side == WHITE_TURN ? BOTTOM_ROW : TOP_ROW;
+    terms[0] = popCount(men);
+    terms[1] = popCount(kings);
+    terms[2] = popCount(men & advance[0]) + 2 * popCount(men & advance[1]) + 4 * popCount(men & advance[2]);
+    terms[3] = popCount(men & home);
+
+    int mobility = side == WHITE_TURN ? popCount(shift(men, UP_LEFT) & empty) + popCount(shift(men, UP_RIGHT) & empty)
+                                      : popCount(shift(men, DOWN_LEFT) & empty) + popCount(shift(men, DOWN_RIGHT) & empty);
+    for (int d = 0; d < 4; ++d) {
+        mobility += popCount(shift(kings, Direction(d)) & empty);
+    }
+    terms[4] = mobility;
+}
+
+/**
+ * \brief Оценка фигур одной стороны.
+ * \param men Простые шашки
+ * \param kings Дамки
+ * \param empty Свободные поля
+ * \param side Цвет фигур
+ * \param w Веса
+ */
+int scoreSide(Bitboard men, Bitboard kings, Bitboard empty, Turn side, const EvalWeights& w) {
+    int terms[EVAL_TERM_COUNT - 1];
+    sideTerms(men, kings, empty, side, terms);
+    return terms[0] * w.man + terms[1] * w.king + terms[2] * w.advance + terms[3] * w.backRank + terms[4] * w.mobility;
+}
+
+void evaluateScalar(const GameState* states, size_t count, int* scores, const EvalWeights& weights) {
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] = evaluate(states[i], weights);
+    }
+}
+
+#ifdef EVAL_X86
+
+// Векторные ядра читают из GameState первые 16 байт: white, black, kings и очередь хода
+static_assert(offsetof(GameState, board) == 0 && offsetof(Position, black) == 4 && offsetof(Position, kings) == 8 &&
+                  offsetof(GameState, currentTurn) == 12 && sizeof(Turn) == 4,
+              "the vector kernels load the first 16 bytes of GameState as four 32-bit fields");
+
+#define SSE_TARGET __attribute__((target("ssse3,sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/**
+ * \brief Число единиц в каждой 32-битной полосе: таблица на полубайт и сложение байтов.
+ */
+SSE_TARGET inline __m128i popCount4(__m128i v) {
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, nibble));
+    __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i bytes = _mm_add_epi8(low, high);
+    return _mm_madd_epi16(_mm_maddubs_epi16(bytes, _mm_set1_epi8(1)), _mm_set1_epi16(1));
+}
+
+/**
+ * \brief shift() из board.h для четырех масок сразу.
+ */
+SSE_TARGET inline __m128i shift4(__m128i b, Direction dir) {
+    const __m128i even = _mm_set1_epi32(int(EVEN_ROWS));
+    const __m128i odd = _mm_set1_epi32(int(ODD_ROWS));
+    const __m128i oddNotFirst = _mm_set1_epi32(int(ODD_ROWS & ~FIRST_COLUMN));
+    const __m128i evenNotLast = _mm_set1_epi32(int(EVEN_ROWS & ~LAST_COLUMN));
+    switch (dir) {
+    case UP_LEFT:
+        return _mm_or_si128(_mm_srli_epi32(_mm_and_si128(b, even), 4), _mm_srli_epi32(_mm_and_si128(b, oddNotFirst), 5));
+    case UP_RIGHT:
+        return _mm_or_si128(_mm_srli_epi32(_mm_and_si128(b, evenNotLast), 3), _mm_srli_epi32(_mm_and_si128(b, odd), 4));
+    case DOWN_LEFT:
+        return _mm_or_si128(_mm_slli_epi32(_mm_and_si128(b, even), 4), _mm_slli_epi32(_mm_and_si128(b, oddNotFirst), 3));
+    case DOWN_RIGHT:
+        return _mm_or_si128(_mm_slli_epi32(_mm_and_si128(b, evenNotLast), 5), _mm_slli_epi32(_mm_and_si128(b, odd), 4));
+    }
+    return _mm_setzero_si128();
+}
+
+SSE_TARGET inline __m128i countMasked4(__m128i pieces, Bitboard mask) {
+    return popCount4(_mm_and_si128(pieces, _mm_set1_epi32(int(mask))));
+}
+
+SSE_TARGET __m128i scoreSide4(__m128i men, __m128i kings, __m128i empty, Turn side, const EvalWeights& w) {
+    const Bitboard* advance = side == WHITE_TURN ? WHITE_ADVANCE : BLACK_ADVANCE;
+    __m128i score = _mm_add_epi32(_mm_mullo_epi32(popCount4(men), _mm_set1_epi32(w.man)),
+                                  _mm_mullo_epi32(popCount4(kings), _mm_set1_epi32(w.king)));
+    __m128i advanced = _mm_add_epi32(countMasked4(men, advance[0]),
+                                     _mm_add_epi32(_mm_slli_epi32(countMasked4(men, advance[1]), 1),
+                                                   _mm_slli_epi32(countMasked4(men, advance[2]), 2)));
+    score = _mm_add_epi32(score, _mm_mullo_epi32(advanced, _mm_set1_epi32(w.advance)));
+    __m128i guards = countMasked4(men, side == WHITE_TURN ? BOTTOM_ROW : TOP_ROW);
+    score = _mm_add_epi32(score, _mm_mullo_epi32(guards, _mm_set1_epi32(w.backRank)));
+
+    Direction left = side == WHITE_TURN ? UP_LEFT : DOWN_LEFT;
+    Direction right = side == WHITE_TURN ? UP_RIGHT : DOWN_RIGHT;
+    __m128i mobility = _mm_add_epi32(popCount4(_mm_and_si128(shift4(men, left), empty)),
+                                     popCount4(_mm_and_si128(shift4(men, right), empty)));
+    for (int d = 0; d < 4; ++d) {
+        mobility = _mm_add_epi32(mobility, popCount4(_mm_and_si128(shift4(kings, Direction(d)), empty)));
+    }
+    return _mm_add_epi32(score, _mm_mullo_epi32(mobility, _mm_set1_epi32(w.mobility)));
+}
+
+SSE_TARGET void evaluateSse(const GameState* states, size_t count, int* scores, const EvalWeights& weights) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Четыре строки (white, black, kings, turn) транспонируются в четыре столбца
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&states[i]));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&states[i + 1]));
+        __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&states[i + 2]));
+        __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&states[i + 3]));
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        __m128i white = _mm_unpacklo_epi64(t0, t2);
+        __m128i black = _mm_unpackhi_epi64(t0, t2);
+        __m128i kings = _mm_unpacklo_epi64(t1, t3);
+        __m128i turn = _mm_unpackhi_epi64(t1, t3);
+
+        __m128i empty = _mm_xor_si128(_mm_or_si128(white, black), _mm_set1_epi32(-1));
+        __m128i diff = _mm_sub_epi32(
+            scoreSide4(_mm_andnot_si128(kings, white), _mm_and_si128(white, kings), empty, WHITE_TURN, weights),
+            scoreSide4(_mm_andnot_si128(kings, black), _mm_and_si128(black, kings), empty, BLACK_TURN, weights));
+        // Ход черных: -1 во всех битах полосы, и (diff ^ -1) - (-1) = -diff
+        __m128i blackToMove = _mm_cmpeq_epi32(turn, _mm_set1_epi32(BLACK_TURN));
+        __m128i score = _mm_sub_epi32(_mm_xor_si128(diff, blackToMove), blackToMove);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(scores + i), _mm_add_epi32(score, _mm_set1_epi32(weights.tempo)));
+    }
+    evaluateScalar(states + i, count - i, scores + i, weights);
+}
+
+AVX2_TARGET inline __m256i popCount8(__m256i v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                           2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+    __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    __m256i bytes = _mm256_add_epi8(low, high);
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+AVX2_TARGET inline __m256i shift8(__m256i b, Direction dir) {
+    const __m256i even = _mm256_set1_epi32(int(EVEN_ROWS));
+    const __m256i odd = _mm256_set1_epi32(int(ODD_ROWS));
+    const __m256i oddNotFirst = _mm256_set1_epi32(int(ODD_ROWS & ~FIRST_COLUMN));
+    const __m256i evenNotLast = _mm256_set1_epi32(int(EVEN_ROWS & ~LAST_COLUMN));
+    switch (dir) {
+    case UP_LEFT:
+        return _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(b, even), 4),
+                               _mm256_srli_epi32(_mm256_and_si256(b, oddNotFirst), 5));
+    case UP_RIGHT:
+        return _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(b, evenNotLast), 3),
+                               _mm256_srli_epi32(_mm256_and_si256(b, odd), 4));
+    case DOWN_LEFT:
+        return _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(b, even), 4),
+                               _mm256_slli_epi32(_mm256_and_si256(b, oddNotFirst), 3));
+    case DOWN_RIGHT:
+        return _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(b, evenNotLast), 5),
+                               _mm256_slli_epi32(_mm256_and_si256(b, odd), 4));
+    }
+    return _mm256_setzero_si256();
+}
+
+AVX2_TARGET inline __m256i countMasked8(__m256i pieces, Bitboard mask) {
+    return popCount8(_mm256_and_si256(pieces, _mm256_set1_epi32(int(mask))));
+}
+
+AVX2_TARGET __m256i scoreSide8(__m256i men, __m256i kings, __m256i empty, Turn side, const EvalWeights& w) {
+    const Bitboard* advance = side == WHITE_TURN ? WHITE_ADVANCE : BLACK_ADVANCE;
+    __m256i score = _mm256_add_epi32(_mm256_mullo_epi32(popCount8(men), _mm256_set1_epi32(w.man)),
+                                     _mm256_mullo_epi32(popCount8(kings), _mm256_set1_epi32(w.king)));
+    __m256i advanced = _mm256_add_epi32(countMasked8(men, advance[0]),
+                                        _mm256_add_epi32(_mm256_slli_epi32(countMasked8(men, advance[1]), 1),
+                                                         _mm256_slli_epi32(countMasked8(men, advance[2]), 2)));
+    score = _mm256_add_epi32(score, _mm256_mullo_epi32(advanced, _mm256_set1_epi32(w.advance)));
+    __m256i guards = countMasked8(men, side == WHITE_TURN ? BOTTOM_ROW : TOP_ROW);
+    score = _mm256_add_epi32(score, _mm256_mullo_epi32(guards, _mm256_set1_epi32(w.backRank)));
+
+    Direction left = side == WHITE_TURN ? UP_LEFT : DOWN_LEFT;
+    Direction right = side == WHITE_TURN ? UP_RIGHT : DOWN_RIGHT;
+    __m256i mobility = _mm256_add_epi32(popCount8(_mm256_and_si256(shift8(men, left), empty)),
+                                        popCount8(_mm256_and_si256(shift8(men, right), empty)));
+    for (int d = 0; d < 4; ++d) {
+        mobility = _mm256_add_epi32(mobility, popCount8(_mm256_and_si256(shift8(kings, Direction(d)), empty)));
+    }
+    return _mm256_add_epi32(score, _mm256_mullo_epi32(mobility, _mm256_set1_epi32(w.mobility)));
+}
+
+AVX2_TARGET inline __m256i loadPair(const GameState* low, const GameState* high) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low))),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(high)), 1);
+}
+
+AVX2_TARGET void evaluateAvx2(const GameState* states, size_t count, int* scores, const EvalWeights& weights) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Позиции i..i+3 попадают в младшие половины регистров, i+4..i+7 — в старшие,
+        // и транспонирование идет в каждой половине отдельно, как в ядре SSE
+        __m256i r0 = loadPair(&states[i], &states[i + 4]);
+        __m256i r1 = loadPair(&states[i + 1], &states[i + 5]);
+        __m256i r2 = loadPair(&states[i + 2], &states[i + 6]);
+        __m256i r3 = loadPair(&states[i + 3], &states[i + 7]);
+        __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+        __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+        __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+        __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+        __m256i white = _mm256_unpacklo_epi64(t0, t2);
+        __m256i black = _mm256_unpackhi_epi64(t0, t2);
+        __m256i kings = _mm256_unpacklo_epi64(t1, t3);
+        __m256i turn = _mm256_unpackhi_epi64(t1, t3);
+
+        __m256i empty = _mm256_xor_si256(_mm256_or_si256(white, black), _mm256_set1_epi32(-1));
+        __m256i diff = _mm256_sub_epi32(
+            scoreSide8(_mm256_andnot_si256(kings, white), _mm256_and_si256(white, kings), empty, WHITE_TURN, weights),
+            scoreSide8(_mm256_andnot_si256(kings, black), _mm256_and_si256(black, kings), empty, BLACK_TURN, weights));
+        __m256i blackToMove = _mm256_cmpeq_epi32(turn, _mm256_set1_epi32(BLACK_TURN));
+        __m256i score = _mm256_sub_epi32(_mm256_xor_si256(diff, blackToMove), blackToMove);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(scores + i),
+                            _mm256_add_epi32(score, _mm256_set1_epi32(weights.tempo)));
+    }
+    evaluateScalar(states + i, count - i, scores + i, weights);
+}
+
+#endif // EVAL_X86
+
+EvalKernel detectKernel() {
+#ifdef EVAL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return EVAL_AVX2;
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")) return EVAL_SSE;
+#endif
+    return EVAL_SCALAR;
+}
+
+} // namespace
+
+int evaluate(const GameState& state, const EvalWeights& weights) {
+    PROFILE_COUNT(PROFILE_EVALUATE);
+    const Position& board = state.board;
+    Bitboard empty = emptySquares(board);
+    int white = scoreSide(board.white & ~board.kings, board.white & board.kings, empty, WHITE_TURN, weights);
+    int black = scoreSide(board.black & ~board.kings, board.black & board.kings, empty, BLACK_TURN, weights);
+    return (state.currentTurn == WHITE_TURN ? white - black : black - white) + weights.tempo;
+}
+
+int evaluate(const GameState& state) {
+    static const EvalWeights defaults;
+    return evaluate(state, defaults);
+}
+
+const EvalTerm EVAL_TERMS[EVAL_TERM_COUNT] = {
+    {"man", &EvalWeights::man},           {"king", &EvalWeights::king},         {"advance", &EvalWeights::advance},
+    {"backRank", &EvalWeights::backRank}, {"mobility", &EvalWeights::mobility}, {"tempo", &EvalWeights::tempo},
+};
+
+EvalFeatures evalFeatures(const GameState& state) {
+    const Position& board = state.board;
+    Bitboard empty = emptySquares(board);
+    int white[EVAL_TERM_COUNT - 1], black[EVAL_TERM_COUNT - 1];
+    sideTerms(board.white & ~board.kings, board.white & board.kings, empty, WHITE_TURN, white);
+    sideTerms(board.black & ~board.kings, board.black & board.kings, empty, BLACK_TURN, black);
+    EvalFeatures features;
+    for (int i = 0; i < EVAL_TERM_COUNT - 1; ++i) {
+        features.value[i] = int8_t(white[i] - black[i]);
+    }
+    features.value[EVAL_TERM_COUNT - 1] = state.currentTurn == WHITE_TURN ? 1 : -1;
+    return features;
+}
+
+bool readEvalWeights(std::istream& in, EvalWeights& weights) {
+    EvalWeights result = weights;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+        size_t end = line.find_first_of(" \t", start);
+        if (end == std::string::npos) return false;
+        std::string name = line.substr(start, end - start);
+        const EvalTerm* term = nullptr;
+        for (const EvalTerm& candidate : EVAL_TERMS) {
+            if (name == candidate.name) term = &candidate;
+        }
+        char* rest;
+        long value = strtol(line.c_str() + end, &rest, 10);
+        if (!term || rest == line.c_str() + end || rest[strspn(rest, " \t\r")] != '\0') return false;
+        result.*term->weight = int(value);
+    }
+    weights = result;
+    return true;
+}
+
+void writeEvalWeights(std::ostream& out, const EvalWeights& weights) {
+    for (const EvalTerm& term : EVAL_TERMS) {
+        out << term.name << ' ' << weights.*term.weight << '\n';
+    }
+}
+
+EvalKernel bestEvalKernel() {
+    static const EvalKernel best = detectKernel();
+    return best;
+}
+
+bool evalKernelSupported(EvalKernel kernel) {
+    return kernel == EVAL_SCALAR || kernel == EVAL_BEST || kernel <= bestEvalKernel();
+}
+
+const char* evalKernelName(EvalKernel kernel) {
+    if (kernel == EVAL_BEST) kernel = bestEvalKernel();
+    switch (kernel) {
+    case EVAL_SSE:
+        return "sse";
+    case EVAL_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+void evaluateBatch(const GameState* states, size_t count, int* scores, const EvalWeights& weights, EvalKernel kernel) {
+    PROFILE_SCOPE(PROFILE_EVALUATE_BATCH);
+    if (kernel == EVAL_BEST) kernel = bestEvalKernel();
+    if (!evalKernelSupported(kernel)) kernel = EVAL_SCALAR;
+    switch (kernel) {
+#ifdef EVAL_X86
+    case EVAL_AVX2:
+        evaluateAvx2(states, count, scores, weights);
+        return;
+    case EVAL_SSE:
+        evaluateSse(states, count, scores, weights);
+        return;
+#endif
+    default:
+        evaluateScalar(states, count, scores, weights);
+        return;
+    }
+}
@@ -0,0 +1,120 @@
+/**
+ * \file eval.h
+ * \brief Статическая оценка позиции, по одной и пачками.
+ *
+ * Все члены оценки — число фигур в масках, умноженное на вес: материал,
+ * продвижение простых шашек, охрана первого ряда, подвижность и темп.
+ * Поэтому одну и ту же оценку можно считать сразу для нескольких позиций
+ * векторными командами (popcount по 32-битным полосам), и пачка дает в
+ * точности те же числа, что evaluate().
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+
+#include "rules.h"
+
+const int MAN_VALUE = 100; ///< Стоимость простой шашки
+const int KING_VALUE = 300; ///< Стоимость дамки
+
+/**
+ * \brief Веса членов оценки.
+ */
+struct EvalWeights {
+    int man = MAN_VALUE; ///< Простая шашка
+    int king = KING_VALUE; ///< Дамка
+    int advance = 4; ///< Каждый пройденный простой шашкой ряд
+    int backRank = 10; ///< Шашка, стерегущая свой первый ряд
+    int mobility = 2; ///< Каждый тихий ход на соседнее поле
+    int tempo = 5; ///< Бонус стороне, имеющей очередь хода
+};
+
+/**
+ * \brief Оценить позицию с точки зрения стороны, имеющей очередь хода.
+ * \param state Состояние партии
+ * \param weights Веса оценки
+ * \return Оценка в сотых долях шашки: положительная, если позиция лучше у ходящей стороны.
+ */
+int evaluate(const GameState& state, const EvalWeights& weights);
+
+/**
+ * \brief Оценить позицию с весами по умолчанию.
+ */
+int evaluate(const GameState& state);
+
+/**
+ * \brief Член оценки: имя в файле весов и поле в EvalWeights.
+ */
+struct EvalTerm {
+    const char* name;
+    int EvalWeights::*weight;
+};
+
+const int EVAL_TERM_COUNT = 6; ///< Число членов оценки
+extern const EvalTerm EVAL_TERMS[EVAL_TERM_COUNT]; ///< man, king, advance, backRank, mobility, tempo
+
+/**
+ * \brief Значения членов оценки позиции в порядке EVAL_TERMS.
+ *
+ * Каждое значение — разность белых и черных (темп: +1 при ходе белых,
+ * -1 при ходе черных), так что сумма value[i] * вес[i] — оценка
+ * с точки зрения белых. По модулю все значения меньше 128.
+ */
+struct EvalFeatures {
+    int8_t value[EVAL_TERM_COUNT];
+};
+
+/**
+ * \brief Значения членов оценки: evaluate() равна их сумме с весами, взятой со знаком ходящей стороны.
+ */
+EvalFeatures evalFeatures(const GameState& state);
+
+/**
+ * \brief Прочитать веса из текста вида "имя значение" по строке на член.
+ *
+ * Пустые строки и строки, начинающиеся с '#', пропускаются; не названные
+ * в тексте члены сохраняют прежние значения.
+ * \return false при неизвестном имени или нечисловом значении.
+ */
+bool readEvalWeights(std::istream& in, EvalWeights& weights);
+
+/**
+ * \brief Записать все веса в формате readEvalWeights().
+ */
+void writeEvalWeights(std::ostream& out, const EvalWeights& weights);
+
+/// Реализация оценки пачки.
+enum EvalKernel {
+    EVAL_SCALAR, ///< По одной позиции, без векторных команд
+    EVAL_SSE, ///< По 4 позиции (SSSE3 и SSE4.1)
+    EVAL_AVX2, ///< По 8 позиций
+    EVAL_BEST ///< Лучшая из поддерживаемых процессором
+};
+
+/**
+ * \brief Поддерживает ли процессор эту реализацию.
+ */
+bool evalKernelSupported(EvalKernel kernel);
+
+/**
+ * \brief Лучшая реализация, доступная на этом процессоре (определяется один раз).
+ */
+EvalKernel bestEvalKernel();
+
+/**
+ * \brief Название реализации: "scalar", "sse" или "avx2".
+ */
+const char* evalKernelName(EvalKernel kernel);
+
+/**
+ * \brief Оценить пачку позиций: scores[i] = evaluate(states[i], weights).
+ * \param states Позиции
+ * \param count Число позиций
+ * \param scores Оценки (count элементов)
+ * \param weights Веса оценки
+ * \param kernel Реализация; неподдерживаемая заменяется скалярной
+ */
+void evaluateBatch(const GameState* states, size_t count, int* scores, const EvalWeights& weights = EvalWeights(),
+                   EvalKernel kernel = EVAL_BEST);
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "gamerecord.h"
+
+/**
+ * \brief Перевод архива партий между PDN и двоичным форматом.
+ *
+ * Партии читаются и пишутся по одной, так что размер архива не ограничен
+ * памятью. Формат определяется по расширению: .cgr — двоичный, иначе PDN.
+ *
+ * Использование: gameconv вход выход
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: gameconv input output (.cgr is binary, anything else is PDN)" << std::endl;
+        return 1;
+    }
+    std::string input = argv[1];
+    std::string output = argv[2];
+    if (!std::ifstream(input)) {
+        std::cerr << "Cannot open " << input << std::endl;
+        return 1;
+    }
+    bool binaryOut = isBinaryArchive(output);
+    std::ofstream out(output, binaryOut ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+    if (!out) {
+        std::cerr << "Cannot open " << output << std::endl;
+        return 1;
+    }
+    PdnWriter pdnWriter(out);
+    BinaryGameWriter binaryWriter(out);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t moves = 0;
+    bool written = true;
+    long games = readArchive(input, [&](const Game& game) {
+        written = binaryOut ? binaryWriter.write(game) : pdnWriter.write(game);
+        if (written) moves += game.moves.size();
+        return written;
+    }, std::cerr);
+    if (games < 0) {
+        std::cerr << "Cannot open " << input << std::endl;
+        return 1;
+    }
+    if (!written) {
+        std::cerr << "Cannot write game " << games << " to " << output << std::endl;
+        return 1;
+    }
+    out.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ifstream in(input, std::ios::binary | std::ios::ate);
+    std::streamoff inBytes = in.tellg();
+    std::streamoff outBytes = out.tellp();
+    std::cout << games << " games, " << moves << " moves in " << seconds << " s (" << (seconds > 0 ? games / seconds : 0)
+              << " games/s)" << std::endl;
+    if (games > 0) {
+        std::cout << "Bytes per game: " << double(inBytes) / games << " -> " << double(outBytes) / games << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,493 @@
+#include "gamerecord.h"
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+#include "notation.h"
+
+namespace {
+
+const char BINARY_MAGIC[4] = {'C', 'K', 'G', 'R'};
+const uint32_t BINARY_VERSION = 1;
+const uint8_t FLAG_CUSTOM_START = 1;
+const uint64_t BINARY_MAX_GAME_SIZE = 1 << 20; ///< Предел длины записи: больше — повреждение, а не партия
+const size_t LINE_WIDTH = 79;
+
+bool isStandardStart(const GameState& state) {
+    GameState initial;
+    initBoard(initial);
+    return state.board == initial.board && state.currentTurn == initial.currentTurn;
+}
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += char(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out += char(uint8_t(value));
+}
+
+void putString(std::string& out, const std::string& text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+void putUint32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out += char(uint8_t(value >> (8 * i)));
+}
+
+/**
+ * \brief Чтение записи партии по байтам с проверкой границ.
+ */
+struct ByteCursor {
+    const std::string& data;
+    size_t pos;
+
+    bool getByte(uint8_t& value) {
+        if (pos >= data.size()) return false;
+        value = uint8_t(data[pos++]);
+        return true;
+    }
+
+    bool getVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!getByte(byte)) return false;
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool getString(std::string& text) {
+        uint64_t length;
+        if (!getVarint(length) || length > data.size() - pos) return false;
+        text.assign(data, pos, size_t(length));
+        pos += size_t(length);
+        return true;
+    }
+
+    bool getUint32(uint32_t& value) {
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint8_t byte;
+            if (!getByte(byte)) return false;
+            value |= uint32_t(byte) << (8 * i);
+        }
+        return true;
+    }
+};
+
+bool isDelimiter(int c) {
+    return c == EOF || isspace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';';
+}
+
+void appendEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+}
+
+} // namespace
+
+void Game::clear() {
+    tags.clear();
+    initBoard(start);
+    moves.clear();
+    comments.clear();
+    result = RESULT_UNKNOWN;
+}
+
+std::string Game::tag(const std::string& name) const {
+    for (const auto& tag : tags) {
+        if (tag.first == name) return tag.second;
+    }
+    return std::string();
+}
+
+void Game::setTag(const std::string& name, const std::string& value) {
+    for (auto& tag : tags) {
+        if (tag.first == name) {
+            tag.second = value;
+            return;
+        }
+    }
+    tags.emplace_back(name, value);
+}
+
+void Game::addMove(const Move& move, const std::string& comment) {
+    moves.push_back(move);
+    comments.push_back(comment);
+}
+
+GameState Game::finalState() const {
+    GameState state = start;
+    for (const Move& move : moves) makeMove(state, move);
+    return state;
+}
+
+const char* resultToString(GameResult result) {
+    switch (result) {
+        case RESULT_WHITE_WINS: return "2-0";
+        case RESULT_BLACK_WINS: return "0-2";
+        case RESULT_DRAW: return "1-1";
+        default: return "*";
+    }
+}
+
+bool parseResult(const std::string& text, GameResult& result) {
+    if (text == "2-0" || text == "1-0") result = RESULT_WHITE_WINS;
+    else if (text == "0-2" || text == "0-1") result = RESULT_BLACK_WINS;
+    else if (text == "1-1" || text == "1/2-1/2") result = RESULT_DRAW;
+    else if (text == "*") result = RESULT_UNKNOWN;
+    else return false;
+    return true;
+}
+
+PdnReader::PdnReader(std::istream& in) : buffer(in.rdbuf()), line(1), errorCount(0) {}
+
+int PdnReader::peek() {
+    return buffer ? buffer->sgetc() : EOF;
+}
+
+int PdnReader::get() {
+    int c = buffer ? buffer->sbumpc() : EOF;
+    if (c == '\n') ++line;
+    return c;
+}
+
+void PdnReader::skipSpace() {
+    for (int c = peek(); c != EOF && isspace(c); c = peek()) get();
+}
+
+bool PdnReader::fail(const std::string& message) {
+    errorText = "line " + std::to_string(line) + ": " + message;
+    return false;
+}
+
+bool PdnReader::readTag(std::string& name, std::string& value) {
+    get(); // '['
+    skipSpace();
+    name.clear();
+    value.clear();
+    for (int c = peek(); c != EOF && !isspace(c) && c != '"' && c != ']'; c = peek()) name += char(get());
+    skipSpace();
+    if (peek() != '"') return fail("expected a quoted tag value");
+    get();
+    for (int c = get(); c != '"'; c = get()) {
+        if (c == EOF || c == '\n') return fail("unterminated tag value");
+        if (c == '\\') c = get();
+        value += char(c);
+    }
+    skipSpace();
+    if (get() != ']') return fail("expected ']' after tag");
+    return !name.empty() || fail("empty tag name");
+}
+
+void PdnReader::readToken(std::string& text) {
+    text.clear();
+    for (int c = peek(); !isDelimiter(c); c = peek()) text += char(get());
+}
+
+void PdnReader::readComment(std::string& comment) {
+    get(); // '{'
+    comment.clear();
+    for (int c = get(); c != EOF && c != '}'; c = get()) comment += char(c);
+}
+
+void PdnReader::skipVariation() {
+    int depth = 0;
+    for (int c = get(); c != EOF; c = get()) {
+        if (c == '(') ++depth;
+        else if (c == ')' && --depth == 0) return;
+        else if (c == '{') {
+            while (c != EOF && c != '}') c = get();
+        }
+    }
+}
+
+void PdnReader::skipGame() {
+    // Следующая партия начинается с тега в начале строки
+    int previous = '\n';
+    for (int c = peek(); c != EOF; c = peek()) {
+        if (c == '[' && previous == '\n') return;
+        previous = get();
+    }
+}
+
+bool PdnReader::next(Game& game) {
+    for (;;) {
+        skipSpace();
+        if (peek() == EOF) return false;
+        game.clear();
+
+        bool ok = true;
+        std::string name, value;
+        while (ok && peek() == '[') {
+            ok = readTag(name, value);
+            if (!ok) break;
+            if (name == "FEN") {
+                if (!parseFen(value, game.start)) ok = fail("invalid FEN \"" + value + "\"");
+            }
+            else if (name == "Result") {
+                if (!parseResult(value, game.result)) game.result = RESULT_UNKNOWN;
+            }
+            else {
+                game.tags.emplace_back(name, value);
+            }
+            skipSpace();
+        }
+
+        GameState state = game.start;
+        while (ok) {
+            skipSpace();
+            int c = peek();
+            if (c == EOF || c == '[') return true;
+            if (c == '{') {
+                readComment(value);
+                if (!game.comments.empty()) game.comments.back() += value;
+                continue;
+            }
+            if (c == '(') {
+                skipVariation();
+                continue;
+            }
+            if (c == ';') {
+                while (peek() != EOF && peek() != '\n') get();
+                continue;
+            }
+            if (c == ')' || c == '}' || c == ']') {
+                get();
+                continue;
+            }
+
+            readToken(token);
+            GameResult result;
+            if (parseResult(token, result)) {
+                game.result = result;
+                return true;
+            }
+            if (token[0] == '$') continue;
+            // Номер хода может быть приклеен к ходу: "1.22-18"
+            size_t dot = token.find_last_of('.');
+            if (dot != std::string::npos) token.erase(0, dot + 1);
+            while (!token.empty() && (token.back() == '!' || token.back() == '?')) token.pop_back();
+            if (token.empty()) continue;
+
+            generateMoves(state, legal);
+            int index = findMove(token, legal);
+            if (index < 0) {
+                ok = fail("illegal or ambiguous move " + token);
+                break;
+            }
+            game.addMove(legal[index]);
+            makeMove(state, legal[index]);
+        }
+        ++errorCount;
+        skipGame();
+    }
+}
+
+PdnWriter::PdnWriter(std::ostream& out) : out(out) {}
+
+bool PdnWriter::write(const Game& game) {
+    text.clear();
+    for (const auto& tag : game.tags) {
+        text += '[';
+        text += tag.first;
+        text += " \"";
+        appendEscaped(text, tag.second);
+        text += "\"]\n";
+    }
+    if (!isStandardStart(game.start)) {
+        text += "[FEN \"" + toFen(game.start) + "\"]\n";
+    }
+    text += "[Result \"";
+    text += resultToString(game.result);
+    text += "\"]\n\n";
+
+    size_t lineStart = text.size();
+    auto addToken = [&](const std::string& word) {
+        if (text.size() > lineStart) {
+            if (text.size() - lineStart + 1 + word.size() > LINE_WIDTH) {
+                text += '\n';
+                lineStart = text.size();
+            }
+            else {
+                text += ' ';
+            }
+        }
+        text += word;
+    };
+
+    bool white = game.start.currentTurn == WHITE_TURN;
+    int number = 1;
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        std::string word;
+        if (white) word = std::to_string(number) + ". ";
+        else if (i == 0) word = std::to_string(number) + "... ";
+        word += moveToString(game.moves[i]);
+        addToken(word);
+        if (i < game.comments.size() && !game.comments[i].empty()) {
+            std::string comment = game.comments[i];
+            for (char& c : comment) {
+                if (c == '}') c = ')';
+            }
+            addToken("{" + comment + "}");
+        }
+        if (!white) ++number;
+        white = !white;
+    }
+    addToken(resultToString(game.result));
+    text += "\n\n";
+
+    out.write(text.data(), std::streamsize(text.size()));
+    return bool(out);
+}
+
+BinaryGameReader::BinaryGameReader(std::istream& in) : in(in), headerChecked(false) {}
+
+bool BinaryGameReader::fail(const std::string& message) {
+    errorText = message;
+    return false;
+}
+
+bool BinaryGameReader::next(Game& game) {
+    if (!headerChecked) {
+        char header[8];
+        if (!in.read(header, sizeof(header))) return in.gcount() == 0 ? false : fail("truncated file header");
+        uint32_t version = 0;
+        for (int i = 0; i < 4; ++i) version |= uint32_t(uint8_t(header[4 + i])) << (8 * i);
+        if (std::memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) return fail("not a game record file");
+        if (version != BINARY_VERSION) return fail("unsupported format version " + std::to_string(version));
+        headerChecked = true;
+    }
+
+    uint64_t length = 0;
+    for (int shift = 0;; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return shift == 0 ? false : fail("truncated game length");
+        length |= uint64_t(c & 0x7F) << shift;
+        if (!(c & 0x80)) break;
+        if (shift > 56) return fail("corrupt game length");
+    }
+    if (length > BINARY_MAX_GAME_SIZE) return fail("corrupt game length");
+    body.resize(size_t(length));
+    if (!in.read(&body[0], std::streamsize(length))) return fail("truncated game record");
+
+    game.clear();
+    ByteCursor cursor{body, 0};
+    uint64_t tagCount;
+    if (!cursor.getVarint(tagCount)) return fail("corrupt tags");
+    std::string name, value;
+    for (uint64_t i = 0; i < tagCount; ++i) {
+        if (!cursor.getString(name) || !cursor.getString(value)) return fail("corrupt tags");
+        game.tags.emplace_back(name, value);
+    }
+    uint8_t result, flags;
+    if (!cursor.getByte(result) || result > RESULT_DRAW || !cursor.getByte(flags)) return fail("corrupt game header");
+    game.result = GameResult(result);
+    if (flags & FLAG_CUSTOM_START) {
+        uint8_t turn;
+        Position& board = game.start.board;
+        if (!cursor.getUint32(board.white) || !cursor.getUint32(board.black) || !cursor.getUint32(board.kings) ||
+            !cursor.getByte(turn) || (board.white & board.black) || (board.kings & ~(board.white | board.black))) {
+            return fail("corrupt start position");
+        }
+        game.start.currentTurn = turn ? BLACK_TURN : WHITE_TURN;
+        game.start.hash = computeHash(game.start);
+        updateCaptureMaps(game.start);
+    }
+
+    uint64_t moveCount;
+    if (!cursor.getVarint(moveCount) || moveCount > body.size() - cursor.pos) return fail("corrupt move count");
+    GameState state = game.start;
+    for (uint64_t i = 0; i < moveCount; ++i) {
+        uint8_t index;
+        if (!cursor.getByte(index)) return fail("truncated moves");
+        generateMoves(state, legal);
+        if (index >= legal.size()) return fail("move " + std::to_string(i + 1) + " is out of range");
+        game.addMove(legal[index]);
+        makeMove(state, legal[index]);
+    }
+    return true;
+}
+
+BinaryGameWriter::BinaryGameWriter(std::ostream& out) : out(out), headerWritten(false) {}
+
+bool BinaryGameWriter::write(const Game& game) {
+    if (!headerWritten) {
+        if (out.tellp() <= 0) {
+            body.clear();
+            body.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+            putUint32(body, BINARY_VERSION);
+            out.write(body.data(), std::streamsize(body.size()));
+        }
+        headerWritten = true;
+    }
+
+    body.clear();
+    putVarint(body, game.tags.size());
+    for (const auto& tag : game.tags) {
+        putString(body, tag.first);
+        putString(body, tag.second);
+    }
+    body += char(game.result);
+    bool custom = !isStandardStart(game.start);
+    body += char(custom ? FLAG_CUSTOM_START : 0);
+    if (custom) {
+        putUint32(body, game.start.board.white);
+        putUint32(body, game.start.board.black);
+        putUint32(body, game.start.board.kings);
+        body += char(game.start.currentTurn == BLACK_TURN ? 1 : 0);
+    }
+
+    putVarint(body, game.moves.size());
+    GameState state = game.start;
+    for (const Move& move : game.moves) {
+        generateMoves(state, legal);
+        int index = -1;
+        for (int i = 0; i < legal.size(); ++i) {
+            if (sameMove(legal[i], move)) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) return false;
+        body += char(uint8_t(index));
+        makeMove(state, legal[index]);
+    }
+
+    if (body.size() > BINARY_MAX_GAME_SIZE) return false;
+    std::string length;
+    putVarint(length, body.size());
+    out.write(length.data(), std::streamsize(length.size()));
+    out.write(body.data(), std::streamsize(body.size()));
+    return bool(out);
+}
+
+bool isBinaryArchive(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".cgr") == 0;
+}
+
+long readArchive(const std::string& path, const std::function<bool(const Game&)>& onGame, std::ostream& errors) {
+    bool binary = isBinaryArchive(path);
+    std::ifstream in(path, binary ? std::ios::binary : std::ios::in);
+    if (!in) return -1;
+    PdnReader pdnReader(in);
+    BinaryGameReader binaryReader(in);
+    Game game;
+    long games = 0;
+    while (binary ? binaryReader.next(game) : pdnReader.next(game)) {
+        ++games;
+        if (!onGame(game)) break;
+    }
+    if (binary && !binaryReader.lastError().empty()) errors << path << ": " << binaryReader.lastError() << std::endl;
+    if (!binary && pdnReader.errors() > 0) {
+        errors << path << ": skipped " << pdnReader.errors() << " games, last: " << pdnReader.lastError() << std::endl;
+    }
+    return games;
+}
@@ -0,0 +1,218 @@
+/**
+ * \file gamerecord.h
+ * \brief Запись партий: потоковое чтение и запись PDN и компактный двоичный формат.
+ *
+ * Читатели и писатели работают с потоками по одной партии за раз и
+ * переиспользуют объект Game, поэтому архив любого размера обрабатывается
+ * в постоянной памяти:
+ *
+ *     PdnReader reader(in);
+ *     Game game;
+ *     while (reader.next(game)) { ... }
+ *
+ * Двоичный формат: заголовок файла "CKGR" и номер версии, затем партии.
+ * Партия — длина ее записи (varint), теги (число, затем пары строк с длиной
+ * varint), результат, флаги, начальная позиция (если не стандартная),
+ * число ходов и по байту на ход — номер хода в списке generateMoves().
+ * Номер зависит от порядка генерации ходов; если порядок меняется,
+ * меняется и версия формата. Комментарии к ходам в двоичный формат
+ * не попадают. Запись партии длиннее BINARY_MAX_GAME_SIZE считается
+ * поврежденной.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "movegen.h"
+
+/// Результат партии.
+enum GameResult {
+    RESULT_UNKNOWN, ///< Партия не окончена или результат неизвестен ("*")
+    RESULT_WHITE_WINS, ///< Победа белых ("2-0")
+    RESULT_BLACK_WINS, ///< Победа черных ("0-2")
+    RESULT_DRAW ///< Ничья ("1-1")
+};
+
+/**
+ * \brief Партия: теги, начальная позиция, ходы и результат.
+ */
+struct Game {
+    std::vector<std::pair<std::string, std::string>> tags; ///< Теги PDN, кроме FEN и Result, в порядке записи
+    GameState start; ///< Начальная позиция
+    std::vector<Move> moves; ///< Ходы
+    std::vector<std::string> comments; ///< Комментарий после каждого хода (пустая строка — нет)
+    GameResult result = RESULT_UNKNOWN; ///< Результат
+
+    Game() { clear(); }
+
+    /**
+     * \brief Очистить партию, сохранив выделенную память.
+     */
+    void clear();
+
+    /**
+     * \brief Значение тега или пустая строка.
+     */
+    std::string tag(const std::string& name) const;
+
+    /**
+     * \brief Установить или заменить тег.
+     */
+    void setTag(const std::string& name, const std::string& value);
+
+    /**
+     * \brief Добавить ход с комментарием.
+     */
+    void addMove(const Move& move, const std::string& comment = std::string());
+
+    /**
+     * \brief Позиция после всех ходов.
+     */
+    GameState finalState() const;
+};
+
+/**
+ * \brief Запись результата в PDN: "2-0", "0-2", "1-1" или "*".
+ */
+const char* resultToString(GameResult result);
+
+/**
+ * \brief Разобрать результат; понимает и запись "1-0", "0-1", "1/2-1/2".
+ * \return false, если строка не является результатом.
+ */
+bool parseResult(const std::string& text, GameResult& result);
+
+/**
+ * \brief Потоковое чтение партий в формате PDN.
+ *
+ * Понимает теги, номера ходов, комментарии в фигурных скобках (комментарий
+ * после хода сохраняется), варианты в круглых скобках и пометки $n, !, ?
+ * (пропускаются). Партия с недопустимым ходом или позицией пропускается,
+ * а причина запоминается.
+ */
+class PdnReader {
+public:
+    explicit PdnReader(std::istream& in);
+
+    /**
+     * \brief Прочитать следующую партию.
+     * \return false, если партий больше нет.
+     */
+    bool next(Game& game);
+
+    /**
+     * \brief Число пропущенных партий с ошибками.
+     */
+    int errors() const { return errorCount; }
+
+    /**
+     * \brief Описание последней ошибки.
+     */
+    const std::string& lastError() const { return errorText; }
+
+private:
+    int peek();
+    int get();
+    void skipSpace();
+    bool readTag(std::string& name, std::string& value);
+    void readToken(std::string& token);
+    void readComment(std::string& comment);
+    void skipVariation();
+    void skipGame();
+    bool fail(const std::string& message);
+
+    std::streambuf* buffer;
+    int line;
+    int errorCount;
+    std::string errorText;
+    std::string token; ///< Буфер разбора, переиспользуется между партиями
+    MoveList legal;
+};
+
+/**
+ * \brief Потоковая запись партий в формате PDN.
+ */
+class PdnWriter {
+public:
+    explicit PdnWriter(std::ostream& out);
+
+    /**
+     * \brief Записать партию.
+     * \return false при ошибке записи.
+     */
+    bool write(const Game& game);
+
+private:
+    std::ostream& out;
+    std::string text; ///< Буфер партии, переиспользуется
+};
+
+/**
+ * \brief Потоковое чтение двоичного формата.
+ */
+class BinaryGameReader {
+public:
+    explicit BinaryGameReader(std::istream& in);
+
+    /**
+     * \brief Прочитать следующую партию.
+     * \return false, если партий больше нет или файл поврежден (см. lastError()).
+     */
+    bool next(Game& game);
+
+    const std::string& lastError() const { return errorText; }
+
+private:
+    bool fail(const std::string& message);
+
+    std::istream& in;
+    bool headerChecked;
+    std::string errorText;
+    std::string body; ///< Запись партии, переиспользуется
+    MoveList legal;
+};
+
+/**
+ * \brief Потоковая запись двоичного формата.
+ *
+ * Заголовок файла пишется перед первой партией, только если поток пуст,
+ * так что партии можно дописывать в существующий файл.
+ */
+class BinaryGameWriter {
+public:
+    explicit BinaryGameWriter(std::ostream& out);
+
+    /**
+     * \brief Записать партию.
+     * \return false при ошибке записи или если ход партии не найден среди допустимых.
+     */
+    bool write(const Game& game);
+
+private:
+    std::ostream& out;
+    bool headerWritten;
+    std::string body; ///< Запись партии, переиспользуется
+    MoveList legal;
+};
+
+/**
+ * \brief Двоичный ли файл партий: расширение .cgr, все прочие — PDN.
+ */
+bool isBinaryArchive(const std::string& path);
+
+/**
+ * \brief Прочитать все партии архива в формате, определенном по расширению.
+ *
+ * Ошибки чтения печатаются в errors с именем файла: поврежденная
+ * двоичная запись прекращает чтение, партии PDN с ошибками пропускаются.
+ * \param onGame Вызывается для каждой партии; false прекращает чтение
+ * \return Число прочитанных партий или -1, если файл не открылся.
+ */
+long readArchive(const std::string& path, const std::function<bool(const Game&)>& onGame, std::ostream& errors);
@@ -0,0 +1,257 @@
+#include "gameserver.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "notation.h"
+
+namespace {
+
+const uint16_t MAX_SESSION_PLY = 65535;
+
+/**
+ * \brief Следующее слово строки начиная с pos; pos сдвигается за слово.
+ */
+std::string nextWord(const std::string& line, size_t& pos) {
+    size_t begin = line.find_first_not_of(' ', pos);
+    if (begin == std::string::npos) {
+        pos = line.size();
+        return std::string();
+    }
+    size_t end = line.find(' ', begin);
+    if (end == std::string::npos) end = line.size();
+    pos = end;
+    return line.substr(begin, end - begin);
+}
+
+bool parseId(const std::string& text, uint64_t& id) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    id = strtoull(text.c_str(), nullptr, 10);
+    return true;
+}
+
+bool hasClient(const Session& session, int client) {
+    if (session.white == client || session.black == client) return true;
+    for (int watcher : session.watchers) {
+        if (watcher == client) return true;
+    }
+    return false;
+}
+
+void removeGame(std::vector<uint64_t>& games, uint64_t id) {
+    auto found = std::find(games.begin(), games.end(), id);
+    if (found != games.end()) games.erase(found);
+}
+
+} // namespace
+
+SessionPool::SessionPool() : activeCount(0) {}
+
+uint64_t SessionPool::create() {
+    if (freeSlots.empty()) {
+        uint32_t first = uint32_t(capacity());
+        blocks.emplace_back(new Session[BLOCK_SIZE]);
+        for (uint32_t i = BLOCK_SIZE; i-- > 0;) {
+            Session& session = blocks.back()[i];
+            session.generation = 0;
+            session.active = false;
+            freeSlots.push_back(first + i);
+        }
+    }
+    uint32_t index = freeSlots.back();
+    freeSlots.pop_back();
+    Session& session = blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    initBoard(session.state);
+    session.ply = 0;
+    session.result = RESULT_UNKNOWN;
+    session.active = true;
+    session.white = session.black = NO_CLIENT;
+    std::fill(session.watchers, session.watchers + MAX_WATCHERS, NO_CLIENT);
+    ++activeCount;
+    return uint64_t(session.generation) << 32 | index;
+}
+
+Session* SessionPool::find(uint64_t id) {
+    uint32_t index = uint32_t(id);
+    if (index >= capacity()) return nullptr;
+    Session& session = blocks[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    if (!session.active || session.generation != uint32_t(id >> 32)) return nullptr;
+    return &session;
+}
+
+void SessionPool::release(uint64_t id) {
+    Session* session = find(id);
+    if (!session) return;
+    session->active = false;
+    ++session->generation;
+    freeSlots.push_back(uint32_t(id));
+    --activeCount;
+}
+
+size_t SessionPool::memoryBytes() const {
+    return capacity() * sizeof(Session) + freeSlots.capacity() * sizeof(uint32_t) +
+           blocks.capacity() * sizeof(blocks[0]);
+}
+
+GameServer::GameServer(SendFunction send) : send(send), moveCount(0) {}
+
+void GameServer::handle(int client, const std::string& line) {
+    size_t pos = 0;
+    std::string command = nextWord(line, pos);
+    if (command == "new") {
+        create(client);
+        return;
+    }
+    if (command == "stats") {
+        stats(client);
+        return;
+    }
+
+    std::string idText = nextWord(line, pos);
+    uint64_t id;
+    if (command != "join" && command != "watch" && command != "move" && command != "leave") {
+        error(client, "-", "unknown command " + command);
+    }
+    else if (!parseId(idText, id)) {
+        error(client, "-", "expected a game id");
+    }
+    else if (command == "join" || command == "watch") {
+        join(client, id, command == "watch");
+    }
+    else if (command == "move") {
+        move(client, id, nextWord(line, pos));
+    }
+    else {
+        leave(client, id, true);
+    }
+}
+
+void GameServer::create(int client) {
+    uint64_t id = pool.create();
+    pool.find(id)->white = client;
+    clientSessions[client].push_back(id);
+    send(client, "created " + std::to_string(id) + "\n");
+}
+
+void GameServer::join(int client, uint64_t id, bool watch) {
+    Session* session = pool.find(id);
+    std::string idText = std::to_string(id);
+    if (!session) {
+        error(client, idText, "no such game");
+        return;
+    }
+    int32_t* seat = nullptr;
+    if (!watch) {
+        if (session->black == NO_CLIENT) seat = &session->black;
+    }
+    else {
+        for (int32_t& watcher : session->watchers) {
+            if (watcher == NO_CLIENT) {
+                seat = &watcher;
+                break;
+            }
+        }
+    }
+    if (!seat) {
+        error(client, idText, watch ? "too many watchers" : "the game is full");
+        return;
+    }
+    if (!hasClient(*session, client)) clientSessions[client].push_back(id);
+    *seat = client;
+    send(client, (watch ? "watching " : "joined ") + idText + " " + toFen(session->state) + "\n");
+}
+
+void GameServer::move(int client, uint64_t id, const std::string& text) {
+    Session* session = pool.find(id);
+    std::string idText = std::to_string(id);
+    if (!session) {
+        error(client, idText, "no such game");
+        return;
+    }
+    if (session->result != RESULT_UNKNOWN) {
+        error(client, idText, "the game is over");
+        return;
+    }
+    int32_t mover = session->state.currentTurn == WHITE_TURN ? session->white : session->black;
+    if (mover != client) {
+        error(client, idText, "not your move");
+        return;
+    }
+    generateMoves(session->state, legal);
+    int index = findMove(text, legal);
+    if (index < 0) {
+        error(client, idText, "illegal move " + text);
+        return;
+    }
+    makeMove(session->state, legal[index]);
+    ++moveCount;
+    if (session->ply < MAX_SESSION_PLY) ++session->ply;
+
+    reply = "update " + idText + " " + std::to_string(session->ply) + " " + moveToString(legal[index]) + " " +
+            toFen(session->state) + "\n";
+    generateMoves(session->state, legal);
+    if (legal.empty()) {
+        session->result = session->state.currentTurn == WHITE_TURN ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+        reply += "over " + idText + " " + resultToString(GameResult(session->result)) + "\n";
+    }
+    broadcast(*session, reply);
+}
+
+void GameServer::leave(int client, uint64_t id, bool notify) {
+    Session* session = pool.find(id);
+    if (!session || !hasClient(*session, client)) {
+        if (notify) error(client, std::to_string(id), "not in this game");
+        return;
+    }
+    if (session->white == client) session->white = NO_CLIENT;
+    if (session->black == client) session->black = NO_CLIENT;
+    for (int32_t& watcher : session->watchers) {
+        if (watcher == client) watcher = NO_CLIENT;
+    }
+    if (notify) {
+        removeGame(clientSessions[client], id);
+        send(client, "left " + std::to_string(id) + "\n");
+    }
+
+    broadcast(*session, "opponentleft " + std::to_string(id) + "\n");
+    // Партия без игроков удаляется вместе с наблюдателями
+    if (session->white == NO_CLIENT && session->black == NO_CLIENT) {
+        for (int32_t watcher : session->watchers) {
+            if (watcher == NO_CLIENT) continue;
+            removeGame(clientSessions[watcher], id);
+        }
+        pool.release(id);
+    }
+}
+
+void GameServer::disconnect(int client) {
+    auto found = clientSessions.find(client);
+    if (found == clientSessions.end()) return;
+    std::vector<uint64_t> games;
+    games.swap(found->second);
+    clientSessions.erase(found);
+    for (uint64_t id : games) leave(client, id, false);
+}
+
+void GameServer::stats(int client) {
+    send(client, "stats sessions " + std::to_string(pool.active()) + " capacity " + std::to_string(pool.capacity()) +
+                     " bytes " + std::to_string(pool.memoryBytes()) + " rss " +
+                     std::to_string(memoryUsage ? memoryUsage() : 0) + " moves " + std::to_string(moveCount) + "\n");
+}
+
+void GameServer::error(int client, const std::string& id, const std::string& message) {
+    send(client, "error " + id + " " + message + "\n");
+}
+
+void GameServer::broadcast(const Session& session, const std::string& text) {
+    // Один клиент может занимать несколько мест, но получает обновление один раз
+    int32_t seats[2 + MAX_WATCHERS] = {session.white, session.black};
+    std::copy(session.watchers, session.watchers + MAX_WATCHERS, seats + 2);
+    int32_t sent[2 + MAX_WATCHERS];
+    int count = 0;
+    for (int32_t client : seats) {
+        if (client == NO_CLIENT || std::find(sent, sent + count, client) != sent + count) continue;
+        sent[count++] = client;
+        send(client, text);
+    }
+}
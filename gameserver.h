@@ -0,0 +1,144 @@
+/**
+ * \file gameserver.h
+ * \brief Партии многих игроков в одном процессе: пул сессий и построчный протокол сервера.
+ *
+ * Здесь нет работы с сетью: GameServer получает строки от клиентов,
+ * обозначенных номерами, и отдает ответы через функцию отправки. Сетевой
+ * цикл (epoll) находится в server.cpp.
+ *
+ * Протокол (строки с '\n'):
+ *
+ *     new                -> created <id>              создать партию и сесть за белых
+ *     join <id>          -> joined <id> <FEN>         сесть за черных
+ *     watch <id>         -> watching <id> <FEN>       наблюдать
+ *     move <id> <ход>    -> всем участникам: update <id> <полуход> <ход> <FEN>
+ *                           и по окончании: over <id> <результат>
+ *     leave <id>         -> left <id>; оставшимся: opponentleft <id>
+ *     stats              -> stats sessions N capacity N bytes N rss N moves N
+ *
+ * Ошибки: "error <id> <описание>" (id "-", если он не разобран).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gamerecord.h"
+#include "movegen.h"
+
+const int MAX_WATCHERS = 2; ///< Наблюдателей у одной партии
+const int NO_CLIENT = -1; ///< Пустое место в партии
+
+/**
+ * \brief Партия на сервере. Размер фиксирован, чтобы партии лежали в пуле подряд.
+ */
+struct Session {
+    GameState state; ///< Текущая позиция
+    uint32_t generation; ///< Поколение ячейки пула: номер партии из старого поколения недействителен
+    uint16_t ply; ///< Сделано полуходов
+    uint8_t result; ///< GameResult; RESULT_UNKNOWN, пока партия идет
+    bool active; ///< Ячейка занята
+    int32_t white; ///< Клиент за белых или NO_CLIENT
+    int32_t black; ///< Клиент за черных или NO_CLIENT
+    int32_t watchers[MAX_WATCHERS]; ///< Наблюдатели или NO_CLIENT
+};
+
+/**
+ * \brief Пул сессий: блоки ячеек фиксированного размера и список свободных ячеек.
+ *
+ * Память выделяется блоками и не возвращается, поэтому создание и удаление
+ * партии не обращаются к распределителю памяти, а указатели на сессии
+ * остаются действительными. Номер партии — индекс ячейки и ее поколение.
+ */
+class SessionPool {
+public:
+    static const uint32_t BLOCK_SIZE = 4096; ///< Ячеек в блоке
+
+    SessionPool();
+
+    /**
+     * \brief Занять ячейку под новую партию из начальной позиции.
+     * \return Номер партии.
+     */
+    uint64_t create();
+
+    /**
+     * \brief Найти партию по номеру.
+     * \return nullptr, если партии нет (или она уже удалена).
+     */
+    Session* find(uint64_t id);
+
+    /**
+     * \brief Освободить ячейку партии.
+     */
+    void release(uint64_t id);
+
+    size_t active() const { return activeCount; }
+    size_t capacity() const { return blocks.size() * BLOCK_SIZE; }
+
+    /**
+     * \brief Память под ячейки и список свободных.
+     */
+    size_t memoryBytes() const;
+
+private:
+    std::vector<std::unique_ptr<Session[]>> blocks;
+    std::vector<uint32_t> freeSlots;
+    size_t activeCount;
+};
+
+/**
+ * \brief Логика сервера: сессии, проверка ходов по общим правилам и рассылка обновлений.
+ */
+class GameServer {
+public:
+    /// Отправка текста клиенту (текст уже заканчивается '\n').
+    typedef std::function<void(int client, const std::string& text)> SendFunction;
+
+    explicit GameServer(SendFunction send);
+
+    /**
+     * \brief Выполнить строку от клиента.
+     */
+    void handle(int client, const std::string& line);
+
+    /**
+     * \brief Клиент отключился: он покидает все свои партии.
+     */
+    void disconnect(int client);
+
+    /**
+     * \brief Задать функцию, возвращающую занятую процессом память (для stats).
+     */
+    void setMemoryUsage(std::function<uint64_t()> memoryUsage) { this->memoryUsage = memoryUsage; }
+
+    const SessionPool& sessions() const { return pool; }
+
+    /**
+     * \brief Число проверенных допустимых ходов.
+     */
+    uint64_t movesValidated() const { return moveCount; }
+
+private:
+    void create(int client);
+    void join(int client, uint64_t id, bool watch);
+    void move(int client, uint64_t id, const std::string& text);
+    void leave(int client, uint64_t id, bool notify);
+    void stats(int client);
+    void error(int client, const std::string& id, const std::string& message);
+    void broadcast(const Session& session, const std::string& text);
+
+    SendFunction send;
+    std::function<uint64_t()> memoryUsage;
+    SessionPool pool;
+    std::unordered_map<int, std::vector<uint64_t>> clientSessions; ///< Партии каждого клиента
+    uint64_t moveCount;
+    MoveList legal;
+    std::string reply; ///< Буфер ответа, переиспользуется
+};
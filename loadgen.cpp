@@ -0,0 +1,305 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "movegen.h"
+#include "notation.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    int port = 7878;
+    std::string unixPath;
+    int connections = 4;
+    int sessions = 256; ///< Партий на соединение
+    int seconds = 5;
+    int maxPlies = 120; ///< После стольких полуходов партия заменяется новой
+};
+
+int connectTo(const Options& options) {
+    if (!options.unixPath.empty()) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(uint16_t(options.port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+bool writeAll(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t written = write(fd, text.data() + sent, text.size() - sent);
+        if (written <= 0) return false;
+        sent += size_t(written);
+    }
+    return true;
+}
+
+/**
+ * \brief Результаты одного соединения.
+ */
+struct ClientStats {
+    uint64_t moves = 0;
+    uint64_t games = 0;
+    uint64_t errors = 0;
+    std::vector<uint32_t> latencyUs; ///< Время от отправки хода до обновления
+};
+
+/**
+ * \brief Соединение, которое играет sessions партий за обе стороны случайными ходами.
+ *
+ * У каждой партии не больше одного хода в пути; следующий ход уходит,
+ * как только пришло обновление. Ответы разбираются пачками, а ходы
+ * одной пачки отправляются одним вызовом write.
+ */
+class LoadClient {
+public:
+    LoadClient(const Options& options, int number) : options(options), random(uint32_t(number) * 7919u + 1) {}
+
+    bool run(Clock::time_point deadline, std::atomic<int>& finished, std::atomic<bool>& release) {
+        fd = connectTo(options);
+        if (fd < 0) {
+            // main ждет, пока закончат все соединения, в том числе не открывшиеся
+            ++finished;
+            return false;
+        }
+        std::string out;
+        for (int i = 0; i < options.sessions; ++i) out += "new\n";
+        bool ok = writeAll(fd, out);
+
+        std::string input;
+        char buffer[65536];
+        while (ok && Clock::now() < deadline) {
+            pollfd waiting{fd, POLLIN, 0};
+            if (poll(&waiting, 1, 100) <= 0) continue;
+            ssize_t got = read(fd, buffer, sizeof(buffer));
+            if (got <= 0) {
+                ok = false;
+                break;
+            }
+            input.append(buffer, size_t(got));
+            out.clear();
+            size_t start = 0;
+            for (size_t end = input.find('\n'); end != std::string::npos; end = input.find('\n', start)) {
+                handle(input.substr(start, end - start), out);
+                start = end + 1;
+            }
+            input.erase(0, start);
+            if (!out.empty()) ok = writeAll(fd, out);
+        }
+
+        // Соединение остается открытым, пока не сняты показатели сервера
+        ++finished;
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        close(fd);
+        return ok;
+    }
+
+    ClientStats stats;
+
+private:
+    struct Game {
+        GameState state;
+        Move pending;
+        Clock::time_point sentAt;
+        int plies = 0;
+    };
+
+    void sendMove(uint64_t id, Game& game, std::string& out) {
+        generateMoves(game.state, legal);
+        if (legal.empty() || game.plies >= options.maxPlies) {
+            // Партия окончена: освобождаем ее и начинаем новую
+            out += "leave " + std::to_string(id) + "\nnew\n";
+            games.erase(id);
+            ++stats.games;
+            return;
+        }
+        game.pending = legal[int(random() % uint32_t(legal.size()))];
+        game.sentAt = Clock::now();
+        out += "move " + std::to_string(id) + " " + moveToString(game.pending) + "\n";
+    }
+
+    void handle(const std::string& line, std::string& out) {
+        std::istringstream words(line);
+        std::string kind;
+        uint64_t id = 0;
+        words >> kind >> id;
+        if (kind == "created") {
+            initBoard(games[id].state);
+            out += "join " + std::to_string(id) + "\n";
+        }
+        else if (kind == "joined") {
+            auto found = games.find(id);
+            if (found != games.end()) sendMove(id, found->second, out);
+        }
+        else if (kind == "update") {
+            auto found = games.find(id);
+            if (found == games.end()) return;
+            Game& game = found->second;
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - game.sentAt).count();
+            stats.latencyUs.push_back(uint32_t(us));
+            ++stats.moves;
+            makeMove(game.state, game.pending);
+            ++game.plies;
+            sendMove(id, game, out);
+        }
+        else if (kind == "error") {
+            ++stats.errors;
+        }
+    }
+
+    const Options& options;
+    std::mt19937 random;
+    int fd = -1;
+    std::unordered_map<uint64_t, Game> games;
+    MoveList legal;
+};
+
+std::string queryStats(const Options& options) {
+    int fd = connectTo(options);
+    if (fd < 0 || !writeAll(fd, "stats\n")) return std::string();
+    std::string reply;
+    char buffer[512];
+    while (reply.find('\n') == std::string::npos) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got <= 0) break;
+        reply.append(buffer, size_t(got));
+    }
+    close(fd);
+    return reply.substr(0, reply.find('\n'));
+}
+
+uint64_t statValue(const std::string& stats, const std::string& name) {
+    size_t pos = stats.find(" " + name + " ");
+    return pos == std::string::npos ? 0 : strtoull(stats.c_str() + pos + name.size() + 2, nullptr, 10);
+}
+
+} // namespace
+
+/**
+ * \brief Нагрузка для gameserver: много партий случайными ходами по нескольким соединениям.
+ *
+ * Печатает число проверенных сервером ходов в секунду, задержку ответа
+ * (медиана, p99, максимум) и память сервера в пересчете на партию.
+ *
+ * Использование: loadgen [-p порт] [-u сокет Unix] [-c соединений] [-s партий на соединение]
+ *   [-d секунд] [-m полуходов в партии]
+ */
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-p" && hasValue) options.port = atoi(argv[++i]);
+        else if (arg == "-u" && hasValue) options.unixPath = argv[++i];
+        else if (arg == "-c" && hasValue) options.connections = atoi(argv[++i]);
+        else if (arg == "-s" && hasValue) options.sessions = atoi(argv[++i]);
+        else if (arg == "-d" && hasValue) options.seconds = atoi(argv[++i]);
+        else if (arg == "-m" && hasValue) options.maxPlies = atoi(argv[++i]);
+        else {
+            std::cerr << "Usage: loadgen [-p port] [-u unix socket] [-c connections] [-s sessions per connection] "
+                         "[-d seconds] [-m plies per game]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (options.connections < 1 || options.sessions < 1 || options.seconds < 1 || options.maxPlies < 1) {
+        std::cerr << "Invalid arguments" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    for (int i = 0; i < options.connections; ++i) clients.emplace_back(new LoadClient(options, i));
+    std::atomic<int> finished(0);
+    std::atomic<bool> release(false);
+    std::atomic<int> failed(0);
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::seconds(options.seconds);
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+        LoadClient* current = client.get();
+        threads.emplace_back([&, current] {
+            if (!current->run(deadline, finished, release)) ++failed;
+        });
+    }
+    while (finished < options.connections) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::string serverStats = queryStats(options);
+    release = true;
+    for (auto& thread : threads) thread.join();
+    if (failed) std::cerr << failed << " connections failed" << std::endl;
+    if (failed == options.connections) return 1;
+
+    ClientStats total;
+    for (auto& client : clients) {
+        total.moves += client->stats.moves;
+        total.games += client->stats.games;
+        total.errors += client->stats.errors;
+        total.latencyUs.insert(total.latencyUs.end(), client->stats.latencyUs.begin(), client->stats.latencyUs.end());
+    }
+    std::sort(total.latencyUs.begin(), total.latencyUs.end());
+    auto percentile = [&](double p) {
+        return total.latencyUs.empty() ? 0 : total.latencyUs[size_t(p * (total.latencyUs.size() - 1))];
+    };
+
+    std::cout << options.connections << " connections x " << options.sessions << " sessions, " << std::fixed
+              << std::setprecision(1) << seconds << " s" << std::endl;
+    std::cout << "Moves: " << total.moves << " (" << std::setprecision(0) << total.moves / seconds
+              << " moves/s), games finished: " << total.games << ", errors: " << total.errors << std::endl;
+    std::cout << "Latency us: p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << ", max "
+              << percentile(1.0) << std::endl;
+    if (!serverStats.empty()) {
+        uint64_t sessions = statValue(serverStats, "sessions");
+        uint64_t poolBytes = statValue(serverStats, "bytes");
+        uint64_t rss = statValue(serverStats, "rss");
+        std::cout << "Server: " << sessions << " sessions, pool " << poolBytes / 1024 << " KB, RSS "
+                  << rss / (1024 * 1024) << " MB" << std::endl;
+        if (sessions && poolBytes) {
+            std::cout << "Sessions per GB: pool " << (1ull << 30) / (poolBytes / sessions) << ", RSS "
+                      << (rss ? (1ull << 30) / std::max<uint64_t>(rss / sessions, 1) : 0) << std::endl;
+        }
+    }
+    return 0;
+}
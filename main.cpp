@@ -1,64 +1,144 @@
 #include <SFML/Graphics.hpp>
+#include <cstdlib>
 #include <iostream>
+#include "engine.h"
 #include "gg.h"
+#include "movegen.h"
+#include "notation.h"
 
+// Usage: main [engine ms per move]. With an engine time the engine plays
+// black on a background thread and ponders on the player's time.
+int main(int argc, char* argv[]) {
+    int64_t engineMs = argc > 1 ? atoi(argv[1]) : 0;
+    sf::RenderWindow window(sf::VideoMode(size * cellSize, size * cellSize), "Checkers");
+    // Bursts of input (window drags, resizes) never redraw faster than this
+    window.setFramerateLimit(60);
+    BoardRenderer renderer;
+    if (!renderer.create()) {
+        std::cerr << "Cannot create the board texture" << std::endl;
+        return 1;
+    }
+    GameState game;
+    initBoard(game);
+    MoveList legal;
+    generateMoves(game, legal);
+    UndoStack history;
+    int selected = -1;
+    uint8_t path[MAX_PATH];
+    int pathLength = 0;
+
+    AsyncEngine engine;
+    SearchLimits limits;
+    limits.timeMs = engineMs;
+    uint64_t awaitedSearch = 0; // Search whose best move is the engine's reply, 0 when not waiting
 
-int main() {
-    initBoard();
-    bool isMoving = false;
-    int fromX, fromY;
-    bool hasCaptured = false;
+    auto play = [&](Move move) {
+        // Once the history is full, take-backs start over from this move
+        if (!history.make(game, move)) {
+            history.clear();
+            history.make(game, move);
+        }
+        generateMoves(game, legal);
+        selected = -1;
+        pathLength = 0;
+        if (legal.empty()) {
+            std::cout << (game.currentTurn == WHITE_TURN ? "Black" : "White") << " wins" << std::endl;
+        }
+    };
 
     while (window.isOpen()) {
+        EngineEvent engineEvent;
+        while (engine.poll(engineEvent)) {
+            if (engineEvent.searchId != awaitedSearch) continue;
+            const SearchResult& result = engineEvent.result;
+            if (engineEvent.type == ENGINE_INFO) {
+                window.setTitle("Checkers - depth " + std::to_string(result.depth) + ", score " +
+                                std::to_string(result.score));
+                continue;
+            }
+            awaitedSearch = 0;
+            if (!result.hasMove) continue;
+            play(result.bestMove);
+            std::cout << "Engine: " << moveToString(result.bestMove) << std::endl;
+            // Think on the player's time about the reply the search expects
+            if (result.pv.length >= 2 && !legal.empty()) engine.ponder(game, result.pv.moves[1], limits);
+        }
+
+        int highlight = pathLength > 0 ? path[pathLength - 1] : selected;
+        renderer.update(game.board, highlight >= 0 ? squareX(highlight) : -1, highlight >= 0 ? squareY(highlight) : -1);
+        if (renderer.needsRedraw()) {
+            window.clear();
+            renderer.draw(window);
+            window.display();
+        }
+
+        // Sleep until something happens: an idle window costs no CPU or GPU time.
+        // While the engine thinks its reply arrives outside SFML, so poll instead.
         sf::Event event;
-        while (window.pollEvent(event)) {
+        if (awaitedSearch) {
+            if (!window.pollEvent(event)) {
+                sf::sleep(sf::milliseconds(10));
+                continue;
+            }
+        }
+        else if (!window.waitEvent(event)) {
+            break;
+        }
+        do {
             if (event.type == sf::Event::Closed) {
                 window.close();
             }
+            if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) {
+                renderer.invalidate();
+            }
+            // Backspace takes back the last move, or the last pair against the engine
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::BackSpace) {
+                engine.cancel();
+                awaitedSearch = 0;
+                if (history.unmake(game) && engineMs && game.currentTurn == BLACK_TURN) history.unmake(game);
+                generateMoves(game, legal);
+                selected = -1;
+                pathLength = 0;
+            }
             if (event.type == sf::Event::MouseButtonPressed) {
-                sf::Vector2i pos = getMousePositionOnBoard();
-                if (pos.x >= 0 && pos.x < size && pos.y >= 0 && pos.y < size) {
-                    if (!isMoving && board[pos.y][pos.x] != EMPTY) {
-                        if ((currentTurn == WHITE_TURN && (board[pos.y][pos.x] == WHITE || board[pos.y][pos.x] == WHITE_KING)) ||
-                            (currentTurn == BLACK_TURN && (board[pos.y][pos.x] == BLACK || board[pos.y][pos.x] == BLACK_KING))) {
-                            isMoving = true;
-                            fromX = pos.x;
-                            fromY = pos.y;
-                            hasCaptured = false;
-                        }
-                    }
-                    else if (isMoving) {
-                        sf::Vector2i newPos = getMousePositionOnBoard();
-                        bool isCapture = false;
-                        if (isValidMove(fromX, fromY, newPos.x, newPos.y, isCapture)) {
-                            makeMove(fromX, fromY, newPos.x, newPos.y, isCapture);
-                            isMoving = false;
-                            if (isCapture) {
-                                if (canCapture(newPos.x, newPos.y)) {
-                                    fromX = newPos.x;
-                                    fromY = newPos.y;
-                                    isMoving = true;
-                                    hasCaptured = true;
-                                }
-                                else {
-                                    hasCaptured = false;
-                                }
-                            }
-                            if (!hasCaptured) {
-                                currentTurn = (currentTurn == WHITE_TURN) ? BLACK_TURN : WHITE_TURN;
-                            }
-                        }
-                        else {
-                            isMoving = false;
-                        }
+                if (awaitedSearch) continue;
+                sf::Vector2i pos = getMousePositionOnBoard(window);
+                if (!isPlayableSquare(pos.x, pos.y)) continue;
+                int square = squareIndex(pos.x, pos.y);
+
+                if (pathLength == 0 && (ownPieces(game.board, game.currentTurn) & squareMask(pos.x, pos.y))) {
+                    selected = square;
+                    continue;
+                }
+                if (selected < 0) continue;
+
+                // Multi-jump captures are entered one landing square per click
+                path[pathLength++] = uint8_t(square);
+                const Move* chosen = nullptr;
+                bool partial = false;
+                for (const Move& move : legal) {
+                    if (move.from != selected || move.pathLength < pathLength) continue;
+                    bool match = true;
+                    for (int i = 0; i < pathLength; ++i) {
+                        if (move.path[i] != path[i]) match = false;
                     }
+                    if (!match) continue;
+                    if (move.pathLength == pathLength) chosen = &move;
+                    else partial = true;
                 }
-            }
-        }
 
-        window.clear();
-        drawBoard(isMoving ? fromX : -1, isMoving ? fromY : -1);
-        window.display();
+                if (chosen) {
+                    Move move = *chosen;
+                    play(move);
+                    // On a ponder hit the search already under way becomes the reply
+                    if (engineMs && !legal.empty()) awaitedSearch = engine.opponentMoved(game, move, limits);
+                }
+                else if (!partial) {
+                    selected = -1;
+                    pathLength = 0;
+                }
+            }
+        } while (window.pollEvent(event));
     }
 
     return 0;
@@ -0,0 +1,54 @@
+/**
+ * \file mappedfile.h
+ * \brief Файл, отображенный в память только для чтения.
+ *
+ * Отображение не требует загрузки: страницы читаются по первому
+ * обращению, а все процессы, открывшие один файл, делят их через
+ * страничный кеш. Используется эндшпильными базами и дебютной книгой.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+typedef void* HANDLE;
+#endif
+
+/**
+ * \brief Отображение файла в память только для чтения.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * \brief Отобразить файл.
+     * \return false, если файл не открылся, пуст или не отобразился.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * \brief Начало данных или nullptr, если файл не открыт.
+     */
+    const uint8_t* data() const { return bytes; }
+
+    /**
+     * \brief Размер файла в байтах.
+     */
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = nullptr;
+    HANDLE mapping = nullptr;
+#endif
+};
@@ -0,0 +1,278 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint32_t NOT_EXPANDED = 0; ///< Корень — ячейка 0, поэтому дети никогда не начинаются с нее
+const uint32_t EXPANDING = UINT32_MAX; ///< Узел раскрывает другой поток
+const uint32_t TERMINAL = UINT32_MAX - 1; ///< У ходящей стороны нет ходов
+
+const int MAX_TREE_DEPTH = 256;
+const double UCT_EXPLORATION = 0.7;
+const double PUCT_EXPLORATION = 1.5;
+const double PRIOR_TEMPERATURE = 60; ///< Оценки ходов в сотых шашки переводятся в вероятности как exp(score / T)
+const int PLAYOUT_MARGIN = 60; ///< Оценка в конце случайной партии, начиная с которой она считается выигранной
+const int PLAYOUT_MAX_EXTENSION = 32; ///< Сколько еще полуходов ждать спокойной позиции
+
+/**
+ * \brief Генератор xorshift64* — свой у каждого потока.
+ */
+inline uint64_t nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+} // namespace
+
+/**
+ * \brief Узел дерева, 16 байт.
+ *
+ * visits включает спуски, которые еще не закончились, а score — только
+ * законченные партии, поэтому идущий через узел спуск временно снижает
+ * его средний результат (виртуальный проигрыш).
+ */
+struct MctsSearcher::Node {
+    std::atomic<uint32_t> visits; ///< Партии через узел, включая еще не сыгранные
+    std::atomic<uint32_t> score; ///< Полуочки стороны, сделавшей ход в узел
+    std::atomic<uint32_t> children; ///< Первый ребенок в арене, NOT_EXPANDED, EXPANDING или TERMINAL
+    uint16_t count; ///< Число детей; записывается до публикации children
+    uint16_t prior; ///< Априорная вероятность хода в узел, умноженная на 65535 (для PUCT)
+
+    void reset(uint16_t probability) {
+        visits.store(0, std::memory_order_relaxed);
+        score.store(0, std::memory_order_relaxed);
+        children.store(NOT_EXPANDED, std::memory_order_relaxed);
+        count = 0;
+        prior = probability;
+    }
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == 4, "tree nodes assume lock-free 32-bit atomics");
+
+MctsSearcher::MctsSearcher()
+    : nodeCapacity(0), used(0), playoutCount(0), stopFlag(false), threads(1), batch(8), playoutPlies(12),
+      policy(MCTS_PUCT) {
+    setMemory(64);
+}
+
+MctsSearcher::~MctsSearcher() = default;
+
+size_t MctsSearcher::bytesPerNode() {
+    return sizeof(Node);
+}
+
+void MctsSearcher::setThreads(int count) {
+    threads = std::max(1, count);
+}
+
+void MctsSearcher::setMemory(size_t megabytes) {
+    nodeCapacity = std::max<size_t>(megabytes, 1) * (size_t(1) << 20) / sizeof(Node);
+    nodeCapacity = std::min<size_t>(nodeCapacity, TERMINAL - 1);
+    nodes.reset(new Node[nodeCapacity]);
+}
+
+void MctsSearcher::setBatch(int playouts) {
+    batch = std::min(std::max(playouts, 1), 64);
+}
+
+int64_t MctsSearcher::elapsedMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool MctsSearcher::expand(Node& node, const GameState& state) {
+    uint32_t expected = NOT_EXPANDED;
+    if (used.load(std::memory_order_relaxed) >= nodeCapacity ||
+        !node.children.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire)) {
+        return false;
+    }
+    MoveList list;
+    generateMoves(state, list);
+    if (list.empty()) {
+        node.children.store(TERMINAL, std::memory_order_release);
+        return true;
+    }
+    uint64_t first = used.fetch_add(uint64_t(list.size()), std::memory_order_relaxed);
+    if (first + uint64_t(list.size()) > nodeCapacity) {
+        // Арена заполнена: узел остается листом
+        node.children.store(NOT_EXPANDED, std::memory_order_release);
+        return false;
+    }
+
+    uint16_t priors[MAX_MOVES];
+    if (policy == MCTS_PUCT) {
+        // Априорные вероятности — мягкий максимум оценок позиций после хода
+        double scores[MAX_MOVES];
+        double best = -1e9;
+        for (int i = 0; i < list.size(); ++i) {
+            GameState next = state;
+            makeMove(next, list[i]);
+            scores[i] = -evaluate(next, weights);
+            best = std::max(best, scores[i]);
+        }
+        double sum = 0;
+        for (int i = 0; i < list.size(); ++i) {
+            scores[i] = std::exp((scores[i] - best) / PRIOR_TEMPERATURE);
+            sum += scores[i];
+        }
+        for (int i = 0; i < list.size(); ++i) priors[i] = uint16_t(std::max(1.0, std::round(65535 * scores[i] / sum)));
+    }
+    else {
+        std::fill(priors, priors + list.size(), uint16_t(0));
+    }
+    for (int i = 0; i < list.size(); ++i) nodes[size_t(first) + size_t(i)].reset(priors[i]);
+    node.count = uint16_t(list.size());
+    node.children.store(uint32_t(first), std::memory_order_release);
+    return true;
+}
+
+int MctsSearcher::selectChild(const Node& node) const {
+    const Node* children = &nodes[node.children.load(std::memory_order_acquire)];
+    double parentVisits = std::max<uint32_t>(node.visits.load(std::memory_order_relaxed), 1);
+    double logVisits = std::log(parentVisits);
+    double sqrtVisits = std::sqrt(parentVisits);
+    int best = 0;
+    double bestValue = -1e300;
+    for (int i = 0; i < node.count; ++i) {
+        uint32_t n = children[i].visits.load(std::memory_order_relaxed);
+        double mean = n ? children[i].score.load(std::memory_order_relaxed) / (2.0 * n) : 0.5;
+        double value;
+        if (policy == MCTS_UCT) {
+            if (n == 0) return i;
+            value = mean + UCT_EXPLORATION * std::sqrt(logVisits / n);
+        }
+        else {
+            value = mean + PUCT_EXPLORATION * (children[i].prior / 65535.0) * sqrtVisits / (1 + n);
+        }
+        if (value > bestValue) {
+            bestValue = value;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int MctsSearcher::playout(GameState state, uint64_t& random) const {
+    // Результат в полуочках для стороны, ходящей в начале партии
+    MoveList list;
+    for (int ply = 0;; ++ply) {
+        generateMoves(state, list);
+        if (list.empty()) return ply % 2 ? 2 : 0;
+        bool quiet = list[0].captured == 0;
+        if ((ply >= playoutPlies && quiet) || ply >= playoutPlies + PLAYOUT_MAX_EXTENSION) {
+            int score = evaluate(state, weights);
+            int result = score >= PLAYOUT_MARGIN ? 2 : score <= -PLAYOUT_MARGIN ? 0 : 1;
+            return ply % 2 ? 2 - result : result;
+        }
+        uint64_t pick = (nextRandom(random) >> 32) * uint64_t(list.size()) >> 32;
+        makeMove(state, list[int(pick)]);
+    }
+}
+
+void MctsSearcher::work(int id) {
+    uint64_t random = 0x9E3779B97F4A7C15ull * uint64_t(id + 1);
+    uint32_t path[MAX_TREE_DEPTH];
+    MoveList list;
+    for (uint64_t iteration = 0;; ++iteration) {
+        if (stopFlag.load(std::memory_order_relaxed)) break;
+        uint64_t played = playoutCount.load(std::memory_order_relaxed);
+        if (limits.playouts && played >= limits.playouts) break;
+        if (limits.timeMs && (iteration & 15) == 0 && elapsedMs() >= limits.timeMs) break;
+        if (!limits.playouts && !limits.timeMs && used.load(std::memory_order_relaxed) >= nodeCapacity) break;
+
+        // Спуск: к посещениям каждого узла пути сразу добавляется вся пачка
+        GameState state = root;
+        int depth = 0;
+        path[0] = 0;
+        nodes[0].visits.fetch_add(uint32_t(batch), std::memory_order_relaxed);
+        bool terminal = false;
+        while (depth < MAX_TREE_DEPTH - 1) {
+            Node& node = nodes[path[depth]];
+            uint32_t first = node.children.load(std::memory_order_acquire);
+            if (first == NOT_EXPANDED) {
+                // Узел раскрывается при втором посещении: одиночные листья не тратят арену
+                if (node.visits.load(std::memory_order_relaxed) < 2 * uint32_t(batch) || !expand(node, state)) break;
+                first = node.children.load(std::memory_order_acquire);
+            }
+            if (first == TERMINAL) {
+                terminal = true;
+                break;
+            }
+            if (first == EXPANDING || first == NOT_EXPANDED) break;
+            int child = selectChild(node);
+            generateMoves(state, list);
+            makeMove(state, list[child]);
+            path[++depth] = first + uint32_t(child);
+            nodes[path[depth]].visits.fetch_add(uint32_t(batch), std::memory_order_relaxed);
+        }
+
+        // Полуочки ходящей в листе стороны за всю пачку
+        uint32_t total = 0;
+        if (!terminal) {
+            for (int i = 0; i < batch; ++i) total += uint32_t(playout(state, random));
+        }
+        uint32_t full = 2 * uint32_t(batch);
+        for (int d = depth; d >= 0; --d) {
+            total = full - total; // Счет узла — для стороны, сделавшей ход в него
+            nodes[path[d]].score.fetch_add(total, std::memory_order_relaxed);
+        }
+        playoutCount.fetch_add(uint64_t(batch), std::memory_order_relaxed);
+    }
+}
+
+MctsResult MctsSearcher::search(const GameState& state, const MctsLimits& searchLimits) {
+    startTime = std::chrono::steady_clock::now();
+    limits = searchLimits;
+    root = state;
+    stopFlag = false;
+    playoutCount = 0;
+    used = 1;
+    nodes[0].reset(0);
+
+    MctsResult result;
+    result.threads = threads;
+    if (!expand(nodes[0], root) || nodes[0].children.load() == TERMINAL) return result;
+    result.hasMove = true;
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; ++i) helpers.emplace_back([this, i] { work(i); });
+    work(0);
+    stopFlag = true;
+    for (auto& helper : helpers) helper.join();
+
+    // Главный путь: самые посещаемые дети, пока узлы раскрыты
+    GameState position = root;
+    const Node* node = &nodes[0];
+    MoveList list;
+    while (result.pvLength < int(sizeof(result.pv) / sizeof(result.pv[0]))) {
+        uint32_t first = node->children.load();
+        if (first == NOT_EXPANDED || first == EXPANDING || first == TERMINAL) break;
+        int best = 0;
+        for (int i = 1; i < node->count; ++i) {
+            if (nodes[first + uint32_t(i)].visits.load() > nodes[first + uint32_t(best)].visits.load()) best = i;
+        }
+        const Node& child = nodes[first + uint32_t(best)];
+        if (child.visits.load() == 0) break;
+        generateMoves(position, list);
+        result.pv[result.pvLength++] = list[best];
+        if (result.pvLength == 1) {
+            result.bestMove = list[best];
+            result.value = child.score.load() / (2.0 * child.visits.load());
+        }
+        makeMove(position, list[best]);
+        node = &child;
+    }
+    if (result.pvLength == 0) {
+        generateMoves(root, list);
+        result.bestMove = list[0];
+    }
+    result.playouts = playoutCount.load();
+    result.nodes = std::min<uint64_t>(used.load(), nodeCapacity);
+    result.timeMs = elapsedMs();
+    return result;
+}
@@ -0,0 +1,136 @@
+/**
+ * \file mcts.h
+ * \brief Перебор Монте-Карло по дереву (UCT или PUCT), параллельный по дереву.
+ *
+ * Узлы дерева лежат в заранее выделенном массиве (арене): дети узла
+ * занимают подряд идущие ячейки, выделяемые одним атомарным сложением,
+ * а ход ребенка — его номер в списке generateMoves() родителя, так что
+ * узел не хранит ход и занимает 16 байт. Потоки спускаются по одному
+ * дереву без блокировок: статистика узлов атомарна, раскрывает узел тот
+ * поток, который первым пометил его, а на время спуска к посещениям
+ * узлов пути сразу добавляются будущие партии (виртуальный проигрыш),
+ * чтобы другие потоки выбирали другие ветви.
+ *
+ * У листа играется пачка случайных партий; партия обрывается после
+ * заданного числа полуходов (в спокойной позиции) и оценивается по
+ * статической оценке.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "eval.h"
+#include "movegen.h"
+
+/// Правило выбора хода при спуске.
+enum MctsPolicy {
+    MCTS_UCT, ///< UCB1: каждый ход пробуется хотя бы раз, затем среднее плюс бонус за редкость
+    MCTS_PUCT ///< Как в AlphaZero: бонус пропорционален априорной вероятности хода по оценке
+};
+
+/**
+ * \brief Ограничения перебора (0 — нет ограничения; без обоих — до заполнения арены).
+ */
+struct MctsLimits {
+    uint64_t playouts = 0; ///< Число случайных партий
+    int64_t timeMs = 0; ///< Время в миллисекундах
+};
+
+/**
+ * \brief Итог перебора.
+ */
+struct MctsResult {
+    Move bestMove; ///< Ход с наибольшим числом посещений
+    bool hasMove = false; ///< Есть ли допустимые ходы
+    double value = 0.5; ///< Средний результат лучшего хода для ходящей стороны (0 — проигрыш, 1 — выигрыш)
+    uint64_t playouts = 0; ///< Сыграно случайных партий
+    uint64_t nodes = 0; ///< Узлов в дереве
+    int64_t timeMs = 0; ///< Затраченное время
+    int threads = 1; ///< Число потоков
+    Move pv[16]; ///< Путь по самым посещаемым ходам
+    int pvLength = 0;
+};
+
+/**
+ * \brief Перебор Монте-Карло. Один объект ведет один перебор за раз.
+ */
+class MctsSearcher {
+public:
+    MctsSearcher();
+    ~MctsSearcher();
+
+    MctsSearcher(const MctsSearcher&) = delete;
+    MctsSearcher& operator=(const MctsSearcher&) = delete;
+
+    /**
+     * \brief Найти ход. Дерево строится заново.
+     */
+    MctsResult search(const GameState& state, const MctsLimits& limits);
+
+    /**
+     * \brief Прервать перебор (из другого потока).
+     */
+    void stop() { stopFlag = true; }
+
+    /**
+     * \brief Число потоков, включая вызвавший search().
+     */
+    void setThreads(int count);
+
+    /**
+     * \brief Размер арены узлов в мегабайтах.
+     */
+    void setMemory(size_t megabytes);
+
+    void setPolicy(MctsPolicy policy) { this->policy = policy; }
+
+    /**
+     * \brief Сколько случайных партий играть у листа за один спуск (1..64).
+     */
+    void setBatch(int playouts);
+
+    /**
+     * \brief Сколько полуходов играть в случайной партии до оценки.
+     */
+    void setPlayoutPlies(int plies) { playoutPlies = plies < 0 ? 0 : plies; }
+
+    void setEvalWeights(const EvalWeights& weights) { this->weights = weights; }
+
+    /**
+     * \brief Вместимость арены в узлах.
+     */
+    size_t capacity() const { return nodeCapacity; }
+
+    /**
+     * \brief Размер одного узла в байтах.
+     */
+    static size_t bytesPerNode();
+
+private:
+    struct Node;
+
+    void work(int id);
+    bool expand(Node& node, const GameState& state);
+    int selectChild(const Node& node) const;
+    int playout(GameState state, uint64_t& random) const;
+    int64_t elapsedMs() const;
+
+    std::unique_ptr<Node[]> nodes;
+    size_t nodeCapacity;
+    std::atomic<uint64_t> used; ///< Занятые ячейки арены
+    std::atomic<uint64_t> playoutCount;
+    std::atomic<bool> stopFlag;
+    GameState root;
+    MctsLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    int threads;
+    int batch;
+    int playoutPlies;
+    MctsPolicy policy;
+    EvalWeights weights;
+};
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchsuite.h"
+#include "mcts.h"
+#include "notation.h"
+#include "search.h"
+
+/**
+ * \brief Перебор Монте-Карло на постоянном наборе позиций: скорость
+ * случайных партий при разном числе потоков и сравнение с альфа-бетой.
+ *
+ * На каждую позицию оба перебора получают одно и то же время и число
+ * потоков. Печатаются партии в секунду, их рост относительно первого
+ * числа потоков в списке, размер дерева и память на узел, а также
+ * сколько раз ход Монте-Карло совпал с ходом альфа-беты и сколько узлов
+ * в секунду за то же время перебрала альфа-бета.
+ *
+ * Использование: mctsbench [-t мс на позицию] [-p uct|puct] [-b партий у листа]
+ *   [-m мегабайты] [-v] [потоки...]
+ * (по умолчанию 1000 мс, puct, 8 партий, 256 МБ и потоки 1 2 4 8)
+ */
+int main(int argc, char* argv[]) {
+    int64_t timeMs = 1000;
+    MctsPolicy policy = MCTS_PUCT;
+    int batch = 8;
+    size_t memoryMb = 256;
+    bool verbose = false;
+    std::vector<int> threadCounts;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            timeMs = atoll(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name != "uct" && name != "puct") {
+                std::cerr << "Unknown policy: " << name << std::endl;
+                return 1;
+            }
+            policy = name == "uct" ? MCTS_UCT : MCTS_PUCT;
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            memoryMb = size_t(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        }
+        else {
+            int count = atoi(argv[i]);
+            if (count < 1 || count > MAX_THREADS) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+            threadCounts.push_back(count);
+        }
+    }
+    if (threadCounts.empty()) threadCounts = {1, 2, 4, 8};
+    if (timeMs < 1 || batch < 1 || memoryMb < 1) {
+        std::cerr << "Invalid arguments" << std::endl;
+        return 1;
+    }
+
+    MctsSearcher mcts;
+    mcts.setMemory(memoryMb);
+    mcts.setPolicy(policy);
+    mcts.setBatch(batch);
+    Searcher alphaBeta;
+    alphaBeta.setHashSize(memoryMb);
+    std::cout << (policy == MCTS_UCT ? "UCT" : "PUCT") << ", " << timeMs << " ms per position, batch " << batch
+              << ", " << mcts.capacity() << " nodes of " << MctsSearcher::bytesPerNode() << " bytes, "
+              << BENCH_POSITION_COUNT << " positions" << std::endl;
+    std::cout << "threads   playouts  playouts/s  scaling   max nodes  tree MB  same move  alpha-beta nodes/s"
+              << std::endl;
+
+    double basePlayoutRate = 0;
+    for (int count : threadCounts) {
+        mcts.setThreads(count);
+        alphaBeta.setThreads(count);
+        uint64_t playouts = 0, maxNodes = 0, alphaBetaNodes = 0;
+        double mctsSeconds = 0, alphaBetaSeconds = 0;
+        int agree = 0;
+        for (const char* fen : BENCH_POSITIONS) {
+            GameState game;
+            parseFen(fen, game);
+            MctsLimits mctsLimits;
+            mctsLimits.timeMs = timeMs;
+            MctsResult mctsResult = mcts.search(game, mctsLimits);
+            playouts += mctsResult.playouts;
+            maxNodes = std::max(maxNodes, mctsResult.nodes);
+            mctsSeconds += mctsResult.timeMs / 1000.0;
+
+            alphaBeta.clear();
+            SearchLimits limits;
+            limits.timeMs = timeMs;
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result = alphaBeta.search(game, limits);
+            alphaBetaSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            alphaBetaNodes += result.nodes;
+            bool same = mctsResult.bestMove.from == result.bestMove.from && mctsResult.bestMove.to == result.bestMove.to;
+            agree += same;
+            if (verbose) {
+                std::cout << "  " << std::setw(52) << std::left << fen << std::right << " mcts "
+                          << moveToString(mctsResult.bestMove) << " (" << std::fixed << std::setprecision(3)
+                          << mctsResult.value << std::defaultfloat << ", " << mctsResult.playouts << " playouts)"
+                          << " alpha-beta " << moveToString(result.bestMove) << " score " << result.score << std::endl;
+            }
+        }
+        double playoutRate = playouts / (mctsSeconds > 0 ? mctsSeconds : 1e-9);
+        if (basePlayoutRate == 0) basePlayoutRate = playoutRate;
+        std::cout << std::setw(7) << count << std::setw(11) << playouts << std::setw(12) << uint64_t(playoutRate)
+                  << std::fixed << std::setprecision(2) << std::setw(9) << playoutRate / basePlayoutRate
+                  << std::setw(12) << maxNodes << std::setw(9)
+                  << maxNodes * MctsSearcher::bytesPerNode() / double(1 << 20) << std::setw(7) << agree << "/"
+                  << BENCH_POSITION_COUNT << std::setw(20)
+                  << uint64_t(alphaBetaNodes / (alphaBetaSeconds > 0 ? alphaBetaSeconds : 1e-9)) << std::defaultfloat
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,312 @@
+#include "movegen.h"
+
+#include "profile.h"
+#include "zobrist.h"
+
+namespace {
+
+/**
+ * \brief Данные, общие для всех прыжков одной цепочки взятия.
+ */
+struct CaptureContext {
+    MoveList* list;
+    Bitboard enemy; ///< Фигуры соперника
+    Bitboard empty; ///< Свободные поля (начальное поле бьющей фигуры считается свободным)
+    Bitboard promotionRow; ///< Ряд превращения бьющей стороны
+    uint8_t from; ///< Начальное поле бьющей фигуры
+    uint8_t path[MAX_PATH]; ///< Поля приземления текущей цепочки
+};
+
+void addMove(MoveList& list, const Move& move) {
+    if (move.captured) {
+        for (int i = 0; i < list.count; ++i) {
+            if (sameMove(list.moves[i], move)) return;
+        }
+    }
+    if (list.count < MAX_MOVES) {
+        list.moves[list.count++] = move;
+    }
+}
+
+void emitCapture(CaptureContext& ctx, int square, int depth, Bitboard captured, bool promoted) {
+    Move move;
+    move.captured = captured;
+    move.from = ctx.from;
+    move.to = uint8_t(square);
+    move.pathLength = uint8_t(depth);
+    move.promotes = promoted;
+    for (int i = 0; i < depth; ++i) {
+        move.path[i] = ctx.path[i];
+    }
+    addMove(*ctx.list, move);
+}
+
+/**
+ * \brief Может ли фигура на поле sq продолжить взятие.
+ */
+bool canContinue(const CaptureContext& ctx, Bitboard sq, bool king, Bitboard captured) {
+    Bitboard targets = ctx.enemy & ~captured;
+    if (king) return kingCanCapture(lowestSquare(sq), targets, ctx.empty);
+    for (int d = 0; d < 4; ++d) {
+        Direction dir = Direction(d);
+        Bitboard b = shift(sq, dir);
+        if ((b & targets) && (shift(b, dir) & ctx.empty)) return true;
+    }
+    return false;
+}
+
+void addJumps(CaptureContext& ctx, Bitboard sq, bool king, Bitboard captured, int depth, bool promoted);
+
+/**
+ * \brief Продолжить цепочку после приземления на поле to.
+ */
+void land(CaptureContext& ctx, Bitboard to, bool king, Bitboard captured, int depth, bool promoted) {
+    if (!king && (to & ctx.promotionRow)) {
+        king = true;
+        promoted = true;
+    }
+    ctx.path[depth] = uint8_t(lowestSquare(to));
+    if (depth + 1 < MAX_PATH && canContinue(ctx, to, king, captured)) {
+        addJumps(ctx, to, king, captured, depth + 1, promoted);
+    }
+    else {
+        emitCapture(ctx, lowestSquare(to), depth + 1, captured, promoted);
+    }
+}
+
+void addJumps(CaptureContext& ctx, Bitboard sq, bool king, Bitboard captured, int depth, bool promoted) {
+    Bitboard targets = ctx.enemy & ~captured;
+    int s = lowestSquare(sq);
+    for (int d = 0; d < 4; ++d) {
+        Direction dir = Direction(d);
+        Bitboard victim;
+        if (king) {
+            int v = firstBlocker(s, dir, ctx.empty);
+            victim = v >= 0 ? Bitboard(1) << v : 0;
+        }
+        else {
+            victim = shift(sq, dir);
+        }
+        if (!(victim & targets)) continue;
+        Bitboard after = captured | victim;
+
+        if (!king) {
+            Bitboard to = shift(victim, dir) & ctx.empty;
+            if (to) land(ctx, to, false, after, depth, promoted);
+            continue;
+        }
+
+        // Дамка может встать на любое свободное поле за взятой фигурой,
+        // но если с какого-то из них взятие продолжается, остановиться нельзя
+        Bitboard landings = slide(lowestSquare(victim), dir, ctx.empty);
+        Bitboard continuing = 0;
+        for (Bitboard rest = landings; rest; rest &= rest - 1) {
+            Bitboard to = rest & (0 - rest);
+            if (canContinue(ctx, to, true, after)) continuing |= to;
+        }
+        Bitboard chosen = continuing ? continuing : landings;
+        for (Bitboard rest = chosen; rest; rest &= rest - 1) {
+            land(ctx, Bitboard(1) << lowestSquare(rest), true, after, depth, promoted);
+        }
+    }
+}
+
+void addQuietMoves(const Position& board, Turn side, MoveList& list, Bitboard men, Bitboard kings) {
+    Bitboard empty = emptySquares(board);
+    Bitboard promotionRow = side == WHITE_TURN ? TOP_ROW : BOTTOM_ROW;
+    Move move;
+    move.captured = 0;
+    move.pathLength = 1;
+
+    Direction forward[2];
+    if (side == WHITE_TURN) {
+        forward[0] = UP_LEFT;
+        forward[1] = UP_RIGHT;
+    }
+    else {
+        forward[0] = DOWN_LEFT;
+        forward[1] = DOWN_RIGHT;
+    }
+    for (Direction dir : forward) {
+        Direction back = opposite(dir);
+        for (Bitboard targets = shift(men, dir) & empty; targets; targets &= targets - 1) {
+            Bitboard to = targets & (0 - targets);
+            move.from = uint8_t(lowestSquare(shift(to, back)));
+            move.to = uint8_t(lowestSquare(to));
+            move.path[0] = move.to;
+            move.promotes = (to & promotionRow) != 0;
+            addMove(list, move);
+        }
+    }
+
+    move.promotes = 0;
+    for (; kings; kings &= kings - 1) {
+        move.from = uint8_t(lowestSquare(kings));
+        for (int d = 0; d < 4; ++d) {
+            for (Bitboard to = slide(move.from, Direction(d), empty); to; to &= to - 1) {
+                move.to = uint8_t(lowestSquare(to));
+                move.path[0] = move.to;
+                addMove(list, move);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void generateCaptures(const GameState& state, MoveList& list) {
+    PROFILE_SCOPE(PROFILE_GENERATE_CAPTURES);
+    list.clear();
+    const Position& board = state.board;
+    Turn side = state.currentTurn;
+    CaptureContext ctx;
+    ctx.list = &list;
+    ctx.enemy = enemyPieces(board, side);
+    ctx.promotionRow = side == WHITE_TURN ? TOP_ROW : BOTTOM_ROW;
+    for (Bitboard rest = state.capturers[side]; rest; rest &= rest - 1) {
+        Bitboard from = rest & (0 - rest);
+        ctx.from = uint8_t(lowestSquare(from));
+        ctx.empty = emptySquares(board) | from;
+        addJumps(ctx, from, (board.kings & from) != 0, 0, 0, false);
+    }
+}
+
+void generateMoves(const GameState& state, MoveList& list) {
+    PROFILE_SCOPE(PROFILE_GENERATE_MOVES);
+    generateCaptures(state, list);
+    if (!list.empty()) return;
+
+    const Position& board = state.board;
+    Bitboard own = ownPieces(board, state.currentTurn);
+    addQuietMoves(board, state.currentTurn, list, own & ~board.kings, own & board.kings);
+}
+
+namespace {
+
+/**
+ * \brief Обновить карту взятий стороны side после хода, изменившего поля changed.
+ *
+ * Дамка могла начать или перестать бить, только если на одной из ее
+ * диагоналей сменилось содержимое поля; остальные дамки сохраняют
+ * прежнее значение карты.
+ */
+inline Bitboard updatedCapturers(const Position& board, Turn side, Bitboard previous, Bitboard affected) {
+    Bitboard own = ownPieces(board, side);
+    Bitboard enemy = enemyPieces(board, side);
+    Bitboard empty = emptySquares(board);
+    Bitboard result = adjacentJumpers(own, enemy, empty);
+    Bitboard kings = own & board.kings;
+    result |= previous & kings & ~affected;
+    for (Bitboard rest = kings & affected & ~result; rest; rest &= rest - 1) {
+        int s = lowestSquare(rest);
+        if (kingCanCapture(s, enemy, empty)) result |= Bitboard(1) << s;
+    }
+    return result;
+}
+
+/**
+ * \brief Поля, дамки на которых нужно проверить заново после изменения полей changed.
+ */
+inline Bitboard affectedSquares(const Position& board, Bitboard changed) {
+    if (!board.kings) return 0;
+    Bitboard affected = changed;
+    for (Bitboard rest = changed; rest; rest &= rest - 1) {
+        int s = lowestSquare(rest);
+        affected |= RAYS.ray[UP_LEFT][s] | RAYS.ray[UP_RIGHT][s] | RAYS.ray[DOWN_LEFT][s] | RAYS.ray[DOWN_RIGHT][s];
+    }
+    return affected;
+}
+
+/**
+ * \brief Общая часть обоих вариантов makeMove(); undo может быть nullptr.
+ */
+inline void applyMove(GameState& state, const Move& move, Undo* undo) {
+    PROFILE_COUNT(PROFILE_MAKE_MOVE);
+    Position& board = state.board;
+    Bitboard from = Bitboard(1) << move.from;
+    Bitboard to = Bitboard(1) << move.to;
+    bool wasKing = (board.kings & from) != 0;
+    bool king = wasKing || move.promotes;
+    bool white = state.currentTurn == WHITE_TURN;
+
+    uint64_t delta = ZOBRIST.blackToMove;
+    delta ^= zobristKey(white ? (wasKing ? WHITE_KING : WHITE) : (wasKing ? BLACK_KING : BLACK), move.from);
+    delta ^= zobristKey(white ? (king ? WHITE_KING : WHITE) : (king ? BLACK_KING : BLACK), move.to);
+    for (Bitboard rest = move.captured; rest; rest &= rest - 1) {
+        int s = lowestSquare(rest);
+        bool capturedKing = (board.kings >> s) & 1;
+        delta ^= zobristKey(white ? (capturedKing ? BLACK_KING : BLACK) : (capturedKing ? WHITE_KING : WHITE), s);
+    }
+
+    if (undo) {
+        undo->hashDelta = delta;
+        undo->capturers[0] = state.capturers[0];
+        undo->capturers[1] = state.capturers[1];
+        undo->captured = move.captured;
+        undo->capturedKings = board.kings & move.captured;
+        undo->from = move.from;
+        undo->to = move.to;
+        undo->wasKing = wasKing;
+        undo->promoted = move.promotes;
+    }
+
+    Bitboard& own = white ? board.white : board.black;
+    Bitboard& enemy = white ? board.black : board.white;
+    own = (own & ~from) | to;
+    enemy &= ~move.captured;
+    board.kings &= ~(from | move.captured);
+    if (king) board.kings |= to;
+
+    Bitboard affected = affectedSquares(board, from | to | move.captured);
+    state.capturers[WHITE_TURN] = updatedCapturers(board, WHITE_TURN, state.capturers[WHITE_TURN], affected);
+    state.capturers[BLACK_TURN] = updatedCapturers(board, BLACK_TURN, state.capturers[BLACK_TURN], affected);
+    state.currentTurn = white ? BLACK_TURN : WHITE_TURN;
+    state.hash ^= delta;
+}
+
+} // namespace
+
+void makeMove(GameState& state, const Move& move) {
+    applyMove(state, move, nullptr);
+}
+
+void makeMove(GameState& state, const Move& move, Undo& undo) {
+    applyMove(state, move, &undo);
+}
+
+void unmakeMove(GameState& state, const Undo& undo) {
+    PROFILE_COUNT(PROFILE_UNMAKE_MOVE);
+    Position& board = state.board;
+    Bitboard from = Bitboard(1) << undo.from;
+    Bitboard to = Bitboard(1) << undo.to;
+    state.currentTurn = state.currentTurn == WHITE_TURN ? BLACK_TURN : WHITE_TURN;
+    state.hash ^= undo.hashDelta;
+    state.capturers[0] = undo.capturers[0];
+    state.capturers[1] = undo.capturers[1];
+
+    // Дамка может закончить взятие на своем начальном поле, поэтому
+    // сначала снимается конечное поле, а потом ставится начальное
+    bool white = state.currentTurn == WHITE_TURN;
+    Bitboard& own = white ? board.white : board.black;
+    Bitboard& enemy = white ? board.black : board.white;
+    own = (own & ~to) | from;
+    enemy |= undo.captured;
+    board.kings = (board.kings & ~to) | undo.capturedKings;
+    if (undo.wasKing) board.kings |= from;
+}
+
+// Состояние невелико, поэтому его копирование дешевле записи отмены:
+// perft остается на копиях, а make/unmake нужен там, где копий быть не должно
+uint64_t perft(const GameState& state, int depth) {
+    MoveList list;
+    generateMoves(state, list);
+    if (depth <= 1) return depth == 1 ? list.size() : 1;
+
+    uint64_t nodes = 0;
+    for (const Move& move : list) {
+        GameState next = state;
+        makeMove(next, move);
+        nodes += perft(next, depth - 1);
+    }
+    return nodes;
+}
@@ -0,0 +1,170 @@
+/**
+ * \file movegen.h
+ * \brief Генерация всех допустимых ходов стороны, имеющей очередь хода.
+ *
+ * Ход со взятием содержит всю цепочку прыжков целиком: поля приземления
+ * и маску взятых фигур. Взятие обязательно; начатое взятие продолжается,
+ * пока это возможно. Взятые фигуры снимаются только после окончания хода
+ * и повторно их бить нельзя. Простая шашка, дошедшая до последнего ряда
+ * во время взятия, продолжает бить уже как дамка.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "rules.h"
+
+const int MAX_MOVES = 256; ///< Вместимость списка ходов
+const int MAX_PATH = 12; ///< Наибольшее число прыжков в одном ходе
+
+/**
+ * \brief Ход: начальное поле, поля приземления и взятые фигуры.
+ */
+struct Move {
+    Bitboard captured; ///< Поля взятых фигур (0 для тихого хода)
+    uint8_t from; ///< Номер начального поля
+    uint8_t to; ///< Номер конечного поля
+    uint8_t pathLength; ///< Число полей приземления (1 для тихого хода)
+    uint8_t promotes; ///< Шашка становится дамкой
+    uint8_t path[MAX_PATH]; ///< Поля приземления по порядку, последнее равно to
+};
+
+/**
+ * \brief Список ходов фиксированной вместимости без выделения памяти.
+ */
+struct MoveList {
+    Move moves[MAX_MOVES]; ///< Ходы
+    int count = 0; ///< Число ходов в списке
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    Move& operator[](int i) { return moves[i]; }
+    const Move& operator[](int i) const { return moves[i]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+/**
+ * \brief Является ли ход взятием.
+ */
+inline bool isCapture(const Move& move) {
+    return move.captured != 0;
+}
+
+/**
+ * \brief Сравнение ходов по результату: начальное и конечное поле и взятые фигуры.
+ */
+inline bool sameMove(const Move& a, const Move& b) {
+    return a.from == b.from && a.to == b.to && a.captured == b.captured;
+}
+
+/**
+ * \brief Сгенерировать все допустимые ходы стороны, имеющей очередь хода.
+ *
+ * Если есть взятия, в список попадают только они. Цепочки, отличающиеся
+ * лишь порядком прыжков и дающие одинаковую позицию, добавляются один раз.
+ * \param state Состояние партии
+ * \param list Список, в который записываются ходы (предыдущее содержимое стирается)
+ */
+void generateMoves(const GameState& state, MoveList& list);
+
+/**
+ * \brief Сгенерировать только взятия.
+ * \param state Состояние партии
+ * \param list Список, в который записываются ходы (предыдущее содержимое стирается)
+ */
+void generateCaptures(const GameState& state, MoveList& list);
+
+/**
+ * \brief Все, что нужно для отмены хода: поля, взятые фигуры, превращение и изменение хеша.
+ */
+struct Undo {
+    uint64_t hashDelta; ///< Хеш до хода XOR хеш после хода
+    Bitboard capturers[2]; ///< Карты взятий до хода
+    Bitboard captured; ///< Взятые фигуры
+    Bitboard capturedKings; ///< Дамки среди взятых фигур
+    uint8_t from; ///< Начальное поле
+    uint8_t to; ///< Конечное поле
+    uint8_t wasKing; ///< Ходила дамка
+    uint8_t promoted; ///< Шашка стала дамкой
+};
+
+/**
+ * \brief Выполнить ход из списка, сгенерированного для этого состояния, и передать очередь.
+ *
+ * Карты взятий обновляются по измененным полям: шашки проверяются все
+ * сразу сдвигом масок, а дамки — только те, что стоят на диагоналях,
+ * проходящих через начальное, конечное и взятые поля.
+ * \param state Состояние партии
+ * \param move Ход
+ */
+void makeMove(GameState& state, const Move& move);
+
+/**
+ * \brief Выполнить ход и записать данные для его отмены.
+ * \param state Состояние партии
+ * \param move Ход
+ * \param undo Запись для unmakeMove()
+ */
+void makeMove(GameState& state, const Move& move, Undo& undo);
+
+/**
+ * \brief Отменить ход, выполненный makeMove() с записью undo.
+ *
+ * Ходы отменяются в обратном порядке; состояние, включая хеш,
+ * восстанавливается в точности.
+ */
+void unmakeMove(GameState& state, const Undo& undo);
+
+const int MAX_GAME_PLY = 1024; ///< Вместимость стека отмены
+
+/**
+ * \brief Стек сыгранных ходов с записями отмены; память выделена заранее.
+ */
+class UndoStack {
+public:
+    /**
+     * \brief Выполнить ход и положить его в стек.
+     * \return false, если стек полон (ход не выполняется).
+     */
+    bool make(GameState& state, const Move& move) {
+        if (count == MAX_GAME_PLY) return false;
+        moves[count] = move;
+        makeMove(state, move, records[count]);
+        ++count;
+        return true;
+    }
+
+    /**
+     * \brief Отменить последний ход.
+     * \return false, если стек пуст.
+     */
+    bool unmake(GameState& state) {
+        if (count == 0) return false;
+        unmakeMove(state, records[--count]);
+        return true;
+    }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    const Move& operator[](int i) const { return moves[i]; } ///< Ход номер i от начала
+    const Move& last() const { return moves[count - 1]; }
+
+private:
+    Move moves[MAX_GAME_PLY];
+    Undo records[MAX_GAME_PLY];
+    int count = 0;
+};
+
+/**
+ * \brief Подсчитать число позиций на глубине depth (perft).
+ * \param state Состояние партии
+ * \param depth Глубина в полуходах
+ * \return Число листьев дерева ходов.
+ */
+uint64_t perft(const GameState& state, int depth);
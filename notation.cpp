@@ -0,0 +1,164 @@
+#include "notation.h"
+
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+/**
+ * \brief Прочитать номер поля (1..squares) начиная с позиции i.
+ */
+int readSquare(const std::string& text, size_t& i, int squares = squareCount) {
+    if (i >= text.size() || !isdigit(static_cast<unsigned char>(text[i]))) return -1;
+    int n = 0;
+    while (i < text.size() && isdigit(static_cast<unsigned char>(text[i]))) {
+        n = n * 10 + (text[i] - '0');
+        if (n > squares) return -1;
+        ++i;
+    }
+    return n >= 1 ? n : -1;
+}
+
+/**
+ * \brief Разобрать список фигур одного цвета: "W21,22,K23" или "B1-12".
+ */
+bool parsePieces(const std::string& text, int squares, uint64_t& pieces, uint64_t& kings) {
+    size_t i = 1;
+    while (i < text.size()) {
+        bool king = false;
+        if (text[i] == 'K') {
+            king = true;
+            ++i;
+        }
+        int first = readSquare(text, i, squares);
+        if (first < 0) return false;
+        int last = first;
+        if (i < text.size() && text[i] == '-') {
+            ++i;
+            last = readSquare(text, i, squares);
+            if (last < first) return false;
+        }
+        for (int n = first; n <= last; ++n) {
+            uint64_t m = uint64_t(1) << (n - 1);
+            pieces |= m;
+            if (king) kings |= m;
+        }
+        if (i < text.size()) {
+            if (text[i] != ',') return false;
+            ++i;
+        }
+    }
+    return true;
+}
+
+void writePieces(std::string& out, uint64_t pieces, uint64_t kings) {
+    bool first = true;
+    for (int s = 0; pieces; ++s, pieces >>= 1) {
+        if (!(pieces & 1)) continue;
+        if (!first) out += ',';
+        first = false;
+        if ((kings >> s) & 1) out += 'K';
+        out += std::to_string(s + 1);
+    }
+}
+
+} // namespace
+
+bool parseFenSquares(const std::string& fen, int squares, Turn& turn, uint64_t& white, uint64_t& black,
+                     uint64_t& kings) {
+    std::string text;
+    for (char c : fen) {
+        if (!isspace(static_cast<unsigned char>(c)) && c != '"') text += char(toupper(static_cast<unsigned char>(c)));
+    }
+    if (!text.empty() && text.back() == '.') text.pop_back();
+    if (text.size() < 2 || (text[0] != 'W' && text[0] != 'B') || text[1] != ':') return false;
+
+    uint64_t pieces[2] = {0, 0};
+    uint64_t crowned = 0;
+    size_t start = 2;
+    while (start <= text.size()) {
+        size_t end = text.find(':', start);
+        if (end == std::string::npos) end = text.size();
+        std::string section = text.substr(start, end - start);
+        if (section.empty() || (section[0] != 'W' && section[0] != 'B')) return false;
+        if (!parsePieces(section, squares, pieces[section[0] == 'W' ? 0 : 1], crowned)) return false;
+        start = end + 1;
+    }
+    if (pieces[0] & pieces[1]) return false;
+
+    turn = text[0] == 'W' ? WHITE_TURN : BLACK_TURN;
+    white = pieces[0];
+    black = pieces[1];
+    kings = crowned;
+    return true;
+}
+
+std::string fenFromSquares(Turn turn, uint64_t white, uint64_t black, uint64_t kings) {
+    std::string out = turn == WHITE_TURN ? "W:W" : "B:W";
+    writePieces(out, white, kings);
+    out += ":B";
+    writePieces(out, black, kings);
+    return out;
+}
+
+bool parseFen(const std::string& fen, GameState& state) {
+    GameState result;
+    uint64_t white, black, kings;
+    if (!parseFenSquares(fen, squareCount, result.currentTurn, white, black, kings)) return false;
+    result.board = Position{Bitboard(white), Bitboard(black), Bitboard(kings)};
+    result.hash = computeHash(result);
+    updateCaptureMaps(result);
+    state = result;
+    return true;
+}
+
+std::string toFen(const GameState& state) {
+    return fenFromSquares(state.currentTurn, state.board.white, state.board.black, state.board.kings);
+}
+
+std::string moveToString(const Move& move) {
+    std::string out = std::to_string(move.from + 1);
+    if (!isCapture(move)) {
+        return out + "-" + std::to_string(move.to + 1);
+    }
+    for (int i = 0; i < move.pathLength; ++i) {
+        out += 'x';
+        out += std::to_string(move.path[i] + 1);
+    }
+    return out;
+}
+
+int findMove(const std::string& text, const MoveList& list) {
+    int squares[MAX_PATH + 1];
+    int count = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        if (count > MAX_PATH) return -1;
+        int n = readSquare(text, i);
+        if (n < 0) return -1;
+        squares[count++] = n - 1;
+        if (i < text.size()) {
+            if (text[i] != '-' && text[i] != 'x' && text[i] != ':') return -1;
+            ++i;
+        }
+    }
+    if (count < 2) return -1;
+
+    // Полная запись хода предпочтительнее сокращенной: "10x1" — это прыжок
+    // 10x1, даже если есть и цепочка из 10 в 1 через другие поля
+    int found = -1;
+    bool ambiguous = false;
+    for (int m = 0; m < list.size(); ++m) {
+        const Move& move = list[m];
+        if (move.from != squares[0] || move.to != squares[count - 1]) continue;
+        bool full = move.pathLength == count - 1;
+        for (int k = 1; full && k < count; ++k) {
+            if (move.path[k - 1] != squares[k]) full = false;
+        }
+        if (full) return m;
+        if (count > 2) continue;
+        if (found >= 0) ambiguous = true;
+        found = m;
+    }
+    return ambiguous ? -1 : found;
+}
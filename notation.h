@@ -0,0 +1,71 @@
+/**
+ * \file notation.h
+ * \brief Текстовая запись позиций (FEN) и ходов.
+ *
+ * Поля нумеруются от 1 до 32 слева направо и сверху вниз, как на экране:
+ * поле 1 находится на клетке (1, 0), поле 32 — на клетке (6, 7).
+ * Позиция записывается в формате PDN FEN, например "W:W21-32:B1-12":
+ * очередь хода, затем белые и черные фигуры, дамки отмечаются буквой K.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "movegen.h"
+
+/// FEN начальной позиции.
+const char* const START_FEN = "W:W21-32:B1-12";
+
+/**
+ * \brief Разобрать позицию в формате FEN.
+ * \param fen Строка FEN
+ * \param state Состояние, в которое записывается позиция
+ * \return true, если строка корректна, иначе false (state при этом не меняется).
+ */
+bool parseFen(const std::string& fen, GameState& state);
+
+/**
+ * \brief Записать позицию в формате FEN.
+ * \param state Состояние партии
+ * \return Строка FEN.
+ */
+std::string toFen(const GameState& state);
+
+/**
+ * \brief Разобрать FEN для доски с произвольным числом полей (не больше 64).
+ *
+ * Общая часть parseFen() и разбора позиций других вариантов правил.
+ * \param fen Строка FEN
+ * \param squares Число полей доски
+ * \param turn Очередь хода
+ * \param white Белые фигуры
+ * \param black Черные фигуры
+ * \param kings Дамки обоих цветов
+ * \return true, если строка корректна (иначе выходные параметры не меняются).
+ */
+bool parseFenSquares(const std::string& fen, int squares, Turn& turn, uint64_t& white, uint64_t& black,
+                     uint64_t& kings);
+
+/**
+ * \brief Записать позицию из масок полей в формате FEN.
+ */
+std::string fenFromSquares(Turn turn, uint64_t white, uint64_t black, uint64_t kings);
+
+/**
+ * \brief Записать ход: "22-18" для тихого хода, "22x15x6" для взятия.
+ * \param move Ход
+ * \return Запись хода.
+ */
+std::string moveToString(const Move& move);
+
+/**
+ * \brief Найти в списке ход по его записи.
+ *
+ * Для взятия достаточно указать начальное и конечное поле, если этого
+ * хватает, чтобы однозначно выбрать ход.
+ * \param text Запись хода
+ * \param list Список допустимых ходов
+ * \return Индекс хода в списке или -1, если ход не найден или неоднозначен.
+ */
+int findMove(const std::string& text, const MoveList& list);
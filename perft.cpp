@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "notation.h"
+#include "variant.h"
+
+namespace {
+
+/**
+ * \brief Perft или разбивка по ходам с замером времени.
+ *
+ * Общая часть для ядра и вариантов из variant.h: нужны только перегрузки
+ * generateMoves(), makeMove(), perft() и moveToString() для State.
+ */
+template <class State, class List>
+int runPerft(const State& game, int depth, bool divide) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+    if (divide) {
+        List list;
+        generateMoves(game, list);
+        for (const auto& move : list) {
+            State next = game;
+            makeMove(next, move);
+            uint64_t count = perft(next, depth - 1);
+            std::cout << moveToString(move) << ": " << count << std::endl;
+            nodes += count;
+        }
+        std::cout << "Moves: " << list.size() << std::endl;
+    }
+    else {
+        for (int d = 1; d < depth; ++d) {
+            std::cout << "perft(" << d << ") = " << perft(game, d) << std::endl;
+        }
+        nodes = perft(game, depth);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "perft(" << depth << ") = " << nodes << std::endl;
+    std::cout << "Time: " << seconds << " s, " << uint64_t(nodes / (seconds > 0 ? seconds : 1e-9)) << " nodes/s" << std::endl;
+    return 0;
+}
+
+/**
+ * \brief Perft для варианта правил из variant.h; FEN пустой — начальная позиция.
+ */
+template <class Rules>
+int runVariant(const std::string& fen, int depth, bool divide) {
+    VariantState<Rules> game;
+    initVariant(game);
+    if (!fen.empty() && !parseFen(fen, game)) {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return 1;
+    }
+    std::cout << "Variant: " << Rules::name() << ", position: " << toFen(game) << std::endl;
+    return runPerft<VariantState<Rules>, VariantMoveList>(game, depth, divide);
+}
+
+} // namespace
+
+/**
+ * \brief Подсчет позиций до заданной глубины: тест скорости и корректности генератора ходов.
+ *
+ * Без --variant считается генератор ядра (русские шашки); с --variant —
+ * генератор из variant.h для russian, english или international.
+ *
+ * Использование: perft [глубина] [FEN] [--divide] [--variant имя]
+ */
+int main(int argc, char* argv[]) {
+    int depth = 6;
+    bool divide = false;
+    std::string fen;
+    std::string variant;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--divide") == 0) {
+            divide = true;
+        }
+        else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            variant = argv[++i];
+        }
+        else if (isdigit(static_cast<unsigned char>(argv[i][0]))) {
+            depth = atoi(argv[i]);
+        }
+        else {
+            fen = argv[i];
+        }
+    }
+    if (depth < 1) {
+        std::cerr << "Depth must be at least 1" << std::endl;
+        return 1;
+    }
+    if (variant == "russian") return runVariant<RussianRules>(fen, depth, divide);
+    if (variant == "english") return runVariant<EnglishRules>(fen, depth, divide);
+    if (variant == "international") return runVariant<InternationalRules>(fen, depth, divide);
+    if (!variant.empty()) {
+        std::cerr << "Unknown variant: " << variant << " (russian, english, international)" << std::endl;
+        return 1;
+    }
+
+    GameState game;
+    if (fen.empty()) fen = START_FEN;
+    if (!parseFen(fen, game)) {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return 1;
+    }
+
+    std::cout << "Position: " << toFen(game) << std::endl;
+    return runPerft<GameState, MoveList>(game, depth, divide);
+}
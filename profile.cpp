@@ -0,0 +1,123 @@
+#include "profile.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+namespace {
+
+const char* const COUNTER_NAMES[PROFILE_COUNTERS] = {
+    "generateMoves", "generateCaptures", "makeMove", "unmakeMove", "isValidMove",  "canCapture",
+    "mustCapture",   "evaluate",         "evaluateBatch", "search", "searchNodes", "quiescenceNodes",
+};
+
+/// Измерения по времени (PROFILE_SCOPE), остальные только считают вызовы
+const bool TIMED[PROFILE_COUNTERS] = {true, true, false, false, false, false, false, false, true, true, false, false};
+
+// Список наборов и его мьютекс не уничтожаются: они нужны и при записи итогов
+// из деструктора статического объекта, и потокам, завершающимся после него
+std::mutex& registryMutex() {
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+
+std::atomic<ProfileThreadData*> registry(nullptr);
+
+/**
+ * \brief Возвращает набор счетчиков в общий список, когда поток завершается.
+ */
+struct ProfileRelease {
+    ProfileThreadData* data = nullptr;
+
+    ~ProfileRelease() {
+        if (!data) return;
+        profileThreadData = nullptr;
+        data->inUse.store(false, std::memory_order_release);
+    }
+};
+
+#ifdef CHECKERS_PROFILE
+
+/**
+ * \brief Записывает итоги в файл при выходе из программы.
+ */
+struct ProfileDump {
+    ~ProfileDump() {
+        const char* path = std::getenv("CHECKERS_PROFILE_FILE");
+        std::ofstream out(path && *path ? path : "profile.json", std::ios::trunc);
+        if (out) writeProfileJson(out, profileTotals());
+    }
+} profileDump;
+
+#endif
+
+} // namespace
+
+thread_local ProfileThreadData* profileThreadData = nullptr;
+
+ProfileThreadData* acquireProfileThreadData() {
+    ProfileThreadData* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (ProfileThreadData* item = registry.load(); item; item = item->next) {
+            if (!item->inUse.load(std::memory_order_acquire)) {
+                data = item;
+                break;
+            }
+        }
+        if (!data) {
+            data = new ProfileThreadData;
+            for (int i = 0; i < PROFILE_COUNTERS; ++i) {
+                data->calls[i].store(0);
+                data->nanoseconds[i].store(0);
+            }
+            data->next = registry.load();
+            registry.store(data);
+        }
+        data->inUse.store(true);
+    }
+    static thread_local ProfileRelease release;
+    release.data = data;
+    profileThreadData = data;
+    return data;
+}
+
+const char* profileCounterName(ProfileCounter counter) {
+    return counter >= 0 && counter < PROFILE_COUNTERS ? COUNTER_NAMES[counter] : "unknown";
+}
+
+ProfileTotals profileTotals() {
+    ProfileTotals totals;
+    for (ProfileThreadData* item = registry.load(); item; item = item->next) {
+        for (int i = 0; i < PROFILE_COUNTERS; ++i) {
+            totals.calls[i] += item->calls[i].load(std::memory_order_relaxed);
+            totals.nanoseconds[i] += item->nanoseconds[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void profileReset() {
+    for (ProfileThreadData* item = registry.load(); item; item = item->next) {
+        for (int i = 0; i < PROFILE_COUNTERS; ++i) {
+            item->calls[i].store(0, std::memory_order_relaxed);
+            item->nanoseconds[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void writeProfileJson(std::ostream& out, const ProfileTotals& totals) {
+    out << "{\n  \"enabled\": " << (profileEnabled() ? "true" : "false") << ",\n  \"counters\": {";
+    for (int i = 0; i < PROFILE_COUNTERS; ++i) {
+        out << (i ? "," : "") << "\n    \"" << COUNTER_NAMES[i] << "\": {\"calls\": " << totals.calls[i];
+        if (TIMED[i]) {
+            double perCall = totals.calls[i] ? double(totals.nanoseconds[i]) / double(totals.calls[i]) : 0;
+            out << ", \"ns\": " << totals.nanoseconds[i] << ", \"nsPerCall\": " << std::fixed << std::setprecision(1)
+                << perCall << std::defaultfloat;
+        }
+        out << "}";
+    }
+    out << "\n  }\n}\n";
+}
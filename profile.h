@@ -0,0 +1,143 @@
+/**
+ * \file profile.h
+ * \brief Счетчики и таймеры горячих путей, включаемые при сборке.
+ *
+ * С определенным CHECKERS_PROFILE (опция CMake CHECKERS_PROFILE=ON)
+ * PROFILE_COUNT считает вызовы, а PROFILE_SCOPE еще и время до конца
+ * блока; при выходе из программы итоги пишутся в JSON-файл (переменная
+ * окружения CHECKERS_PROFILE_FILE, по умолчанию profile.json). Без него
+ * макросы пусты и ничего не стоят.
+ *
+ * Каждый поток пишет в свой набор счетчиков, поэтому счет не требует
+ * атомарных операций с общей памятью и не мешает параллельному перебору.
+ * Время таймера включает цену самого измерения (десятки наносекунд),
+ * поэтому таймеры стоят только на функциях, которые заметно дольше.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+/// Измеряемое место.
+enum ProfileCounter {
+    PROFILE_GENERATE_MOVES, ///< generateMoves(), таймер (включает generateCaptures())
+    PROFILE_GENERATE_CAPTURES, ///< generateCaptures(), таймер
+    PROFILE_MAKE_MOVE, ///< makeMove()
+    PROFILE_UNMAKE_MOVE, ///< unmakeMove()
+    PROFILE_IS_VALID_MOVE, ///< isValidMove()
+    PROFILE_CAN_CAPTURE, ///< canCapture()
+    PROFILE_MUST_CAPTURE, ///< mustCapture()
+    PROFILE_EVALUATE, ///< evaluate()
+    PROFILE_EVALUATE_BATCH, ///< evaluateBatch(), таймер
+    PROFILE_SEARCH, ///< Searcher::search(), таймер
+    PROFILE_SEARCH_NODE, ///< Узел перебора
+    PROFILE_QUIESCENCE_NODE, ///< Узел форсированного перебора взятий
+    PROFILE_COUNTERS ///< Число измеряемых мест
+};
+
+/**
+ * \brief Имя измеряемого места в JSON, например "generateMoves".
+ */
+const char* profileCounterName(ProfileCounter counter);
+
+/**
+ * \brief Итоги по всем потокам.
+ */
+struct ProfileTotals {
+    uint64_t calls[PROFILE_COUNTERS] = {}; ///< Вызовы
+    uint64_t nanoseconds[PROFILE_COUNTERS] = {}; ///< Время (только для таймеров)
+};
+
+/**
+ * \brief Включены ли счетчики в этой сборке.
+ */
+constexpr bool profileEnabled() {
+#ifdef CHECKERS_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Сложить счетчики всех потоков, в том числе завершившихся.
+ */
+ProfileTotals profileTotals();
+
+/**
+ * \brief Обнулить счетчики всех потоков.
+ *
+ * Счет в других потоках в это время может частично потеряться.
+ */
+void profileReset();
+
+/**
+ * \brief Записать итоги в формате JSON.
+ */
+void writeProfileJson(std::ostream& out, const ProfileTotals& totals);
+
+/**
+ * \brief Счетчики одного потока; пишет в них только этот поток.
+ */
+struct ProfileThreadData {
+    std::atomic<uint64_t> calls[PROFILE_COUNTERS];
+    std::atomic<uint64_t> nanoseconds[PROFILE_COUNTERS];
+    ProfileThreadData* next; ///< Следующий в списке всех наборов
+    std::atomic<bool> inUse; ///< Набор принадлежит живому потоку
+};
+
+extern thread_local ProfileThreadData* profileThreadData;
+
+/**
+ * \brief Набор счетчиков для текущего потока: свободный набор завершившегося потока или новый.
+ */
+ProfileThreadData* acquireProfileThreadData();
+
+inline ProfileThreadData& profileThread() {
+    ProfileThreadData* data = profileThreadData;
+    return data ? *data : *acquireProfileThreadData();
+}
+
+/**
+ * \brief Прибавить к счетчику без атомарного сложения: писатель у счетчика один.
+ */
+inline void profileAdd(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline void profileCount(ProfileCounter counter) {
+    profileAdd(profileThread().calls[counter], 1);
+}
+
+/**
+ * \brief Таймер блока: считает вызов и время от создания до уничтожения.
+ */
+class ProfileTimer {
+public:
+    explicit ProfileTimer(ProfileCounter counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+
+    ~ProfileTimer() {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        ProfileThreadData& data = profileThread();
+        profileAdd(data.calls[counter], 1);
+        profileAdd(data.nanoseconds[counter], uint64_t(elapsed.count()));
+    }
+
+    ProfileTimer(const ProfileTimer&) = delete;
+    ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+private:
+    ProfileCounter counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifdef CHECKERS_PROFILE
+#define PROFILE_COUNT(counter) profileCount(counter)
+#define PROFILE_SCOPE(counter) ProfileTimer profileTimer(counter)
+#else
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_SCOPE(counter) ((void)0)
+#endif
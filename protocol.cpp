@@ -0,0 +1,347 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <thread>
+
+#include "notation.h"
+
+namespace {
+
+const unsigned long MAX_HASH_MB = 4096; ///< Больше на процесс не дается: движков на машине может быть сотни
+
+std::string scoreString(int score) {
+    if (score >= SCORE_WIN_THRESHOLD) return "win " + std::to_string(SCORE_WIN - score);
+    if (score <= -SCORE_WIN_THRESHOLD) return "loss " + std::to_string(SCORE_WIN + score);
+    return "cp " + std::to_string(score);
+}
+
+uint64_t nodesPerSecond(uint64_t nodes, int64_t timeMs) {
+    return nodes * 1000 / uint64_t(std::max<int64_t>(timeMs, 1));
+}
+
+} // namespace
+
+EngineProtocol::EngineProtocol(std::ostream& out)
+    : out(out), reportInfo(true), inputDone(false), inputEnded(false), unboundedSearch(false), current(0),
+      stopBefore(0) {
+    initBoard(state);
+    searcher.setInfoCallback([this](const SearchResult& result) {
+        // stop мог прийти до того, как search() сбросил флаг остановки
+        if (stopRequested()) searcher.stop();
+        if (!reportInfo) return;
+        std::string line = "info depth " + std::to_string(result.depth) + " score " + scoreString(result.score) +
+                           " nodes " + std::to_string(result.nodes) + " nps " +
+                           std::to_string(nodesPerSecond(result.nodes, result.timeMs)) + " time " +
+                           std::to_string(result.timeMs) + " hashfull " + std::to_string(result.hashfull) + " pv";
+        for (int i = 0; i < result.pv.length; ++i) line += " " + moveToString(result.pv.moves[i]);
+        send(line);
+    });
+}
+
+void EngineProtocol::run(std::istream& in) {
+    std::thread worker(&EngineProtocol::workerLoop, this);
+    uint64_t number = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) continue;
+        line = line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin);
+
+        if (line == "stop") {
+            stopBefore = number;
+            searcher.stop();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Command{number++, line});
+        }
+        commandReady.notify_one();
+        if (line == "quit") break;
+    }
+    // Дальше stop прийти не может: перебор без ограничений иначе не закончится
+    inputEnded = true;
+    if (unboundedSearch) searcher.stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inputDone = true;
+    }
+    commandReady.notify_one();
+    worker.join();
+}
+
+void EngineProtocol::workerLoop() {
+    Command command;
+    while (nextCommand(command)) {
+        current = command.number;
+        if (!execute(command.line)) return;
+    }
+}
+
+bool EngineProtocol::nextCommand(Command& command) {
+    std::unique_lock<std::mutex> lock(mutex);
+    commandReady.wait(lock, [&] { return inputDone || !queue.empty(); });
+    if (queue.empty()) return false;
+    command = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+bool EngineProtocol::stopRequested() const {
+    return current < stopBefore || (inputEnded && unboundedSearch);
+}
+
+void EngineProtocol::send(const std::string& line) {
+    out << line << '\n';
+    out.flush();
+}
+
+void EngineProtocol::error(const std::string& message) {
+    send("info string error: " + message);
+}
+
+bool EngineProtocol::execute(const std::string& line) {
+    std::istringstream args(line);
+    std::string name;
+    args >> name;
+    if (name == "hello") {
+        send("id name checkers");
+        send("option hash threads tablebases evalfile book");
+        send("hellook");
+    }
+    else if (name == "isready") {
+        send("readyok");
+    }
+    else if (name == "new") {
+        searcher.clear();
+        initBoard(state);
+    }
+    else if (name == "setoption") {
+        setOption(args);
+    }
+    else if (name == "position") {
+        position(args);
+    }
+    else if (name == "go") {
+        go(args);
+    }
+    else if (name == "analyze") {
+        analyze(args);
+    }
+    else if (name == "print") {
+        print();
+    }
+    else if (name == "quit") {
+        return false;
+    }
+    else {
+        error("unknown command " + name);
+    }
+    return true;
+}
+
+void EngineProtocol::setOption(std::istringstream& args) {
+    std::string name, value;
+    if (!(args >> name >> value)) {
+        error("setoption needs a name and a value");
+        return;
+    }
+    if (name == "hash") {
+        if (value.find_first_not_of("0123456789") != std::string::npos) {
+            error("hash size must be a number of megabytes");
+            return;
+        }
+        // Длинная строка цифр дает ULONG_MAX и тоже упирается в предел
+        unsigned long megabytes = std::max(strtoul(value.c_str(), nullptr, 10), 1ul);
+        if (megabytes > MAX_HASH_MB) {
+            error("hash size limited to " + std::to_string(MAX_HASH_MB) + " MB");
+            megabytes = MAX_HASH_MB;
+        }
+        try {
+            searcher.setHashSize(size_t(megabytes));
+        }
+        catch (const std::bad_alloc&) {
+            // Старая таблица освобождается только после выделения новой
+            error("cannot allocate " + std::to_string(megabytes) + " MB for the hash table");
+        }
+    }
+    else if (name == "threads") {
+        searcher.setThreads(atoi(value.c_str()));
+    }
+    else if (name == "tablebases") {
+        searcher.setTablebase(nullptr);
+        tablebase.reset(new Tablebase);
+        int loaded = tablebase->load(value);
+        searcher.setTablebase(loaded > 0 ? tablebase.get() : nullptr);
+        send("info string tablebases " + std::to_string(loaded) + " slices, complete up to " +
+             std::to_string(tablebase->pieces()) + " pieces");
+    }
+    else if (name == "evalfile") {
+        std::ifstream in(value);
+        EvalWeights weights;
+        if (!in || !readEvalWeights(in, weights)) {
+            error("cannot read evaluation weights from " + value);
+            return;
+        }
+        searcher.setEvalWeights(weights);
+        send("info string evaluation weights loaded from " + value);
+    }
+    else if (name == "book") {
+        book.reset(new OpeningBook);
+        if (!book->load(value)) {
+            book.reset();
+            error("cannot load opening book " + value);
+            return;
+        }
+        send("info string book " + std::to_string(book->size()) + " entries");
+    }
+    else {
+        error("unknown option " + name);
+    }
+}
+
+void EngineProtocol::position(std::istringstream& args) {
+    std::string word;
+    GameState next;
+    args >> word;
+    if (word == "startpos") {
+        initBoard(next);
+    }
+    else if (word == "fen") {
+        std::string fen;
+        if (!(args >> fen) || !parseFen(fen, next)) {
+            error("invalid FEN " + fen);
+            return;
+        }
+    }
+    else {
+        error("position needs startpos or fen");
+        return;
+    }
+
+    if (args >> word) {
+        if (word != "moves") {
+            error("unexpected " + word);
+            return;
+        }
+        MoveList legal;
+        while (args >> word) {
+            generateMoves(next, legal);
+            int index = findMove(word, legal);
+            if (index < 0) {
+                error("illegal move " + word);
+                return;
+            }
+            makeMove(next, legal[index]);
+        }
+    }
+    state = next;
+}
+
+bool EngineProtocol::parseLimits(std::istringstream& args, SearchLimits& limits) {
+    std::string word;
+    while (args >> word) {
+        if (word == "infinite") continue;
+        std::string value;
+        if (!(args >> value) || value.find_first_not_of("0123456789") != std::string::npos) {
+            error("expected a number after " + word);
+            return false;
+        }
+        if (word == "depth") limits.depth = std::min(std::max(atoi(value.c_str()), 1), MAX_PLY - 1);
+        else if (word == "movetime") limits.timeMs = strtoll(value.c_str(), nullptr, 10);
+        else if (word == "nodes") limits.nodes = strtoull(value.c_str(), nullptr, 10);
+        else {
+            error("unknown limit " + word);
+            return false;
+        }
+    }
+    return true;
+}
+
+void EngineProtocol::go(std::istringstream& args) {
+    SearchLimits limits;
+    if (!parseLimits(args, limits)) {
+        send("bestmove none");
+        return;
+    }
+    Move bookMove;
+    if (book && book->choose(state, bookMove)) {
+        send("bestmove " + moveToString(bookMove));
+        return;
+    }
+    unboundedSearch = limits.depth == MAX_PLY - 1 && !limits.timeMs && !limits.nodes;
+    // Перебор, остановленный до начала, все равно отвечает ходом
+    if (stopRequested()) limits.depth = 1;
+    SearchResult result = searcher.search(state, limits);
+    unboundedSearch = false;
+    if (!result.hasMove) {
+        send("bestmove none");
+        return;
+    }
+    std::string line = "bestmove " + moveToString(result.bestMove);
+    if (result.pv.length >= 2) line += " ponder " + moveToString(result.pv.moves[1]);
+    send(line);
+}
+
+void EngineProtocol::analyze(std::istringstream& args) {
+    SearchLimits limits;
+    bool valid = parseLimits(args, limits);
+    if (limits.depth == MAX_PLY - 1 && !limits.timeMs && !limits.nodes) {
+        limits.depth = 8; // Без ограничений анализ не закончится
+    }
+
+    reportInfo = false;
+    int count = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    Command command;
+    while (nextCommand(command) && command.line != "end") {
+        if (!valid) continue;
+        const std::string& fen = command.line;
+        std::string prefix = "analysis " + std::to_string(++count) + " " + fen;
+        GameState position;
+        if (!parseFen(fen, position)) {
+            send(prefix + " error invalid FEN");
+            continue;
+        }
+        SearchLimits positionLimits = limits;
+        if (stopRequested()) positionLimits.depth = 1;
+        SearchResult result = searcher.search(position, positionLimits);
+        totalNodes += result.nodes;
+        if (!result.hasMove) {
+            send(prefix + " bestmove none score " + scoreString(result.score));
+            continue;
+        }
+        send(prefix + " bestmove " + moveToString(result.bestMove) + " score " + scoreString(result.score) +
+             " depth " + std::to_string(result.depth) + " nodes " + std::to_string(result.nodes) + " time " +
+             std::to_string(result.timeMs));
+    }
+    reportInfo = true;
+    if (!valid) return;
+
+    int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    send("analyzedone " + std::to_string(count) + " nodes " + std::to_string(totalNodes) + " time " +
+         std::to_string(timeMs) + " nps " + std::to_string(nodesPerSecond(totalNodes, timeMs)));
+}
+
+void EngineProtocol::print() {
+    for (int y = 0; y < size; ++y) {
+        std::string row;
+        for (int x = 0; x < size; ++x) {
+            switch (pieceAt(state.board, x, y)) {
+                case WHITE: row += "w "; break;
+                case BLACK: row += "b "; break;
+                case WHITE_KING: row += "W "; break;
+                case BLACK_KING: row += "B "; break;
+                default: row += isPlayableSquare(x, y) ? ". " : "  "; break;
+            }
+        }
+        row.pop_back();
+        send(row);
+    }
+    send("fen " + toFen(state));
+}
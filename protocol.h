@@ -0,0 +1,106 @@
+/**
+ * \file protocol.h
+ * \brief Текстовый протокол движка: команды построчно со стандартного ввода, ответы в стандартный вывод.
+ *
+ * Команды выполняются строго по порядку, но читаются заранее в отдельном
+ * потоке, поэтому управляющая программа может посылать их пачками, не
+ * дожидаясь ответов. Исключение — stop: он сразу прерывает все отправленные
+ * раньше go и analyze (прерванные отвечают лучшим найденным ходом). quit
+ * выполняется по порядку, так что "stop" и "quit" подряд завершают работу
+ * немедленно. После quit или конца ввода go без ограничений прерывается:
+ * остановить его было бы уже некому.
+ *
+ *     hello                      -> id name ..., hellook
+ *     isready                    -> readyok (после всех предыдущих команд)
+ *     new                        очистить таблицы, начальная позиция
+ *     setoption hash|threads|tablebases|evalfile|book <значение>
+ *                                (hash — мегабайты, не больше 4096)
+ *     position startpos|fen <FEN> [moves <ход> ...]
+ *     go [depth N] [movetime мс] [nodes N] [infinite]
+ *                                -> info depth D score cp S|win N|loss N nodes N nps N time мс hashfull N pv ...
+ *                                -> bestmove <ход> [ponder <ход>] | bestmove none
+ *                                (позиция из дебютной книги — сразу ход книги, без перебора)
+ *     stop                       прервать go или analyze, отправленные раньше
+ *     analyze [depth N] [movetime мс] [nodes N]
+ *     <FEN>
+ *     ...
+ *     end                        -> analysis <номер> <FEN> bestmove ... score ... depth ... nodes ... time ...
+ *                                -> analyzedone <позиций> nodes N time мс nps N
+ *     print                      доска и FEN текущей позиции
+ *     quit
+ *
+ * Ошибки сообщаются строкой "info string error: ...".
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "book.h"
+#include "search.h"
+#include "tablebase.h"
+
+/**
+ * \brief Сеанс текстового протокола.
+ */
+class EngineProtocol {
+public:
+    explicit EngineProtocol(std::ostream& out);
+
+    EngineProtocol(const EngineProtocol&) = delete;
+    EngineProtocol& operator=(const EngineProtocol&) = delete;
+
+    /**
+     * \brief Читать и выполнять команды до quit или конца ввода.
+     *
+     * Все прочитанные до этого команды выполняются; go без ограничений
+     * прерывается, как по stop.
+     */
+    void run(std::istream& in);
+
+private:
+    /// Строка ввода и ее порядковый номер.
+    struct Command {
+        uint64_t number;
+        std::string line;
+    };
+
+    void workerLoop();
+    bool nextCommand(Command& command);
+    bool execute(const std::string& line);
+    void position(std::istringstream& args);
+    void go(std::istringstream& args);
+    void analyze(std::istringstream& args);
+    void setOption(std::istringstream& args);
+    void print();
+    bool parseLimits(std::istringstream& args, SearchLimits& limits);
+    bool stopRequested() const;
+    void send(const std::string& line);
+    void error(const std::string& message);
+
+    std::ostream& out;
+    Searcher searcher;
+    std::unique_ptr<Tablebase> tablebase;
+    std::unique_ptr<OpeningBook> book;
+    GameState state;
+    bool reportInfo; ///< Отправлять ли строки info (не во время analyze)
+
+    std::mutex mutex;
+    std::condition_variable commandReady;
+    std::deque<Command> queue; ///< Прочитанные, но еще не выполненные команды
+    bool inputDone;
+    std::atomic<bool> inputEnded; ///< Ввод закончился (quit или конец файла)
+    std::atomic<bool> unboundedSearch; ///< Идет go без глубины, времени и узлов
+
+    std::atomic<uint64_t> current; ///< Номер выполняемой команды
+    std::atomic<uint64_t> stopBefore; ///< Команды с меньшими номерами прерываются
+};
@@ -0,0 +1,110 @@
+#include "rules.h"
+
+#include <cstdlib>
+
+#include "profile.h"
+#include "zobrist.h"
+
+void initBoard(GameState& state) {
+    state.board.black = 0x00000FFFu;
+    state.board.white = 0xFFF00000u;
+    state.board.kings = 0;
+    state.currentTurn = WHITE_TURN;
+    state.hash = computeHash(state);
+    updateCaptureMaps(state);
+}
+
+bool isValidMove(const GameState& state, int fromX, int fromY, int toX, int toY, bool& isCapture) {
+    PROFILE_COUNT(PROFILE_IS_VALID_MOVE);
+    const Position& board = state.board;
+    isCapture = false;
+    Bitboard from = squareMask(fromX, fromY);
+    Bitboard to = squareMask(toX, toY);
+    Bitboard empty = emptySquares(board);
+    if (!from || !(to & empty)) return false;
+
+    Piece piece = pieceAt(board, fromX, fromY);
+    if (piece == EMPTY) return false;
+    Bitboard enemy = (board.white & from) ? board.black : board.white;
+    int dx = toX - fromX;
+    int dy = toY - fromY;
+    if (abs(dx) != abs(dy)) return false;
+    Direction dir = directionOf(dx, dy);
+
+    if (piece == BLACK || piece == WHITE) {
+        if (abs(dx) == 1) {
+            return (forwardMoves(from, piece == WHITE ? WHITE_TURN : BLACK_TURN) & to) != 0;
+        }
+        if (abs(dx) == 2 && (shift(from, dir) & enemy)) {
+            isCapture = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Дамка: на пути не больше одной фигуры соперника, остальные поля свободны
+    int fromSquare = squareIndex(fromX, fromY);
+    int toSquare = squareIndex(toX, toY);
+    Bitboard between = RAYS.ray[dir][fromSquare] & ~RAYS.ray[dir][toSquare] & ~to;
+    Bitboard blockers = between & ~empty;
+    if (blockers & ~enemy) return false;
+    int captured = popCount(blockers);
+    if (captured > 1) return false;
+    isCapture = captured == 1;
+    return true;
+}
+
+bool canCapture(const GameState& state, int x, int y) {
+    PROFILE_COUNT(PROFILE_CAN_CAPTURE);
+    const Position& board = state.board;
+    Bitboard from = squareMask(x, y);
+    if (!(from & (board.white | board.black))) return false;
+    Turn side = (board.white & from) ? WHITE_TURN : BLACK_TURN;
+    return (state.capturers[side] & from) != 0;
+}
+
+bool mustCapture(const GameState& state) {
+    PROFILE_COUNT(PROFILE_MUST_CAPTURE);
+    return state.capturers[state.currentTurn] != 0;
+}
+
+void makeMove(GameState& state, int fromX, int fromY, int toX, int toY, bool isCapture) {
+    PROFILE_COUNT(PROFILE_MAKE_MOVE);
+    Position& board = state.board;
+    Piece piece = pieceAt(board, fromX, fromY);
+    setPiece(board, fromX, fromY, EMPTY);
+    setPiece(board, toX, toY, piece);
+
+    if (isCapture) {
+        Direction dir = directionOf(toX - fromX, toY - fromY);
+        Bitboard to = squareMask(toX, toY);
+        Bitboard path = RAYS.ray[dir][squareIndex(fromX, fromY)] & ~RAYS.ray[dir][squareIndex(toX, toY)] & ~to;
+        board.white &= ~path;
+        board.black &= ~path;
+        board.kings &= ~path;
+    }
+
+    if (piece == BLACK && toY == size - 1) {
+        setPiece(board, toX, toY, BLACK_KING);
+    }
+    else if (piece == WHITE && toY == 0) {
+        setPiece(board, toX, toY, WHITE_KING);
+    }
+    state.hash = computeHash(state);
+    updateCaptureMaps(state);
+}
+
+uint64_t computeHash(const GameState& state) {
+    uint64_t hash = hashPosition(state.board);
+    return state.currentTurn == BLACK_TURN ? hash ^ ZOBRIST.blackToMove : hash;
+}
+
+void updateCaptureMaps(GameState& state) {
+    state.capturers[WHITE_TURN] = jumpers(state.board, WHITE_TURN);
+    state.capturers[BLACK_TURN] = jumpers(state.board, BLACK_TURN);
+}
+
+void switchTurn(GameState& state) {
+    state.currentTurn = (state.currentTurn == WHITE_TURN) ? BLACK_TURN : WHITE_TURN;
+    state.hash ^= ZOBRIST.blackToMove;
+}
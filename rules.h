@@ -0,0 +1,93 @@
+/**
+ * \file rules.h
+ * \brief Правила игры без графики: состояние партии и функции над ним.
+ *
+ * Все функции получают состояние явно и не используют глобальных
+ * переменных, поэтому в одном процессе можно вести сколько угодно партий,
+ * в том числе из разных потоков.
+ */
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * \brief Состояние партии: позиция, очередь хода, карты взятий и хеш.
+ *
+ * Хеш и карты взятий ходы обновляют сами; после прямого изменения доски
+ * их нужно пересчитать (computeHash(), updateCaptureMaps()).
+ */
+struct GameState {
+    Position board; ///< Игровая доска
+    Turn currentTurn; ///< Текущая очередь хода
+    Bitboard capturers[2]; ///< Фигуры каждой стороны (индекс — Turn), которые могут бить
+    uint64_t hash; ///< Хеш Зобриста позиции и очереди хода
+};
+
+/**
+ * \brief Инициализация начального состояния доски.
+ * \param state Состояние партии
+ */
+void initBoard(GameState& state);
+
+/**
+ * \brief Проверить, является ли ход валидным.
+ * \param state Состояние партии
+ * \param fromX Координата X начальной клетки
+ * \param fromY Координата Y начальной клетки
+ * \param toX Координата X конечной клетки
+ * \param toY Координата Y конечной клетки
+ * \param isCapture Ссылка на переменную, указывающую, является ли ход захватом
+ * \return true, если ход валидный, иначе false.
+ */
+bool isValidMove(const GameState& state, int fromX, int fromY, int toX, int toY, bool& isCapture);
+
+/**
+ * \brief Проверить, может ли фигура захватить другую фигуру.
+ * \param state Состояние партии
+ * \param x Координата X фигуры
+ * \param y Координата Y фигуры
+ * \return true, если фигура может захватить, иначе false.
+ */
+bool canCapture(const GameState& state, int x, int y);
+
+/**
+ * \brief Проверить, обязателен ли захват.
+ * \param state Состояние партии
+ * \return true, если захват обязателен, иначе false.
+ */
+bool mustCapture(const GameState& state);
+
+/**
+ * \brief Выполнить ход фигуры.
+ * \param state Состояние партии
+ * \param fromX Координата X начальной клетки
+ * \param fromY Координата Y начальной клетки
+ * \param toX Координата X конечной клетки
+ * \param toY Координата Y конечной клетки
+ * \param isCapture Указывает, является ли ход захватом
+ */
+void makeMove(GameState& state, int fromX, int fromY, int toX, int toY, bool isCapture);
+
+/**
+ * \brief Вычислить хеш Зобриста заново.
+ *
+ * Ходы обновляют хеш сами; пересчет нужен после прямого изменения доски.
+ * \param state Состояние партии
+ * \return Хеш позиции и очереди хода.
+ */
+uint64_t computeHash(const GameState& state);
+
+/**
+ * \brief Пересчитать карты взятий обеих сторон заново.
+ *
+ * Ходы обновляют карты сами; пересчет нужен после прямого изменения доски.
+ * \param state Состояние партии
+ */
+void updateCaptureMaps(GameState& state);
+
+/**
+ * \brief Передать ход сопернику.
+ * \param state Состояние партии
+ */
+void switchTurn(GameState& state);
@@ -0,0 +1,480 @@
+#include "search.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "eval.h"
+#include "profile.h"
+
+namespace {
+
+const int ASPIRATION_WINDOW = 50; ///< Начальная полуширина окна стремления
+const int HISTORY_LIMIT = 1 << 20; ///< Порог, после которого история уменьшается вдвое
+
+const int SCORE_PREFERRED = 1 << 30;
+const int SCORE_CAPTURE = 1 << 29;
+const int SCORE_PROMOTION = 1 << 28;
+const int SCORE_KILLER = 1 << 27;
+
+/**
+ * \brief Переставить на позицию i ход с наибольшей оценкой среди оставшихся.
+ */
+const Move& pickMove(MoveList& list, int* scores, int i) {
+    int best = i;
+    for (int j = i + 1; j < list.size(); ++j) {
+        if (scores[j] > scores[best]) best = j;
+    }
+    if (best != i) {
+        std::swap(list[i], list[best]);
+        std::swap(scores[i], scores[best]);
+    }
+    return list[i];
+}
+
+/**
+ * \brief Перевести оценку выигрыша из отсчета от корня в отсчет от узла (для таблицы).
+ */
+int scoreToTable(int score, int ply) {
+    if (score >= SCORE_WIN_THRESHOLD) return score + ply;
+    if (score <= -SCORE_WIN_THRESHOLD) return score - ply;
+    return score;
+}
+
+/**
+ * \brief Обратное преобразование оценки из таблицы.
+ */
+int scoreFromTable(int score, int ply) {
+    if (score >= SCORE_WIN_THRESHOLD) return score - ply;
+    if (score <= -SCORE_WIN_THRESHOLD) return score + ply;
+    return score;
+}
+
+void updatePv(PrincipalVariation& pv, const Move& move, const PrincipalVariation& child) {
+    pv.moves[0] = move;
+    std::memcpy(pv.moves + 1, child.moves, sizeof(Move) * child.length);
+    pv.length = child.length + 1;
+}
+
+} // namespace
+
+/**
+ * \brief Данные одного потока перебора.
+ *
+ * Таблицы убийц и истории, путь от корня и счетчик узлов у каждого потока
+ * свои; общие у потоков только таблица транспозиций и флаг остановки.
+ */
+struct Searcher::Worker {
+    Worker(Searcher& owner, int id) : owner(owner), id(id), followPv(false), stopped(false), nodes(0) {
+        clear();
+    }
+
+    void clear() {
+        std::memset(killers, 0, sizeof(killers));
+        std::memset(history, 0, sizeof(history));
+    }
+
+    void prepare() {
+        stopped = false;
+        nodes.store(0, std::memory_order_relaxed);
+        previousPv.length = 0;
+    }
+
+    SearchResult iterate();
+    int negamax(GameState& state, int depth, int ply, int alpha, int beta, PrincipalVariation& pv);
+    int quiescence(GameState& state, int ply, int alpha, int beta, PrincipalVariation& pv);
+    void orderMoves(const MoveList& list, int ply, const Move* first, int* scores) const;
+    void updateHistory(const Move& move, int depth, int ply);
+    bool countNode();
+    bool checkLimits();
+
+    Searcher& owner;
+    const int id;
+    uint64_t pathHashes[MAX_PLY];
+    Undo undoStack[MAX_PLY]; ///< Записи отмены ходов на пути от корня
+    PrincipalVariation previousPv;
+    bool followPv;
+    Move killers[MAX_PLY][2];
+    int history[squareCount][squareCount];
+    bool stopped;
+    std::atomic<uint64_t> nodes; ///< Пишет только свой поток, читают все
+};
+
+Searcher::Searcher()
+    : tablebase(nullptr), searchId(0), running(0), quit(false), stopFlag(false), pondering(false), ponderHitMs(0),
+      startTicks(0) {
+    setThreads(1);
+}
+
+Searcher::~Searcher() {
+    stopHelpers();
+}
+
+void Searcher::clear() {
+    tt.clear();
+    for (auto& worker : workers) worker->clear();
+}
+
+void Searcher::setHashSize(size_t megabytes) {
+    tt.resize(megabytes);
+}
+
+void Searcher::setThreads(int count) {
+    count = std::min(std::max(count, 1), MAX_THREADS);
+    stopHelpers();
+    workers.clear();
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back(new Worker(*this, i));
+    }
+    quit = false;
+    for (int i = 1; i < count; ++i) {
+        helpers.emplace_back(&Searcher::helperLoop, this, std::ref(*workers[i]), searchId);
+    }
+}
+
+void Searcher::stopHelpers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeUp.notify_all();
+    for (auto& thread : helpers) thread.join();
+    helpers.clear();
+}
+
+void Searcher::helperLoop(Worker& worker, uint64_t seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeUp.wait(lock, [&] { return quit || searchId != seen; });
+        if (quit) return;
+        seen = searchId;
+        lock.unlock();
+        worker.iterate();
+        lock.lock();
+        if (--running == 0) helpersDone.notify_all();
+    }
+}
+
+void Searcher::stop() {
+    stopFlag = true;
+}
+
+void Searcher::ponderHit() {
+    if (!pondering) return;
+    ponderHitMs = elapsedMs();
+    pondering = false;
+}
+
+void Searcher::setInfoCallback(InfoCallback callback) {
+    infoCallback = callback;
+}
+
+int64_t Searcher::elapsedMs() const {
+    std::chrono::steady_clock::duration elapsed(std::chrono::steady_clock::now().time_since_epoch().count() - startTicks);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+bool Searcher::outOfTime() const {
+    return limits.timeMs && !pondering && elapsedMs() - ponderHitMs >= limits.timeMs;
+}
+
+uint64_t Searcher::totalNodes() const {
+    uint64_t total = 0;
+    for (auto& worker : workers) total += worker->nodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+SearchResult Searcher::search(const GameState& state, const SearchLimits& searchLimits) {
+    PROFILE_SCOPE(PROFILE_SEARCH);
+    limits = searchLimits;
+    root = state;
+    startTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    stopFlag = false;
+    ponderHitMs = 0;
+    pondering = limits.ponder;
+    tt.newSearch();
+    for (auto& worker : workers) worker->prepare();
+
+    if (workers.size() > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = int(workers.size()) - 1;
+            ++searchId;
+        }
+        wakeUp.notify_all();
+    }
+
+    SearchResult result = workers[0]->iterate();
+
+    // Вспомогательные потоки работают, пока главный не закончит
+    if (workers.size() > 1) {
+        stopFlag = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        helpersDone.wait(lock, [&] { return running == 0; });
+    }
+    result.nodes = totalNodes();
+    result.timeMs = elapsedMs();
+    result.threads = threads();
+    return result;
+}
+
+SearchResult Searcher::Worker::iterate() {
+    const bool mainThread = id == 0;
+    const SearchLimits& limits = owner.limits;
+    GameState state = owner.root;
+
+    SearchResult result;
+    result.threads = owner.threads();
+    MoveList rootMoves;
+    generateMoves(state, rootMoves);
+    if (rootMoves.empty()) {
+        result.score = -SCORE_WIN;
+        return result;
+    }
+    result.hasMove = true;
+    result.bestMove = rootMoves[0];
+
+    // Нечетные вспомогательные потоки начинают на полуход глубже, чтобы
+    // потоки чаще перебирали разные глубины и дополняли друг друга в таблице
+    int maxDepth = std::min(std::max(limits.depth, 1), MAX_PLY - 1);
+    int score = 0;
+    for (int depth = mainThread ? 1 : 1 + (id & 1); depth <= maxDepth; ++depth) {
+        int delta = ASPIRATION_WINDOW;
+        int alpha = -SCORE_INFINITE;
+        int beta = SCORE_INFINITE;
+        if (depth >= 4 && std::abs(score) < SCORE_WIN_THRESHOLD) {
+            alpha = std::max(score - delta, -SCORE_INFINITE);
+            beta = std::min(score + delta, SCORE_INFINITE);
+        }
+
+        PrincipalVariation pv;
+        int iterationScore;
+        for (;;) {
+            followPv = true;
+            iterationScore = negamax(state, depth, 0, alpha, beta, pv);
+            if (stopped) break;
+            if (iterationScore <= alpha) {
+                alpha = std::max(iterationScore - delta, -SCORE_INFINITE);
+            }
+            else if (iterationScore >= beta) {
+                beta = std::min(iterationScore + delta, SCORE_INFINITE);
+            }
+            else {
+                break;
+            }
+            delta *= 2;
+        }
+        if (stopped) break;
+
+        score = iterationScore;
+        previousPv = pv;
+        if (!mainThread) continue;
+
+        result.depth = depth;
+        result.score = score;
+        result.pv = pv;
+        if (pv.length > 0) result.bestMove = pv.moves[0];
+        result.nodes = owner.totalNodes();
+        result.timeMs = owner.elapsedMs();
+        result.hashfull = owner.tt.hashfull();
+        if (owner.infoCallback) owner.infoCallback(result);
+
+        if (std::abs(score) >= SCORE_WIN_THRESHOLD && SCORE_WIN - std::abs(score) <= depth) break;
+        if (limits.timeMs && !owner.pondering &&
+            (rootMoves.size() == 1 || (result.timeMs - owner.ponderHitMs) * 2 >= limits.timeMs)) {
+            break;
+        }
+    }
+    return result;
+}
+
+bool Searcher::Worker::countNode() {
+    uint64_t count = nodes.load(std::memory_order_relaxed) + 1;
+    nodes.store(count, std::memory_order_relaxed);
+    return (count & 1023) == 0 && checkLimits();
+}
+
+bool Searcher::Worker::checkLimits() {
+    const SearchLimits& limits = owner.limits;
+    if ((limits.nodes && owner.totalNodes() >= limits.nodes) || owner.outOfTime()) {
+        owner.stopFlag = true;
+    }
+    if (owner.stopFlag) stopped = true;
+    return stopped;
+}
+
+void Searcher::Worker::orderMoves(const MoveList& list, int ply, const Move* first, int* scores) const {
+    for (int i = 0; i < list.size(); ++i) {
+        const Move& move = list[i];
+        if (first && sameMove(move, *first)) {
+            scores[i] = SCORE_PREFERRED;
+        }
+        else if (isCapture(move)) {
+            scores[i] = SCORE_CAPTURE + popCount(move.captured) * 16 + move.promotes;
+        }
+        else if (move.promotes) {
+            scores[i] = SCORE_PROMOTION;
+        }
+        else if (sameMove(move, killers[ply][0])) {
+            scores[i] = SCORE_KILLER + 1;
+        }
+        else if (sameMove(move, killers[ply][1])) {
+            scores[i] = SCORE_KILLER;
+        }
+        else {
+            scores[i] = history[move.from][move.to];
+        }
+    }
+}
+
+void Searcher::Worker::updateHistory(const Move& move, int depth, int ply) {
+    if (isCapture(move)) return;
+    if (!sameMove(move, killers[ply][0])) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+    int& h = history[move.from][move.to];
+    h += depth * depth;
+    if (h > HISTORY_LIMIT) {
+        for (auto& row : history) {
+            for (int& value : row) value /= 2;
+        }
+    }
+}
+
+int Searcher::Worker::quiescence(GameState& state, int ply, int alpha, int beta, PrincipalVariation& pv) {
+    PROFILE_COUNT(PROFILE_QUIESCENCE_NODE);
+    pv.length = 0;
+    if (countNode()) return 0;
+
+    // Взятие обязательно, поэтому оценивать позицию можно только в спокойном положении
+    MoveList list;
+    generateCaptures(state, list);
+    if (list.empty()) {
+        return movers(state.board, state.currentTurn) ? evaluate(state, owner.weights) : -SCORE_WIN + ply;
+    }
+    if (ply >= MAX_PLY - 1) return evaluate(state, owner.weights);
+
+    int scores[MAX_MOVES];
+    orderMoves(list, ply, nullptr, scores);
+    int best = -SCORE_INFINITE;
+    PrincipalVariation child;
+    for (int i = 0; i < list.size(); ++i) {
+        const Move& move = pickMove(list, scores, i);
+        makeMove(state, move, undoStack[ply]);
+        int score = -quiescence(state, ply + 1, -beta, -alpha, child);
+        unmakeMove(state, undoStack[ply]);
+        if (stopped) return 0;
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(pv, move, child);
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    return best;
+}
+
+int Searcher::Worker::negamax(GameState& state, int depth, int ply, int alpha, int beta, PrincipalVariation& pv) {
+    if (depth <= 0) return quiescence(state, ply, alpha, beta, pv);
+    PROFILE_COUNT(PROFILE_SEARCH_NODE);
+
+    pv.length = 0;
+    if (countNode()) return 0;
+
+    // Повторение позиции на пути от корня возможно только ходами дамок
+    pathHashes[ply] = state.hash;
+    if (ply > 0 && state.board.kings) {
+        for (int i = ply - 2; i >= 0; i -= 2) {
+            if (pathHashes[i] == state.hash) return 0;
+        }
+    }
+
+    // Позиции из эндшпильных баз оцениваются точно
+    const Tablebase* tablebase = owner.tablebase;
+    if (tablebase && ply > 0 && popCount(state.board.white | state.board.black) <= tablebase->pieces()) {
+        TBProbe probe = tablebase->probe(state);
+        if (probe.outcome == TB_DRAW) return 0;
+        if (probe.outcome == TB_WIN) return SCORE_WIN - ply - probe.plies;
+        if (probe.outcome == TB_LOSS) return -SCORE_WIN + ply + probe.plies;
+    }
+
+    TTEntry entry;
+    bool hit = owner.tt.probe(state.hash, entry);
+    bool pvNode = beta - alpha > 1;
+    if (hit && !pvNode && entry.depth >= depth) {
+        int score = scoreFromTable(entry.score, ply);
+        if (entry.bound == BOUND_EXACT ||
+            (entry.bound == BOUND_LOWER && score >= beta) ||
+            (entry.bound == BOUND_UPPER && score <= alpha)) {
+            return score;
+        }
+    }
+
+    MoveList list;
+    generateMoves(state, list);
+    if (list.empty()) return -SCORE_WIN + ply;
+    if (ply >= MAX_PLY - 1) return evaluate(state, owner.weights);
+
+    // Первым пробуется ход из таблицы, а пока идем по главному варианту
+    // прошлой итерации — его ход
+    const Move* first = nullptr;
+    if (followPv) {
+        if (ply < previousPv.length) first = &previousPv.moves[ply];
+        else followPv = false;
+    }
+    if (!first && hit && entry.hasMove) {
+        for (const Move& move : list) {
+            if (matchesEntry(move, entry)) {
+                first = &move;
+                break;
+            }
+        }
+    }
+    int alphaOriginal = alpha;
+    Move bestMove;
+    bool hasBest = false;
+
+    int scores[MAX_MOVES];
+    orderMoves(list, ply, first, scores);
+    int best = -SCORE_INFINITE;
+    PrincipalVariation child;
+    for (int i = 0; i < list.size(); ++i) {
+        const Move& move = pickMove(list, scores, i);
+        followPv = followPv && i == 0 && first && sameMove(move, *first);
+        makeMove(state, move, undoStack[ply]);
+        // Корзина ребенка грузится, пока он проверяет повторения и базы
+        if (depth > 1) owner.tt.prefetch(state.hash);
+        int score;
+        if (i == 0) {
+            score = -negamax(state, depth - 1, ply + 1, -beta, -alpha, child);
+        }
+        else {
+            score = -negamax(state, depth - 1, ply + 1, -alpha - 1, -alpha, child);
+            if (score > alpha && score < beta && !stopped) {
+                score = -negamax(state, depth - 1, ply + 1, -beta, -alpha, child);
+            }
+        }
+        unmakeMove(state, undoStack[ply]);
+        if (stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                hasBest = true;
+                updatePv(pv, move, child);
+                if (alpha >= beta) {
+                    updateHistory(move, depth, ply);
+                    break;
+                }
+            }
+        }
+    }
+
+    Bound bound = best >= beta ? BOUND_LOWER : best > alphaOriginal ? BOUND_EXACT : BOUND_UPPER;
+    owner.tt.store(state.hash, scoreToTable(best, ply), depth, bound, hasBest ? &bestMove : nullptr);
+    return best;
+}
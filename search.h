@@ -0,0 +1,190 @@
+/**
+ * \file search.h
+ * \brief Перебор с альфа-бета отсечением для игры компьютера и анализа позиций.
+ *
+ * Negamax с итеративным углублением, окнами стремления (aspiration windows),
+ * поиском с нулевым окном (PVS), упорядочиванием ходов по убийцам и истории
+ * и форсированным продолжением взятий за горизонтом.
+ *
+ * Параллельный перебор устроен по схеме Lazy SMP: вспомогательные потоки
+ * независимо перебирают ту же позицию со сдвигом глубины и обмениваются
+ * результатами только через общую таблицу транспозиций.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eval.h"
+#include "movegen.h"
+#include "tablebase.h"
+#include "tt.h"
+
+const int MAX_PLY = 128; ///< Наибольшая глубина перебора в полуходах
+const int SCORE_INFINITE = 32000; ///< Граница окна поиска
+const int SCORE_WIN = 30000; ///< Оценка выигрыша на текущем ходу
+const int SCORE_WIN_THRESHOLD = SCORE_WIN - MAX_PLY; ///< Оценки выше означают форсированный выигрыш
+const int MAX_THREADS = 256; ///< Наибольшее число потоков перебора
+
+/**
+ * \brief Ограничения перебора; нулевое значение означает отсутствие ограничения.
+ */
+struct SearchLimits {
+    int depth = MAX_PLY - 1; ///< Глубина в полуходах
+    int64_t timeMs = 0; ///< Время на ход в миллисекундах
+    uint64_t nodes = 0; ///< Число узлов
+    bool ponder = false; ///< Обдумывание на времени соперника: время не ограничено до ponderHit()
+};
+
+/**
+ * \brief Главный вариант.
+ */
+struct PrincipalVariation {
+    Move moves[MAX_PLY]; ///< Ходы варианта
+    int length = 0; ///< Число ходов
+};
+
+/**
+ * \brief Результат перебора (и промежуточный отчет после каждой итерации).
+ */
+struct SearchResult {
+    Move bestMove; ///< Лучший ход
+    bool hasMove = false; ///< Есть ли допустимые ходы
+    int score = 0; ///< Оценка с точки зрения ходящей стороны
+    int depth = 0; ///< Глубина последней завершенной итерации
+    uint64_t nodes = 0; ///< Число просмотренных узлов (всеми потоками)
+    int64_t timeMs = 0; ///< Затраченное время
+    int threads = 1; ///< Число потоков перебора
+    int hashfull = 0; ///< Заполненность таблицы транспозиций текущим перебором, в тысячных
+    PrincipalVariation pv; ///< Главный вариант
+};
+
+/**
+ * \brief Перебор. Объект хранит таблицы упорядочивания ходов между вызовами.
+ *
+ * Один объект ведет один перебор за раз; stop() можно вызывать из другого потока.
+ * Главный поток перебора — поток, вызвавший search(); вспомогательные потоки
+ * создаются один раз в setThreads() и ждут следующего перебора.
+ */
+class Searcher {
+public:
+    /// Функция, получающая отчет после каждой завершенной итерации.
+    typedef std::function<void(const SearchResult&)> InfoCallback;
+
+    Searcher();
+    ~Searcher();
+
+    Searcher(const Searcher&) = delete;
+    Searcher& operator=(const Searcher&) = delete;
+
+    /**
+     * \brief Найти лучший ход.
+     * \param state Состояние партии
+     * \param limits Ограничения по глубине, времени и узлам
+     * \return Лучший ход, оценка и главный вариант.
+     */
+    SearchResult search(const GameState& state, const SearchLimits& limits);
+
+    /**
+     * \brief Прервать текущий перебор; search() вернет результат последней итерации.
+     */
+    void stop();
+
+    /**
+     * \brief Соперник сделал ожидаемый ход: обдумывание становится обычным перебором.
+     *
+     * Ограничение по времени отсчитывается с этого момента. Вызывается
+     * из другого потока во время перебора с SearchLimits::ponder;
+     * повторные вызовы ничего не меняют.
+     */
+    void ponderHit();
+
+    /**
+     * \brief Установить функцию для промежуточных отчетов.
+     */
+    void setInfoCallback(InfoCallback callback);
+
+    /**
+     * \brief Очистить таблицу транспозиций и таблицы убийц и истории (новая партия).
+     */
+    void clear();
+
+    /**
+     * \brief Задать размер таблицы транспозиций.
+     * \param megabytes Размер в мегабайтах
+     */
+    void setHashSize(size_t megabytes);
+
+    /**
+     * \brief Задать число потоков перебора.
+     *
+     * Нельзя вызывать во время перебора.
+     * \param count Число потоков (1..MAX_THREADS), включая главный
+     */
+    void setThreads(int count);
+
+    /**
+     * \brief Число потоков перебора.
+     */
+    int threads() const { return int(workers.size()); }
+
+    /**
+     * \brief Подключить эндшпильные базы (nullptr — отключить).
+     *
+     * Позиции из баз оцениваются точно и дальше не перебираются.
+     * Объект баз должен жить, пока идут переборы.
+     */
+    void setTablebase(const Tablebase* tablebase) { this->tablebase = tablebase; }
+
+    /**
+     * \brief Задать веса оценки. Нельзя вызывать во время перебора.
+     */
+    void setEvalWeights(const EvalWeights& weights) { this->weights = weights; }
+
+    /**
+     * \brief Веса оценки.
+     */
+    const EvalWeights& evalWeights() const { return weights; }
+
+    /**
+     * \brief Таблица транспозиций.
+     */
+    TranspositionTable& table() { return tt; }
+
+private:
+    struct Worker;
+
+    void helperLoop(Worker& worker, uint64_t seen);
+    void stopHelpers();
+    uint64_t totalNodes() const;
+    int64_t elapsedMs() const;
+    bool outOfTime() const;
+
+    TranspositionTable tt;
+    const Tablebase* tablebase;
+    EvalWeights weights;
+    std::vector<std::unique_ptr<Worker>> workers; ///< workers[0] — главный поток
+    std::vector<std::thread> helpers;
+    std::mutex mutex;
+    std::condition_variable wakeUp; ///< Начало перебора или завершение работы
+    std::condition_variable helpersDone; ///< Все вспомогательные потоки закончили перебор
+    uint64_t searchId; ///< Номер текущего перебора
+    int running; ///< Число вспомогательных потоков, еще не закончивших перебор
+    bool quit;
+
+    GameState root;
+    SearchLimits limits;
+    std::atomic<bool> stopFlag;
+    std::atomic<bool> pondering; ///< Идет обдумывание, время не ограничено
+    std::atomic<int64_t> ponderHitMs; ///< Время от начала перебора до ponderHit()
+    std::atomic<int64_t> startTicks; ///< Начало перебора в тактах steady_clock; читается и в ponderHit()
+    InfoCallback infoCallback;
+};
@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gamerecord.h"
+#include "mcts.h"
+#include "notation.h"
+#include "search.h"
+#include "tablebase.h"
+
+namespace {
+
+/**
+ * \brief Настройки одного движка: "depth=8,movetime=100,nodes=0,tc=10000+100,hash=16,threads=1,eval=weights.txt,name=new".
+ *
+ * С mcts=uct или mcts=puct движок перебирает Монте-Карло: nodes задает
+ * число случайных партий на ход, hash — размер арены узлов, depth не
+ * используется.
+ */
+struct EngineConfig {
+    std::string name;
+    SearchLimits limits; ///< Глубина, время и узлы на ход
+    int64_t clockMs = 0; ///< Время на партию (0 — без часов)
+    int64_t incrementMs = 0; ///< Добавка за ход
+    size_t hashMb = 16;
+    int threads = 1;
+    EvalWeights weights; ///< Веса оценки (по умолчанию или из файла eval=)
+    bool mcts = false; ///< Перебор Монте-Карло вместо альфа-беты
+    MctsPolicy policy = MCTS_PUCT;
+};
+
+bool parseEngine(const std::string& spec, EngineConfig& config) {
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        if (key == "name") {
+            config.name = value;
+        }
+        else if (key == "depth") {
+            config.limits.depth = atoi(value.c_str());
+        }
+        else if (key == "movetime") {
+            config.limits.timeMs = atoll(value.c_str());
+        }
+        else if (key == "nodes") {
+            config.limits.nodes = strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (key == "tc") {
+            size_t plus = value.find('+');
+            config.clockMs = atoll(value.substr(0, plus).c_str());
+            config.incrementMs = plus == std::string::npos ? 0 : atoll(value.substr(plus + 1).c_str());
+        }
+        else if (key == "hash") {
+            config.hashMb = size_t(atoi(value.c_str()));
+        }
+        else if (key == "threads") {
+            config.threads = atoi(value.c_str());
+        }
+        else if (key == "eval") {
+            std::ifstream in(value);
+            if (!in || !readEvalWeights(in, config.weights)) return false;
+        }
+        else if (key == "mcts") {
+            if (value != "uct" && value != "puct") return false;
+            config.mcts = true;
+            config.policy = value == "uct" ? MCTS_UCT : MCTS_PUCT;
+        }
+        else {
+            return false;
+        }
+    }
+    return config.limits.depth >= 1 && config.threads >= 1;
+}
+
+/**
+ * \brief Сыгранная партия и движки, игравшие ее.
+ *
+ * Время каждого хода записывается в комментарий к нему ("book" для ходов дебюта).
+ */
+struct GameRecord {
+    const EngineConfig* white;
+    const EngineConfig* black;
+    Game game;
+};
+
+/**
+ * \brief Счет первого движка против второго.
+ */
+struct Tally {
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+};
+
+double eloFromScore(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+/**
+ * \brief Разница Эло и половина 95% доверительного интервала.
+ */
+void eloWithError(const Tally& tally, double& elo, double& error) {
+    int n = tally.games();
+    double s = tally.score();
+    elo = eloFromScore(s);
+    error = 0;
+    if (n < 2) return;
+    double variance = (tally.wins * (1 - s) * (1 - s) + tally.draws * (0.5 - s) * (0.5 - s) + tally.losses * s * s) / n;
+    double margin = 1.96 * std::sqrt(variance / n);
+    error = (eloFromScore(s + margin) - eloFromScore(s - margin)) / 2;
+}
+
+/**
+ * \brief Случайный дебют из plies ходов, одинаковый для пары партий с обменом цветов.
+ */
+std::vector<Move> randomOpening(uint64_t seed, int plies) {
+    std::mt19937_64 rng(seed);
+    for (;;) {
+        GameState game;
+        initBoard(game);
+        std::vector<Move> moves;
+        MoveList list;
+        for (int i = 0; i < plies; ++i) {
+            generateMoves(game, list);
+            if (list.empty()) break;
+            const Move& move = list[int(rng() % list.size())];
+            moves.push_back(move);
+            makeMove(game, move);
+        }
+        generateMoves(game, list);
+        if (!list.empty()) return moves;
+    }
+}
+
+/**
+ * \brief Партия до конца, повторения позиции трижды или предела длины.
+ */
+class GamePlayer {
+public:
+    GamePlayer(const EngineConfig& first, const EngineConfig& second, const Tablebase* tablebase) {
+        configs[0] = &first;
+        configs[1] = &second;
+        for (int i = 0; i < 2; ++i) {
+            searchers[i].setHashSize(configs[i]->hashMb);
+            searchers[i].setThreads(configs[i]->threads);
+            searchers[i].setTablebase(tablebase);
+            searchers[i].setEvalWeights(configs[i]->weights);
+            if (configs[i]->mcts) {
+                mctsSearchers[i].setMemory(configs[i]->hashMb);
+                mctsSearchers[i].setThreads(configs[i]->threads);
+                mctsSearchers[i].setPolicy(configs[i]->policy);
+                mctsSearchers[i].setEvalWeights(configs[i]->weights);
+            }
+        }
+        this->tablebase = tablebase;
+    }
+
+    GameRecord play(int number, const std::vector<Move>& opening, int maxPlies);
+
+private:
+    const EngineConfig* configs[2];
+    Searcher searchers[2];
+    MctsSearcher mctsSearchers[2];
+    const Tablebase* tablebase;
+};
+
+GameRecord GamePlayer::play(int number, const std::vector<Move>& opening, int maxPlies) {
+    // В четных партиях белыми играет первый движок, в нечетных — второй
+    int whiteEngine = number % 2;
+    GameRecord record;
+    record.white = configs[whiteEngine];
+    record.black = configs[1 - whiteEngine];
+    Game& played = record.game;
+    played.setTag("Event", "selfplay");
+    played.setTag("Round", std::to_string(number + 1));
+    played.setTag("White", record.white->name);
+    played.setTag("Black", record.black->name);
+    std::string reason;
+
+    GameState game = played.start;
+    std::vector<uint64_t> hashes{game.hash};
+    for (const Move& move : opening) {
+        makeMove(game, move);
+        played.addMove(move, "book");
+        hashes.push_back(game.hash);
+    }
+    int64_t clocks[2] = {configs[0]->clockMs, configs[1]->clockMs};
+    for (auto& searcher : searchers) searcher.clear();
+
+    MoveList list;
+    for (;;) {
+        bool whiteToMove = game.currentTurn == WHITE_TURN;
+        GameResult moverLoses = whiteToMove ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+        generateMoves(game, list);
+        if (list.empty()) {
+            played.result = moverLoses;
+            reason = "no moves";
+            break;
+        }
+        if (std::count(hashes.begin(), hashes.end(), game.hash) >= 3) {
+            played.result = RESULT_DRAW;
+            reason = "repetition";
+            break;
+        }
+        if (int(played.moves.size()) >= maxPlies) {
+            played.result = RESULT_DRAW;
+            reason = "move limit";
+            break;
+        }
+        if (tablebase) {
+            TBProbe probe = tablebase->probe(game);
+            if (probe.outcome != TB_UNKNOWN) {
+                played.result = probe.outcome == TB_DRAW ? RESULT_DRAW : probe.outcome == TB_WIN ? (whiteToMove ? RESULT_WHITE_WINS : RESULT_BLACK_WINS) : moverLoses;
+                reason = "tablebase";
+                break;
+            }
+        }
+
+        int engine = whiteToMove ? whiteEngine : 1 - whiteEngine;
+        const EngineConfig& config = *configs[engine];
+        SearchLimits limits = config.limits;
+        if (config.clockMs) {
+            int64_t budget = clocks[engine] / 30 + config.incrementMs;
+            limits.timeMs = limits.timeMs ? std::min(limits.timeMs, budget) : budget;
+        }
+        auto start = std::chrono::steady_clock::now();
+        Move bestMove;
+        if (config.mcts) {
+            MctsLimits mctsLimits;
+            mctsLimits.playouts = limits.nodes;
+            mctsLimits.timeMs = limits.timeMs;
+            if (!mctsLimits.playouts && !mctsLimits.timeMs) mctsLimits.playouts = 10000;
+            bestMove = mctsSearchers[engine].search(game, mctsLimits).bestMove;
+        }
+        else {
+            bestMove = searchers[engine].search(game, limits).bestMove;
+        }
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (config.clockMs) {
+            clocks[engine] -= us / 1000;
+            if (clocks[engine] < 0) {
+                played.result = moverLoses;
+                reason = "time forfeit";
+                break;
+            }
+            clocks[engine] += config.incrementMs;
+        }
+
+        makeMove(game, bestMove);
+        std::ostringstream comment;
+        comment << us / 1000 << "." << us / 100 % 10 << "ms";
+        played.addMove(bestMove, comment.str());
+        hashes.push_back(game.hash);
+    }
+    played.setTag("Termination", reason);
+    return record;
+}
+
+} // namespace
+
+/**
+ * \brief Матч двух настроек движка: партии играются параллельно, по одной на поток.
+ *
+ * Партии идут парами: один и тот же случайный дебют играется с обменом
+ * цветов. Каждая партия сразу дописывается в файл; по ходу матча
+ * печатаются скорость, счет и разница Эло первого движка с 95% интервалом.
+ *
+ * Использование: selfplay [-g партий] [-j потоков] [-r ходов дебюта]
+ *   [-m предел полуходов] [-s зерно] [-o файл .pdn или .cgr] [--tb каталог]
+ *   [-e1 настройки] [-e2 настройки]
+ * Настройки: depth=N,movetime=мс,nodes=N,tc=мс+мс,hash=МБ,threads=N,eval=файл весов,mcts=uct|puct,name=имя
+ */
+int main(int argc, char* argv[]) {
+    int games = 100;
+    int workers = int(std::max(1u, std::thread::hardware_concurrency()));
+    int openingPlies = 4;
+    int maxPlies = 300;
+    uint64_t seed = 1;
+    std::string output = "selfplay.pdn";
+    std::string tablebaseDir;
+    EngineConfig engines[2];
+    engines[0].name = "engine1";
+    engines[1].name = "engine2";
+    engines[0].limits.depth = engines[1].limits.depth = 6;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-g" && hasValue) {
+            games = atoi(argv[++i]);
+        }
+        else if (arg == "-j" && hasValue) {
+            workers = atoi(argv[++i]);
+        }
+        else if (arg == "-r" && hasValue) {
+            openingPlies = atoi(argv[++i]);
+        }
+        else if (arg == "-m" && hasValue) {
+            maxPlies = atoi(argv[++i]);
+        }
+        else if (arg == "-s" && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "-o" && hasValue) {
+            output = argv[++i];
+        }
+        else if (arg == "--tb" && hasValue) {
+            tablebaseDir = argv[++i];
+        }
+        else if ((arg == "-e1" || arg == "-e2") && hasValue) {
+            if (!parseEngine(argv[++i], engines[arg == "-e1" ? 0 : 1])) {
+                std::cerr << "Invalid engine settings: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Usage: selfplay [-g games] [-j workers] [-r opening plies] [-m max plies] [-s seed] [-o file] "
+                         "[--tb directory] [-e1 settings] [-e2 settings]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (games < 1 || workers < 1 || openingPlies < 0 || maxPlies < 1) {
+        std::cerr << "Invalid arguments" << std::endl;
+        return 1;
+    }
+    workers = std::min(workers, games);
+
+    Tablebase tablebase;
+    if (!tablebaseDir.empty()) {
+        int loaded = tablebase.load(tablebaseDir);
+        std::cout << "Tablebases: " << loaded << " slices, complete up to " << tablebase.pieces() << " pieces" << std::endl;
+    }
+    bool binary = isBinaryArchive(output);
+    std::ofstream out(output, binary ? std::ios::binary | std::ios::app | std::ios::ate : std::ios::app);
+    if (!out) {
+        std::cerr << "Cannot open " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << engines[0].name << " vs " << engines[1].name << ": " << games << " games, " << workers << " workers" << std::endl;
+    PdnWriter pdnWriter(out);
+    BinaryGameWriter binaryWriter(out);
+    std::mutex mutex;
+    std::atomic<int> nextGame(0);
+    Tally tally;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        std::unique_ptr<GamePlayer> player(new GamePlayer(engines[0], engines[1], tablebaseDir.empty() ? nullptr : &tablebase));
+        for (int number = nextGame++; number < games; number = nextGame++) {
+            GameRecord record = player->play(number, randomOpening(seed + number / 2, openingPlies), maxPlies);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (binary) binaryWriter.write(record.game);
+            else pdnWriter.write(record.game);
+            out.flush();
+            bool firstIsWhite = record.white == &engines[0];
+            if (record.game.result == RESULT_DRAW) ++tally.draws;
+            else if ((record.game.result == RESULT_WHITE_WINS) == firstIsWhite) ++tally.wins;
+            else ++tally.losses;
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double elo, error;
+            eloWithError(tally, elo, error);
+            std::cout << "Game " << std::setw(5) << tally.games() << "/" << games << "  +" << tally.wins << " ="
+                      << tally.draws << " -" << tally.losses << std::fixed << std::setprecision(1) << "  Elo "
+                      << elo << " +/- " << error << std::setprecision(2) << "  " << tally.games() / seconds
+                      << " games/s" << std::defaultfloat << std::endl;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i) threads.emplace_back(worker);
+    for (auto& thread : threads) thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double elo, error;
+    eloWithError(tally, elo, error);
+    std::cout << "Final: " << engines[0].name << " scored " << tally.score() * 100 << "% (+" << tally.wins << " ="
+              << tally.draws << " -" << tally.losses << "), Elo " << elo << " +/- " << error << ", "
+              << tally.games() / seconds << " games/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gameserver.h"
+
+namespace {
+
+const size_t MAX_LINE = 4096; ///< Клиент с более длинной строкой отключается
+const int MAX_EVENTS = 256;
+
+/**
+ * \brief Соединение: непрочитанный остаток ввода и неотправленный вывод.
+ */
+struct Connection {
+    bool open = false;
+    bool waitingWrite = false; ///< Подписано ли соединение на EPOLLOUT
+    std::string input;
+    std::string output;
+};
+
+uint64_t residentBytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int listenTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(uint16_t(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listenUnix(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+/**
+ * \brief Сервер партий: все партии в одном процессе, один поток с epoll.
+ *
+ * Протокол описан в gameserver.h. Ответы копятся в буфере соединения и
+ * отправляются после обработки всех готовых событий, так что обновления
+ * одного цикла уходят одним вызовом write на соединение.
+ *
+ * Использование: gameserver [-p порт (7878)] [-u путь к сокету Unix] [-q]
+ */
+int main(int argc, char* argv[]) {
+    int port = 7878;
+    std::string unixPath;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-p" && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        }
+        else if (arg == "-u" && i + 1 < argc) {
+            unixPath = argv[++i];
+        }
+        else if (arg == "-q") {
+            quiet = true;
+        }
+        else {
+            std::cerr << "Usage: gameserver [-p port] [-u unix socket path] [-q]" << std::endl;
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    int listener = unixPath.empty() ? listenTcp(port) : listenUnix(unixPath);
+    if (listener < 0 || !setNonBlocking(listener)) {
+        std::cerr << "Cannot listen: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    int poller = epoll_create1(0);
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    epoll_ctl(poller, EPOLL_CTL_ADD, listener, &event);
+
+    std::vector<Connection> connections; // По номеру дескриптора
+    std::vector<int> pendingOutput; // Соединения, которым есть что отправить
+    GameServer server([&](int client, const std::string& text) {
+        Connection& connection = connections[client];
+        if (connection.output.empty()) pendingOutput.push_back(client);
+        connection.output += text;
+    });
+    server.setMemoryUsage(residentBytes);
+    std::cout << "Listening on " << (unixPath.empty() ? "127.0.0.1:" + std::to_string(port) : unixPath) << std::endl;
+
+    auto closeConnection = [&](int fd) {
+        if (!connections[fd].open) return;
+        epoll_ctl(poller, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections[fd] = Connection();
+        server.disconnect(fd);
+    };
+
+    // Отправить накопленное; остаток ждет EPOLLOUT
+    auto flush = [&](int fd) {
+        Connection& connection = connections[fd];
+        size_t sent = 0;
+        while (sent < connection.output.size()) {
+            ssize_t written = write(fd, connection.output.data() + sent, connection.output.size() - sent);
+            if (written > 0) {
+                sent += size_t(written);
+                continue;
+            }
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            closeConnection(fd);
+            return;
+        }
+        connection.output.erase(0, sent);
+        bool wantWrite = !connection.output.empty();
+        if (wantWrite != connection.waitingWrite) {
+            epoll_event change;
+            memset(&change, 0, sizeof(change));
+            change.events = wantWrite ? uint32_t(EPOLLIN | EPOLLOUT) : uint32_t(EPOLLIN);
+            change.data.fd = fd;
+            epoll_ctl(poller, EPOLL_CTL_MOD, fd, &change);
+            connection.waitingWrite = wantWrite;
+        }
+    };
+
+    epoll_event events[MAX_EVENTS];
+    char buffer[65536];
+    auto reportTime = std::chrono::steady_clock::now();
+    uint64_t reportedMoves = 0;
+    for (;;) {
+        int count = epoll_wait(poller, events, MAX_EVENTS, 1000);
+        if (count < 0 && errno != EINTR) break;
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                for (;;) {
+                    int client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+                    if (client < 0) break;
+                    int one = 1;
+                    if (unixPath.empty()) setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    if (size_t(client) >= connections.size()) connections.resize(size_t(client) * 2 + 1);
+                    connections[client] = Connection();
+                    connections[client].open = true;
+                    epoll_event added;
+                    memset(&added, 0, sizeof(added));
+                    added.events = EPOLLIN;
+                    added.data.fd = client;
+                    epoll_ctl(poller, EPOLL_CTL_ADD, client, &added);
+                }
+                continue;
+            }
+            if (!connections[fd].open) continue;
+
+            if (events[i].events & EPOLLOUT) flush(fd);
+            if (!connections[fd].open || !(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+            bool closed = false;
+            for (;;) {
+                ssize_t got = read(fd, buffer, sizeof(buffer));
+                if (got > 0) {
+                    connections[fd].input.append(buffer, size_t(got));
+                    continue;
+                }
+                if (got < 0 && errno == EINTR) continue;
+                closed = got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+
+            // Выполнить все полные строки
+            std::string& input = connections[fd].input;
+            size_t start = 0;
+            std::string line;
+            for (size_t end = input.find('\n'); end != std::string::npos; end = input.find('\n', start)) {
+                line.assign(input, start, end - start);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                start = end + 1;
+                if (!line.empty()) server.handle(fd, line);
+            }
+            input.erase(0, start);
+            if (closed || input.size() > MAX_LINE) closeConnection(fd);
+        }
+
+        // Закрытие соединения при отправке может добавить в список новые
+        for (size_t k = 0; k < pendingOutput.size(); ++k) {
+            if (connections[pendingOutput[k]].open) flush(pendingOutput[k]);
+        }
+        pendingOutput.clear();
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - reportTime).count();
+        if (!quiet && seconds >= 5) {
+            uint64_t moves = server.movesValidated();
+            std::cout << "Sessions " << server.sessions().active() << ", " << (moves - reportedMoves) / seconds
+                      << " moves/s, pool " << server.sessions().memoryBytes() / 1024 << " KB, RSS "
+                      << residentBytes() / (1024 * 1024) << " MB" << std::endl;
+            reportTime = now;
+            reportedMoves = moves;
+        }
+    }
+    return 0;
+}
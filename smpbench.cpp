@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "benchsuite.h"
+#include "search.h"
+
+namespace {
+
+struct BenchTotals {
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+BenchTotals runBench(Searcher& searcher, int depth, bool verbose) {
+    BenchTotals totals;
+    SearchLimits limits;
+    limits.depth = depth;
+    for (const char* fen : BENCH_POSITIONS) {
+        GameState game;
+        parseFen(fen, game);
+        searcher.clear();
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = searcher.search(game, limits);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totals.nodes += result.nodes;
+        totals.seconds += seconds;
+        if (verbose) {
+            std::cout << "  " << std::setw(52) << std::left << fen << std::right
+                      << " " << moveToString(result.bestMove) << " score " << result.score
+                      << " nodes " << result.nodes << std::endl;
+        }
+    }
+    return totals;
+}
+
+} // namespace
+
+/**
+ * \brief Масштабирование параллельного перебора: время до заданной глубины
+ * на постоянном наборе позиций при разном числе потоков.
+ *
+ * Ускорение считается по отношению ко времени при первом числе потоков
+ * в списке. Таблица транспозиций очищается перед каждой позицией.
+ *
+ * Использование: smpbench [-d глубина] [-h мегабайты] [-v] [потоки...]
+ * (по умолчанию глубина 14 и потоки 1 2 4 8 16)
+ */
+int main(int argc, char* argv[]) {
+    int depth = 14;
+    size_t hashMb = 64;
+    bool verbose = false;
+    std::vector<int> threadCounts;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            hashMb = size_t(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        }
+        else {
+            int count = atoi(argv[i]);
+            if (count < 1 || count > MAX_THREADS) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+            threadCounts.push_back(count);
+        }
+    }
+    if (threadCounts.empty()) threadCounts = {1, 2, 4, 8, 16};
+    if (depth < 1) {
+        std::cerr << "Depth must be at least 1" << std::endl;
+        return 1;
+    }
+
+    Searcher searcher;
+    searcher.setHashSize(hashMb);
+    std::cout << "Depth " << depth << ", hash " << hashMb << " MB, "
+              << BENCH_POSITION_COUNT << " positions" << std::endl;
+    std::cout << "threads      time, s        nodes     nodes/s  speedup  nps scaling" << std::endl;
+
+    double baseSeconds = 0;
+    double baseNps = 0;
+    for (int count : threadCounts) {
+        searcher.setThreads(count);
+        BenchTotals totals = runBench(searcher, depth, verbose);
+        double nps = totals.nodes / (totals.seconds > 0 ? totals.seconds : 1e-9);
+        if (baseSeconds == 0) {
+            baseSeconds = totals.seconds;
+            baseNps = nps;
+        }
+        std::cout << std::setw(7) << count << std::fixed << std::setprecision(3)
+                  << std::setw(13) << totals.seconds << std::setw(13) << totals.nodes
+                  << std::setw(12) << uint64_t(nps) << std::setprecision(2)
+                  << std::setw(9) << baseSeconds / totals.seconds << std::setw(13) << nps / baseNps
+                  << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,530 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "mappedfile.h"
+#include "movegen.h"
+
+namespace {
+
+const Bitboard WHITE_MEN_SQUARES = ~TOP_ROW; ///< Простая белая не стоит в ряду превращения
+const Bitboard BLACK_MEN_SQUARES = ~BOTTOM_ROW; ///< То же для черной
+const int MATERIAL_DIM = TB_MAX_PIECES + 1;
+
+const char TB_MAGIC[4] = {'C', 'K', 'T', 'B'};
+const uint32_t TB_VERSION = 1;
+
+/**
+ * \brief Заголовок файла среза; за ним следуют count байт значений.
+ */
+struct TBHeader {
+    char magic[4];
+    uint32_t version;
+    uint8_t material[4]; ///< Простые и дамки белых, простые и дамки черных
+    uint32_t headerSize;
+    uint64_t count;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(TBHeader) == 32, "the tablebase header must stay 32 bytes");
+
+struct BinomialTable {
+    uint64_t c[squareCount + 1][squareCount + 1];
+};
+
+constexpr BinomialTable makeBinomialTable() {
+    BinomialTable table{};
+    for (int n = 0; n <= squareCount; ++n) {
+        table.c[n][0] = 1;
+        for (int k = 1; k <= n; ++k) {
+            table.c[n][k] = table.c[n - 1][k - 1] + (k < n ? table.c[n - 1][k] : 0);
+        }
+    }
+    return table;
+}
+
+constexpr BinomialTable BINOMIAL = makeBinomialTable();
+
+uint64_t binomial(int n, int k) {
+    return k < 0 || k > n ? 0 : BINOMIAL.c[n][k];
+}
+
+/**
+ * \brief Номер k-го по возрастанию поля набора.
+ */
+int nthSquare(Bitboard set, int k) {
+    for (; k > 0; --k) set &= set - 1;
+    return lowestSquare(set);
+}
+
+/**
+ * \brief Номер набора полей среди всех наборов того же размера из available
+ * (комбинаторная система счисления; поля нумеруются внутри available).
+ */
+uint64_t rankSquares(Bitboard set, Bitboard available) {
+    uint64_t rank = 0;
+    for (int i = 1; set; set &= set - 1, ++i) {
+        int s = lowestSquare(set);
+        rank += binomial(popCount(available & ((Bitboard(1) << s) - 1)), i);
+    }
+    return rank;
+}
+
+Bitboard unrankSquares(uint64_t rank, int count, Bitboard available) {
+    Bitboard set = 0;
+    int r = popCount(available);
+    for (int i = count; i >= 1; --i) {
+        do {
+            --r;
+        } while (binomial(r, i) > rank);
+        rank -= binomial(r, i);
+        set |= Bitboard(1) << nthSquare(available, r);
+    }
+    return set;
+}
+
+Bitboard reverseBits(Bitboard b) {
+    b = ((b >> 1) & 0x55555555u) | ((b & 0x55555555u) << 1);
+    b = ((b >> 2) & 0x33333333u) | ((b & 0x33333333u) << 2);
+    b = ((b >> 4) & 0x0F0F0F0Fu) | ((b & 0x0F0F0F0Fu) << 4);
+    b = ((b >> 8) & 0x00FF00FFu) | ((b & 0x00FF00FFu) << 8);
+    return (b >> 16) | (b << 16);
+}
+
+int materialKey(const Material& m) {
+    return ((m.whiteMen * MATERIAL_DIM + m.whiteKings) * MATERIAL_DIM + m.blackMen) * MATERIAL_DIM + m.blackKings;
+}
+
+Material mirrorMaterial(const Material& m) {
+    return Material{m.blackMen, m.blackKings, m.whiteMen, m.whiteKings};
+}
+
+/**
+ * \brief Все срезы не более чем из pieces фигур, у каждой стороны хотя бы одна.
+ *
+ * Порядок — по числу фигур, затем по числу простых шашек: взятие уменьшает
+ * первое, превращение — второе, поэтому все срезы, в которые можно попасть
+ * из данного (кроме зеркального), идут раньше.
+ */
+std::vector<Material> listMaterials(int pieces) {
+    std::vector<Material> list;
+    for (int wm = 0; wm <= pieces; ++wm) {
+        for (int wk = 0; wm + wk <= pieces; ++wk) {
+            for (int bm = 0; wm + wk + bm <= pieces; ++bm) {
+                for (int bk = 0; wm + wk + bm + bk <= pieces; ++bk) {
+                    if (wm + wk > 0 && bm + bk > 0) list.push_back(Material{wm, wk, bm, bk});
+                }
+            }
+        }
+    }
+    std::stable_sort(list.begin(), list.end(), [](const Material& a, const Material& b) {
+        if (a.pieces() != b.pieces()) return a.pieces() < b.pieces();
+        return a.whiteMen + a.blackMen < b.whiteMen + b.blackMen;
+    });
+    return list;
+}
+
+/**
+ * \brief Выполнить fn(begin, end, thread) над частями диапазона [0, count) в нескольких потоках.
+ */
+template <typename Fn>
+void parallelFor(uint64_t count, int threads, Fn fn) {
+    uint64_t chunk = (count + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        uint64_t begin = std::min(count, chunk * t);
+        uint64_t end = std::min(count, begin + chunk);
+        workers.emplace_back([&fn, begin, end, t] { fn(begin, end, t); });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+/**
+ * \brief Перебрать позиции, из которых черные одним тихим ходом без
+ * превращения пришли в board (ход белых).
+ *
+ * Ход был возможен, только если у черных не было взятий.
+ */
+template <typename Fn>
+void forEachPredecessor(const Position& board, Fn fn) {
+    Bitboard empty = emptySquares(board);
+    for (Bitboard men = board.black & ~board.kings; men; men &= men - 1) {
+        Bitboard to = men & (0 - men);
+        for (Direction dir : {UP_LEFT, UP_RIGHT}) {
+            Bitboard from = shift(to, dir);
+            if (!(from & empty)) continue;
+            Position previous = board;
+            previous.black ^= from | to;
+            if (!jumpers(previous, BLACK_TURN)) fn(previous);
+        }
+    }
+    for (Bitboard kings = board.black & board.kings; kings; kings &= kings - 1) {
+        Bitboard to = kings & (0 - kings);
+        for (Direction dir : {UP_LEFT, UP_RIGHT, DOWN_LEFT, DOWN_RIGHT}) {
+            for (Bitboard from = shift(to, dir); from & empty; from = shift(from, dir)) {
+                Position previous = board;
+                previous.black ^= from | to;
+                previous.kings ^= from | to;
+                if (!jumpers(previous, BLACK_TURN)) fn(previous);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Построение баз обратным анализом.
+ *
+ * Ходы внутри группы из среза и зеркального ему — это тихие ходы без
+ * превращения; остальные ходы ведут в уже решенные срезы. Для каждой позиции
+ * один раз генерируются ходы: запоминаются лучший известный проигрыш
+ * соперника, самый долгий его выигрыш и число ходов внутри группы. Дальше
+ * позиции решаются по уровням — числу полуходов до конца партии: решенная
+ * на уровне k позиция обратными ходами обновляет своих предшественников,
+ * и только они могут решиться на уровне k + 1.
+ */
+class Generator {
+public:
+    explicit Generator(int threads) : threadCount(std::max(threads, 1)), maxPliesSoFar(0), tables(size_t(MATERIAL_DIM) * MATERIAL_DIM * MATERIAL_DIM * MATERIAL_DIM) {}
+
+    bool solve(const std::vector<Material>& group);
+    const std::vector<uint8_t>& table(const Material& material) const { return tables[materialKey(material)]; }
+
+private:
+    static const uint8_t NONE = 255;
+
+    /// Счетчики позиций среза на время решения группы
+    struct Counters {
+        explicit Counters(uint64_t size) : remaining(size), bestLoss(size), longestWin(size), drawn(size) {}
+
+        std::vector<std::atomic<uint8_t>> remaining; ///< Нерешенные ходы внутри группы
+        std::vector<std::atomic<uint8_t>> bestLoss; ///< Кратчайший известный проигрыш соперника или NONE
+        std::vector<std::atomic<uint8_t>> longestWin; ///< Самый долгий известный выигрыш соперника или NONE
+        std::vector<uint8_t> drawn; ///< Есть ход в ничью из решенного среза
+    };
+
+    uint8_t childValue(const GameState& child) const;
+    void initialize(const Material& material, Counters& counters);
+    int resolveLevel(const Material& material, Counters& counters, int level, std::vector<std::vector<uint64_t>>& resolved);
+    void updatePredecessors(const Material& material, const std::vector<std::vector<uint64_t>>& resolved,
+                            const Material& mirror, Counters& mirrorCounters);
+
+    int threadCount;
+    int maxPliesSoFar;
+    std::vector<std::vector<uint8_t>> tables;
+};
+
+/**
+ * \brief Записать в счетчик меньшее (или большее) из значений.
+ */
+void storeMin(std::atomic<uint8_t>& slot, uint8_t value) {
+    uint8_t current = slot.load(std::memory_order_relaxed);
+    while ((current == 255 || value < current) && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void storeMax(std::atomic<uint8_t>& slot, uint8_t value) {
+    uint8_t current = slot.load(std::memory_order_relaxed);
+    while ((current == 255 || value > current) && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint8_t Generator::childValue(const GameState& child) const {
+    Position board = child.currentTurn == WHITE_TURN ? child.board : flipPosition(child.board);
+    if (!board.white) return 1; // У ходящей стороны не осталось фигур: проигрыш за 0 полуходов
+    Material material = materialOf(board);
+    return tables[materialKey(material)][tablebaseIndex(board, material)];
+}
+
+void Generator::initialize(const Material& material, Counters& counters) {
+    std::vector<uint8_t>& values = tables[materialKey(material)];
+    parallelFor(values.size(), threadCount, [&](uint64_t begin, uint64_t end, int) {
+        GameState state;
+        state.currentTurn = WHITE_TURN;
+        state.hash = 0;
+        MoveList list;
+        for (uint64_t i = begin; i < end; ++i) {
+            uint8_t bestLoss = NONE;
+            uint8_t longestWin = NONE;
+            uint8_t remaining = 0;
+            uint8_t drawn = 0;
+            if (!tablebasePosition(material, i, state.board)) {
+                values[i] = TB_VALUE_INVALID;
+            }
+            else {
+                values[i] = TB_VALUE_DRAW;
+                updateCaptureMaps(state);
+                generateMoves(state, list);
+                for (const Move& move : list) {
+                    if (!isCapture(move) && !move.promotes) {
+                        ++remaining;
+                        continue;
+                    }
+                    GameState child = state;
+                    makeMove(child, move);
+                    uint8_t value = childValue(child);
+                    if (value == TB_VALUE_DRAW) {
+                        drawn = 1;
+                    }
+                    else if (value & 1) {
+                        if (bestLoss == NONE || value - 1 < bestLoss) bestLoss = uint8_t(value - 1);
+                    }
+                    else if (longestWin == NONE || value - 1 > longestWin) {
+                        longestWin = uint8_t(value - 1);
+                    }
+                }
+            }
+            counters.remaining[i].store(remaining, std::memory_order_relaxed);
+            counters.bestLoss[i].store(bestLoss, std::memory_order_relaxed);
+            counters.longestWin[i].store(longestWin, std::memory_order_relaxed);
+            counters.drawn[i] = drawn;
+        }
+    });
+}
+
+int Generator::resolveLevel(const Material& material, Counters& counters, int level, std::vector<std::vector<uint64_t>>& resolved) {
+    std::vector<uint8_t>& values = tables[materialKey(material)];
+    parallelFor(values.size(), threadCount, [&](uint64_t begin, uint64_t end, int t) {
+        resolved[t].clear();
+        for (uint64_t i = begin; i < end; ++i) {
+            if (values[i] != TB_VALUE_DRAW) continue;
+            uint8_t bestLoss = counters.bestLoss[i].load(std::memory_order_relaxed);
+            uint8_t longestWin = counters.longestWin[i].load(std::memory_order_relaxed);
+            if (bestLoss != NONE && bestLoss + 1 == level) {
+                values[i] = uint8_t(level + 1);
+            }
+            else if (bestLoss == NONE && !counters.drawn[i] && counters.remaining[i].load(std::memory_order_relaxed) == 0 &&
+                     (longestWin == NONE ? 0 : longestWin + 1) == level) {
+                // Все ходы ведут в выигрыш соперника (или ходов нет)
+                values[i] = uint8_t(level + 1);
+            }
+            else {
+                continue;
+            }
+            resolved[t].push_back(i);
+        }
+    });
+    int count = 0;
+    for (auto& list : resolved) count += int(list.size());
+    return count;
+}
+
+void Generator::updatePredecessors(const Material& material, const std::vector<std::vector<uint64_t>>& resolved,
+                                   const Material& mirror, Counters& mirrorCounters) {
+    const std::vector<uint8_t>& values = tables[materialKey(material)];
+    const std::vector<uint8_t>& mirrorValues = tables[materialKey(mirror)];
+    parallelFor(resolved.size(), threadCount, [&](uint64_t begin, uint64_t end, int) {
+        for (uint64_t t = begin; t < end; ++t) {
+            for (uint64_t i : resolved[t]) {
+                Position board;
+                tablebasePosition(material, i, board);
+                uint8_t plies = uint8_t(values[i] - 1);
+                bool loss = values[i] & 1;
+                forEachPredecessor(board, [&](const Position& previous) {
+                    Position flipped = flipPosition(previous);
+                    uint64_t index = tablebaseIndex(flipped, mirror);
+                    if (mirrorValues[index] != TB_VALUE_DRAW) return;
+                    if (loss) {
+                        storeMin(mirrorCounters.bestLoss[index], plies);
+                    }
+                    else {
+                        storeMax(mirrorCounters.longestWin[index], plies);
+                        mirrorCounters.remaining[index].fetch_sub(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+        }
+    });
+}
+
+bool Generator::solve(const std::vector<Material>& group) {
+    std::vector<std::unique_ptr<Counters>> counters;
+    for (const Material& material : group) {
+        tables[materialKey(material)].resize(tablebaseSize(material));
+        counters.emplace_back(new Counters(tablebaseSize(material)));
+    }
+    for (size_t g = 0; g < group.size(); ++g) initialize(group[g], *counters[g]);
+
+    // Уровень без новых решений может быть не последним: следующие уровни
+    // могут решиться ходами в уже решенные срезы, а там не больше maxPliesSoFar
+    std::vector<std::vector<std::vector<uint64_t>>> resolved(group.size(), std::vector<std::vector<uint64_t>>(threadCount));
+    int groupMax = 0;
+    for (int level = 0;; ++level) {
+        if (level > TB_MAX_PLIES) return false;
+        int count = 0;
+        for (size_t g = 0; g < group.size(); ++g) count += resolveLevel(group[g], *counters[g], level, resolved[g]);
+        for (size_t g = 0; g < group.size(); ++g) {
+            size_t m = group.size() == 1 ? 0 : 1 - g;
+            updatePredecessors(group[g], resolved[g], group[m], *counters[m]);
+        }
+        if (count) groupMax = level;
+        if (!count && level > maxPliesSoFar) break;
+    }
+    maxPliesSoFar = std::max(maxPliesSoFar, groupMax);
+    return true;
+}
+
+bool writeTable(const std::string& path, const Material& material, const std::vector<uint8_t>& values) {
+    TBHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TB_MAGIC, sizeof(TB_MAGIC));
+    header.version = TB_VERSION;
+    header.material[0] = uint8_t(material.whiteMen);
+    header.material[1] = uint8_t(material.whiteKings);
+    header.material[2] = uint8_t(material.blackMen);
+    header.material[3] = uint8_t(material.blackKings);
+    header.headerSize = sizeof(TBHeader);
+    header.count = values.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size()));
+    return bool(out);
+}
+
+} // namespace
+
+Material materialOf(const Position& board) {
+    Material m;
+    m.whiteMen = popCount(board.white & ~board.kings);
+    m.whiteKings = popCount(board.white & board.kings);
+    m.blackMen = popCount(board.black & ~board.kings);
+    m.blackKings = popCount(board.black & board.kings);
+    return m;
+}
+
+Position flipPosition(const Position& board) {
+    return Position{reverseBits(board.black), reverseBits(board.white), reverseBits(board.kings)};
+}
+
+// Индекс складывается из номеров наборов полей: простых белых среди 28 полей,
+// простых черных среди своих 28 полей (без учета белых, поэтому часть индексов
+// не соответствует позициям), белых дамок среди полей без простых и черных
+// дамок среди оставшихся
+uint64_t tablebaseSize(const Material& m) {
+    int men = m.whiteMen + m.blackMen;
+    return binomial(popCount(WHITE_MEN_SQUARES), m.whiteMen) * binomial(popCount(BLACK_MEN_SQUARES), m.blackMen) *
+           binomial(squareCount - men, m.whiteKings) * binomial(squareCount - men - m.whiteKings, m.blackKings);
+}
+
+uint64_t tablebaseIndex(const Position& board, const Material& m) {
+    Bitboard whiteMen = board.white & ~board.kings;
+    Bitboard blackMen = board.black & ~board.kings;
+    Bitboard whiteKings = board.white & board.kings;
+    Bitboard blackKings = board.black & board.kings;
+    Bitboard kingSquares = ~(whiteMen | blackMen);
+    int men = m.whiteMen + m.blackMen;
+
+    uint64_t index = rankSquares(whiteMen, WHITE_MEN_SQUARES);
+    index = index * binomial(popCount(BLACK_MEN_SQUARES), m.blackMen) + rankSquares(blackMen, BLACK_MEN_SQUARES);
+    index = index * binomial(squareCount - men, m.whiteKings) + rankSquares(whiteKings, kingSquares);
+    index = index * binomial(squareCount - men - m.whiteKings, m.blackKings) + rankSquares(blackKings, kingSquares & ~whiteKings);
+    return index;
+}
+
+bool tablebasePosition(const Material& m, uint64_t index, Position& board) {
+    int men = m.whiteMen + m.blackMen;
+    uint64_t blackKingCount = binomial(squareCount - men - m.whiteKings, m.blackKings);
+    uint64_t whiteKingCount = binomial(squareCount - men, m.whiteKings);
+    uint64_t blackMenCount = binomial(popCount(BLACK_MEN_SQUARES), m.blackMen);
+
+    uint64_t blackKingRank = index % blackKingCount;
+    index /= blackKingCount;
+    uint64_t whiteKingRank = index % whiteKingCount;
+    index /= whiteKingCount;
+    uint64_t blackMenRank = index % blackMenCount;
+    index /= blackMenCount;
+
+    Bitboard whiteMen = unrankSquares(index, m.whiteMen, WHITE_MEN_SQUARES);
+    Bitboard blackMen = unrankSquares(blackMenRank, m.blackMen, BLACK_MEN_SQUARES);
+    if (whiteMen & blackMen) return false;
+    Bitboard kingSquares = ~(whiteMen | blackMen);
+    Bitboard whiteKings = unrankSquares(whiteKingRank, m.whiteKings, kingSquares);
+    Bitboard blackKings = unrankSquares(blackKingRank, m.blackKings, kingSquares & ~whiteKings);
+
+    board.white = whiteMen | whiteKings;
+    board.black = blackMen | blackKings;
+    board.kings = whiteKings | blackKings;
+    return true;
+}
+
+std::string tablebaseFileName(const Material& m) {
+    return "w" + std::to_string(m.whiteMen) + "k" + std::to_string(m.whiteKings) + "-b" +
+           std::to_string(m.blackMen) + "k" + std::to_string(m.blackKings) + ".tb";
+}
+
+bool generateTablebases(const std::string& directory, int pieces, int threads,
+                        const std::function<void(const std::string&, uint64_t)>& progress) {
+    pieces = std::min(std::max(pieces, 1), TB_MAX_PIECES);
+    Generator generator(threads);
+    std::vector<Material> materials = listMaterials(pieces);
+    std::vector<bool> done(materials.size(), false);
+    for (size_t i = 0; i < materials.size(); ++i) {
+        if (done[i]) continue;
+        // Тихие ходы ведут из среза в зеркальный, поэтому их решают вместе
+        std::vector<Material> group{materials[i]};
+        Material mirror = mirrorMaterial(materials[i]);
+        for (size_t j = i + 1; j < materials.size(); ++j) {
+            if (materialKey(materials[j]) == materialKey(mirror)) {
+                group.push_back(mirror);
+                done[j] = true;
+            }
+        }
+        if (!generator.solve(group)) return false;
+        for (const Material& material : group) {
+            std::string name = tablebaseFileName(material);
+            if (!writeTable(directory + "/" + name, material, generator.table(material))) return false;
+            if (progress) progress(name, generator.table(material).size());
+        }
+    }
+    return true;
+}
+
+Tablebase::Tablebase() : tables(size_t(MATERIAL_DIM) * MATERIAL_DIM * MATERIAL_DIM * MATERIAL_DIM, nullptr), maxPieces(0), completePieces(0) {}
+
+Tablebase::~Tablebase() = default;
+
+int Tablebase::load(const std::string& directory, int pieces) {
+    pieces = std::min(std::max(pieces, 1), TB_MAX_PIECES);
+    int loaded = 0;
+    completePieces = pieces;
+    for (const Material& material : listMaterials(pieces)) {
+        std::unique_ptr<MappedFile> file(new MappedFile);
+        bool valid = file->open(directory + "/" + tablebaseFileName(material)) && file->size() >= sizeof(TBHeader);
+        if (valid) {
+            TBHeader header;
+            std::memcpy(&header, file->data(), sizeof(header));
+            valid = std::memcmp(header.magic, TB_MAGIC, sizeof(TB_MAGIC)) == 0 && header.version == TB_VERSION &&
+                    header.material[0] == material.whiteMen && header.material[1] == material.whiteKings &&
+                    header.material[2] == material.blackMen && header.material[3] == material.blackKings &&
+                    header.count == tablebaseSize(material) && file->size() == header.headerSize + header.count;
+        }
+        if (!valid) {
+            completePieces = std::min(completePieces, material.pieces() - 1);
+            continue;
+        }
+        tables[materialKey(material)] = file->data() + sizeof(TBHeader);
+        files.push_back(std::move(file));
+        maxPieces = std::max(maxPieces, material.pieces());
+        ++loaded;
+    }
+    if (!loaded) completePieces = 0;
+    return loaded;
+}
+
+const uint8_t* Tablebase::tableFor(const Material& material) const {
+    return material.pieces() <= maxPieces ? tables[materialKey(material)] : nullptr;
+}
+
+TBProbe Tablebase::probe(const GameState& state) const {
+    TBProbe result;
+    Position board = state.currentTurn == WHITE_TURN ? state.board : flipPosition(state.board);
+    if (!board.white || !board.black) return result;
+    Material material = materialOf(board);
+    const uint8_t* table = tableFor(material);
+    if (!table) return result;
+    return decodeTBValue(table[tablebaseIndex(board, material)]);
+}
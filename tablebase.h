@@ -0,0 +1,170 @@
+/**
+ * \file tablebase.h
+ * \brief Эндшпильные базы: точный результат и число полуходов до него.
+ *
+ * База делится на срезы по материалу: числу простых шашек и дамок каждого
+ * цвета (типы фигур из Piece). В срезе хранятся только позиции с ходом
+ * белых; позиция с ходом черных поворачивается на 180 градусов с заменой
+ * цветов. Каждый срез — отдельный файл: заголовок и по байту на позицию.
+ *
+ * Файлы строит tbgen обратным анализом, а Tablebase отображает их в память:
+ * загрузка почти мгновенна, а страницы файлов делят все процессы,
+ * открывшие одну базу.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "rules.h"
+
+const int TB_MAX_PIECES = 8; ///< Наибольшее число фигур в базе
+
+/**
+ * \brief Материал среза: число фигур каждого типа, ход белых.
+ */
+struct Material {
+    int whiteMen; ///< Простые белые
+    int whiteKings; ///< Белые дамки
+    int blackMen; ///< Простые черные
+    int blackKings; ///< Черные дамки
+
+    int pieces() const { return whiteMen + whiteKings + blackMen + blackKings; }
+};
+
+/// Результат позиции из базы.
+enum TBOutcome {
+    TB_UNKNOWN, ///< Позиции нет в загруженных базах
+    TB_DRAW, ///< Ничья
+    TB_WIN, ///< Выигрыш ходящей стороны
+    TB_LOSS ///< Проигрыш ходящей стороны
+};
+
+/**
+ * \brief Результат поиска в базе.
+ */
+struct TBProbe {
+    TBOutcome outcome = TB_UNKNOWN; ///< Результат
+    int plies = 0; ///< Полуходов до конца партии при лучшей игре (для выигрыша и проигрыша)
+};
+
+/**
+ * \brief Байт значения в срезе: 0 — ничья, иначе число полуходов плюс один.
+ *
+ * Выигрыш всегда достигается за нечетное число полуходов, проигрыш — за
+ * четное, поэтому четные байты означают выигрыш, нечетные — проигрыш.
+ */
+const uint8_t TB_VALUE_DRAW = 0;
+const uint8_t TB_VALUE_INVALID = 255; ///< Индекс не соответствует позиции
+const int TB_MAX_PLIES = 253; ///< Наибольшее хранимое число полуходов
+
+/**
+ * \brief Перевести байт значения в результат.
+ */
+inline TBProbe decodeTBValue(uint8_t value) {
+    TBProbe result;
+    if (value == TB_VALUE_INVALID) return result;
+    if (value == TB_VALUE_DRAW) {
+        result.outcome = TB_DRAW;
+        return result;
+    }
+    result.plies = value - 1;
+    result.outcome = (value & 1) ? TB_LOSS : TB_WIN;
+    return result;
+}
+
+/**
+ * \brief Материал позиции с ходом белых.
+ */
+Material materialOf(const Position& board);
+
+/**
+ * \brief Повернуть доску на 180 градусов и поменять цвета фигур.
+ */
+Position flipPosition(const Position& board);
+
+/**
+ * \brief Число индексов в срезе (включая индексы, не соответствующие позициям).
+ */
+uint64_t tablebaseSize(const Material& material);
+
+/**
+ * \brief Индекс позиции с ходом белых в ее срезе.
+ */
+uint64_t tablebaseIndex(const Position& board, const Material& material);
+
+/**
+ * \brief Позиция по индексу в срезе.
+ * \return false, если индексу не соответствует допустимая позиция.
+ */
+bool tablebasePosition(const Material& material, uint64_t index, Position& board);
+
+/**
+ * \brief Имя файла среза, например "w1k2-b0k1.tb".
+ */
+std::string tablebaseFileName(const Material& material);
+
+/**
+ * \brief Построить базы для всех позиций из не более чем pieces фигур.
+ *
+ * Срезы строятся по возрастанию числа фигур и простых шашек, так что
+ * позиции после взятия и превращения уже решены. Срез и зеркальный ему
+ * (с заменой цветов) решаются вместе обратным анализом по числу полуходов
+ * до конца партии; работа каждого уровня делится между потоками.
+ * \param directory Каталог для файлов (должен существовать)
+ * \param pieces Наибольшее число фигур (1..TB_MAX_PIECES)
+ * \param threads Число потоков
+ * \param progress Вызывается после записи каждого среза с именем файла
+ * \return false, если файл не удалось записать.
+ */
+bool generateTablebases(const std::string& directory, int pieces, int threads,
+                        const std::function<void(const std::string&, uint64_t)>& progress = nullptr);
+
+/**
+ * \brief Набор эндшпильных баз, отображенных в память.
+ *
+ * После load() объект только читается, поэтому probe() можно вызывать
+ * из любого числа потоков.
+ */
+class Tablebase {
+public:
+    Tablebase();
+    ~Tablebase();
+
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    /**
+     * \brief Отобразить в память все срезы из каталога.
+     * \param directory Каталог с файлами срезов
+     * \param pieces Наибольшее число фигур, для которого искать файлы
+     * \return Число загруженных срезов.
+     */
+    int load(const std::string& directory, int pieces = TB_MAX_PIECES);
+
+    /**
+     * \brief Найти позицию в базе.
+     * \param state Состояние партии
+     * \return Результат с точки зрения ходящей стороны или TB_UNKNOWN.
+     */
+    TBProbe probe(const GameState& state) const;
+
+    /**
+     * \brief Наибольшее число фигур, для которого загружены все срезы.
+     */
+    int pieces() const { return completePieces; }
+
+private:
+    const uint8_t* tableFor(const Material& material) const;
+
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<const uint8_t*> tables; ///< Данные срезов по материалу или nullptr
+    int maxPieces;
+    int completePieces;
+};
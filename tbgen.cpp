@@ -0,0 +1,56 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "tablebase.h"
+
+/**
+ * \brief Построение эндшпильных баз для всех позиций из не более чем N фигур.
+ *
+ * Использование: tbgen [-n фигур] [-t потоков] [-o каталог]
+ * (по умолчанию 4 фигуры, все ядра, текущий каталог)
+ */
+int main(int argc, char* argv[]) {
+    int pieces = 4;
+    int threads = int(std::thread::hardware_concurrency());
+    std::string directory = ".";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            pieces = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: tbgen [-n pieces] [-t threads] [-o directory]" << std::endl;
+            return 1;
+        }
+    }
+    if (pieces < 1 || pieces > TB_MAX_PIECES) {
+        std::cerr << "Pieces must be between 1 and " << TB_MAX_PIECES << std::endl;
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    std::cout << "Generating " << pieces << "-piece tablebases with " << threads << " threads into " << directory << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t total = 0;
+    bool ok = generateTablebases(directory, pieces, threads, [&](const std::string& name, uint64_t size) {
+        total += size;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << size << " positions, " << seconds << " s" << std::endl;
+    });
+    if (!ok) {
+        std::cerr << "Generation failed" << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Total: " << total << " positions, " << seconds << " s" << std::endl;
+    return 0;
+}
@@ -1,85 +1,1195 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
-#include "gg.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "rules.h"
+#include "movegen.h"
+#include "notation.h"
+#include "eval.h"
+#include "search.h"
+#include "tablebase.h"
+#include "gamerecord.h"
+#include "engine.h"
+#include "protocol.h"
+#include "gameserver.h"
+#include "variant.h"
+#include "book.h"
+#include "profile.h"
+#include "mcts.h"
 
 TEST_CASE("initBoard") {
-    initBoard();
-    CHECK(board[0][0] == EMPTY);
-    CHECK(board[0][1] == BLACK);
-    CHECK(board[7][0] == WHITE);
-    CHECK(board[3][4] == EMPTY);
+    GameState game;
+    initBoard(game);
+    CHECK(pieceAt(game.board, 0, 0) == EMPTY);
+    CHECK(pieceAt(game.board, 1, 0) == BLACK);
+    CHECK(pieceAt(game.board, 0, 7) == WHITE);
+    CHECK(pieceAt(game.board, 4, 3) == EMPTY);
 }
 
 TEST_CASE("isValidMove") {
-    initBoard();
+    GameState game;
+    initBoard(game);
     bool isCapture;
 
     // Valid move for BLACK
-    CHECK(isValidMove(1, 2, 2, 3, isCapture) == true);
+    CHECK(isValidMove(game, 1, 2, 2, 3, isCapture) == true);
     CHECK(isCapture == false);
 
     // Invalid move for BLACK (out of bounds)
-    CHECK(isValidMove(1, 2, 2, 8, isCapture) == false);
+    CHECK(isValidMove(game, 1, 2, 2, 8, isCapture) == false);
 
     // Valid capture move for BLACK
-    board[3][4] = WHITE;
-    CHECK(isValidMove(1, 2, 3, 4, isCapture) == false);
-    CHECK(isCapture == false);
+    setPiece(game.board, 2, 3, WHITE);
+    CHECK(isValidMove(game, 1, 2, 3, 4, isCapture) == true);
+    CHECK(isCapture == true);
 
     // Invalid move for WHITE (wrong direction)
-    CHECK(isValidMove(2, 5, 3, 4, isCapture) == true);
+    CHECK(isValidMove(game, 2, 3, 3, 4, isCapture) == false);
 
     // Valid move for WHITE
-    CHECK(isValidMove(2, 5, 1, 4, isCapture) == true);
+    CHECK(isValidMove(game, 2, 5, 3, 4, isCapture) == true);
+    CHECK(isValidMove(game, 2, 5, 1, 4, isCapture) == true);
     CHECK(isCapture == false);
 }
 
 TEST_CASE("makeMove") {
-    initBoard();
+    GameState game;
+    initBoard(game);
     bool isCapture;
 
     // Move a BLACK piece
-    CHECK(isValidMove(1, 2, 2, 3, isCapture) == true);
-    makeMove(1, 2, 2, 3, isCapture);
-    CHECK(board[1][2] == 1);
-    CHECK(board[2][3] == BLACK);
+    CHECK(isValidMove(game, 1, 2, 2, 3, isCapture) == true);
+    makeMove(game, 1, 2, 2, 3, isCapture);
+    CHECK(pieceAt(game.board, 2, 1) == 1);
+    CHECK(pieceAt(game.board, 3, 2) == BLACK);
 
     // Capture a WHITE piece
-    board[3][4] = WHITE;
-    CHECK(isValidMove(2, 3, 4, 5, isCapture) == false);
-    makeMove(2, 3, 4, 5, isCapture);
-    CHECK(board[3][4] == 2);
-    CHECK(board[2][3] == 1);
-    CHECK(board[4][5] == 0);
+    setPiece(game.board, 3, 4, WHITE);
+    setPiece(game.board, 4, 5, EMPTY);
+    CHECK(isValidMove(game, 2, 3, 4, 5, isCapture) == true);
+    CHECK(isCapture == true);
+    makeMove(game, 2, 3, 4, 5, isCapture);
+    CHECK(pieceAt(game.board, 3, 4) == EMPTY);
+    CHECK(pieceAt(game.board, 2, 3) == EMPTY);
+    CHECK(pieceAt(game.board, 4, 5) == BLACK);
 }
 
 TEST_CASE("canCapture") {
-    initBoard();
-    board[2][3] = EMPTY; // Make sure there's no piece blocking
+    GameState game;
+    initBoard(game);
+    setPiece(game.board, 3, 2, EMPTY); // Make sure there's no piece blocking
 
     // BLACK can capture WHITE
-    board[3][4] = WHITE;
-    CHECK(canCapture(1, 2) == false);
+    setPiece(game.board, 2, 3, WHITE);
+    updateCaptureMaps(game);
+    CHECK(canCapture(game, 1, 2) == true);
 
     // WHITE can capture BLACK
-    board[4][5] = BLACK;
-    CHECK(canCapture(6, 5) == false);
+    setPiece(game.board, 5, 4, BLACK);
+    updateCaptureMaps(game);
+    CHECK(canCapture(game, 6, 5) == true);
+
+    // Nothing to capture
+    CHECK(canCapture(game, 0, 5) == false);
 }
 
 TEST_CASE("mustCapture") {
-    initBoard();
-    board[2][3] = EMPTY; // Make sure there's no piece blocking
+    GameState game;
+    initBoard(game);
+    setPiece(game.board, 3, 2, EMPTY); // Make sure there's no piece blocking
 
     // Check no captures initially
-    CHECK(mustCapture() == false);
+    CHECK(mustCapture(game) == false);
 
     // BLACK must capture WHITE
-    board[3][4] = WHITE;
-    currentTurn = BLACK_TURN;
-    CHECK(mustCapture() == true);
+    setPiece(game.board, 4, 3, WHITE);
+    game.currentTurn = BLACK_TURN;
+    updateCaptureMaps(game);
+    CHECK(mustCapture(game) == true);
 
     // WHITE must capture BLACK
-    board[4][5] = BLACK;
-    currentTurn = WHITE_TURN;
-    CHECK(mustCapture() == true);
+    setPiece(game.board, 5, 4, BLACK);
+    game.currentTurn = WHITE_TURN;
+    updateCaptureMaps(game);
+    CHECK(mustCapture(game) == true);
+}
+
+TEST_CASE("king captures at distance") {
+    GameState game;
+    game.board = Position{0, 0, 0};
+    setPiece(game.board, 0, 7, WHITE_KING);
+    setPiece(game.board, 4, 3, BLACK);
+    game.currentTurn = WHITE_TURN;
+    updateCaptureMaps(game);
+    CHECK(canCapture(game, 0, 7) == true);
+    CHECK(mustCapture(game) == true);
+
+    bool isCapture;
+    CHECK(isValidMove(game, 0, 7, 6, 1, isCapture) == true);
+    CHECK(isCapture == true);
+    makeMove(game, 0, 7, 6, 1, isCapture);
+    CHECK(pieceAt(game.board, 4, 3) == EMPTY);
+    CHECK(pieceAt(game.board, 6, 1) == WHITE_KING);
+
+    // Two pieces in a row cannot be jumped
+    setPiece(game.board, 4, 3, BLACK);
+    setPiece(game.board, 3, 4, BLACK);
+    updateCaptureMaps(game);
+    CHECK(canCapture(game, 6, 1) == false);
+}
+
+TEST_CASE("ray tables") {
+    // The compile-time rays agree with stepping square by square
+    static_assert(RAYS.ray[DOWN_RIGHT][0] == ((1u << 5) | (1u << 9) | (1u << 14) | (1u << 18) | (1u << 23) | (1u << 27)),
+                  "rays are built at compile time");
+    for (int s = 0; s < squareCount; ++s) {
+        for (int d = 0; d < 4; ++d) {
+            Bitboard expected = 0;
+            for (Bitboard b = shift(Bitboard(1) << s, Direction(d)); b; b = shift(b, Direction(d))) expected |= b;
+            CHECK(RAYS.ray[d][s] == expected);
+        }
+    }
+
+    // A king slides up to the first piece and captures past it at any distance
+    Position board{0, 0, 0};
+    setPiece(board, 0, 7, WHITE_KING);
+    setPiece(board, 5, 2, BLACK);
+    Bitboard empty = emptySquares(board);
+    CHECK(firstBlocker(squareIndex(0, 7), UP_RIGHT, empty) == squareIndex(5, 2));
+    CHECK(firstBlocker(squareIndex(0, 7), DOWN_RIGHT, empty) == -1);
+    CHECK(popCount(slide(squareIndex(0, 7), UP_RIGHT, empty)) == 4);
+    CHECK(jumpers(board, WHITE_TURN) == squareMask(0, 7));
+    setPiece(board, 6, 1, BLACK);
+    CHECK(jumpers(board, WHITE_TURN) == 0);
+
+    GameState game;
+    game.board = board;
+    game.currentTurn = WHITE_TURN;
+    bool isCapture;
+    CHECK(isValidMove(game, 0, 7, 4, 3, isCapture) == true);
+    CHECK(isCapture == false);
+    CHECK(isValidMove(game, 0, 7, 6, 1, isCapture) == false);
+}
+
+TEST_CASE("generateMoves initial position") {
+    GameState game;
+    initBoard(game);
+    MoveList list;
+    generateMoves(game, list);
+    CHECK(list.size() == 7);
+    for (const Move& move : list) {
+        CHECK(isCapture(move) == false);
+    }
+}
+
+TEST_CASE("generateMoves capture chains") {
+    GameState game;
+    game.board = Position{0, 0, 0};
+    game.currentTurn = WHITE_TURN;
+    MoveList list;
+
+    // Man jumps twice and captures are mandatory
+    setPiece(game.board, 1, 6, WHITE);
+    setPiece(game.board, 7, 6, WHITE);
+    setPiece(game.board, 2, 5, BLACK);
+    setPiece(game.board, 2, 3, BLACK);
+    updateCaptureMaps(game);
+    generateMoves(game, list);
+    REQUIRE(list.size() == 1);
+    CHECK(list[0].from == squareIndex(1, 6));
+    CHECK(list[0].to == squareIndex(1, 2));
+    CHECK(list[0].pathLength == 2);
+    CHECK(popCount(list[0].captured) == 2);
+
+    // Man reaching the last row continues the capture as a king
+    game.board = Position{0, 0, 0};
+    setPiece(game.board, 5, 2, WHITE);
+    setPiece(game.board, 4, 1, BLACK);
+    setPiece(game.board, 1, 2, BLACK);
+    updateCaptureMaps(game);
+    generateMoves(game, list);
+    REQUIRE(list.size() == 1);
+    CHECK(list[0].to == squareIndex(0, 3));
+    CHECK(list[0].promotes == 1);
+    makeMove(game, list[0]);
+    CHECK(pieceAt(game.board, 0, 3) == WHITE_KING);
+    CHECK(game.board.black == 0);
+    CHECK(game.currentTurn == BLACK_TURN);
+
+    // King must land where the capture can continue
+    game.board = Position{0, 0, 0};
+    game.currentTurn = WHITE_TURN;
+    setPiece(game.board, 0, 7, WHITE_KING);
+    setPiece(game.board, 2, 5, BLACK);
+    setPiece(game.board, 5, 4, BLACK);
+    updateCaptureMaps(game);
+    generateMoves(game, list);
+    CHECK(list.size() == 2);
+    for (const Move& move : list) {
+        CHECK(move.path[0] == squareIndex(4, 3));
+        CHECK(popCount(move.captured) == 2);
+    }
+}
+
+TEST_CASE("FEN") {
+    GameState game;
+    REQUIRE(parseFen(START_FEN, game));
+    GameState start;
+    initBoard(start);
+    CHECK(game.board == start.board);
+    CHECK(game.currentTurn == WHITE_TURN);
+
+    REQUIRE(parseFen("B:WK1,19:B5,K31", game));
+    CHECK(game.currentTurn == BLACK_TURN);
+    CHECK(toFen(game) == "B:WK1,19:B5,K31");
+    CHECK(parseFen("W:W21,X:B1", game) == false);
+    CHECK(parseFen("W:W33:B1", game) == false);
+}
+
+TEST_CASE("perft") {
+    GameState game;
+    initBoard(game);
+    const uint64_t expected[] = {1, 7, 49, 302, 1469, 7482, 37986, 190146, 929899};
+    for (int depth = 1; depth <= 8; ++depth) {
+        CHECK(perft(game, depth) == expected[depth]);
+    }
+
+    // King-heavy positions with long capture chains
+    REQUIRE(parseFen("B:WK1,19,22,23,27:B5,6,K14,16,K31", game));
+    CHECK(perft(game, 5) == 2828);
+    REQUIRE(parseFen("W:W9,10,11,18,25,26:B2,3,K20,K24,13,14,22", game));
+    CHECK(perft(game, 5) == 1521);
+}
+
+TEST_CASE("rule variants") {
+    // The Russian policy reproduces the core generator
+    VariantState<RussianRules> russian;
+    initVariant(russian);
+    CHECK(toFen(russian) == toFen([] {
+        GameState game;
+        initBoard(game);
+        return game;
+    }()));
+    const uint64_t russianCounts[] = {1, 7, 49, 302, 1469, 7482, 37986, 190146};
+    for (int depth = 1; depth <= 7; ++depth) CHECK(perft(russian, depth) == russianCounts[depth]);
+    const char* positions[] = {"B:WK1,19,22,23,27:B5,6,K14,16,K31", "W:W9,10,11,18,25,26:B2,3,K20,K24,13,14,22"};
+    for (const char* fen : positions) {
+        GameState game;
+        REQUIRE(parseFen(fen, game));
+        REQUIRE(parseFen(fen, russian));
+        CHECK(perft(russian, 5) == perft(game, 5));
+    }
+
+    VariantState<EnglishRules> english;
+    initVariant(english);
+    CHECK(english.currentTurn == BLACK_TURN);
+    const uint64_t englishCounts[] = {1, 7, 49, 302, 1469, 7361, 36768, 179740, 845931};
+    for (int depth = 1; depth <= 8; ++depth) CHECK(perft(english, depth) == englishCounts[depth]);
+
+    VariantState<InternationalRules> international;
+    initVariant(international);
+    CHECK(toFen(international) == "W:W31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50:"
+                                  "B1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20");
+    const uint64_t internationalCounts[] = {1, 9, 81, 658, 4265, 27117, 167140};
+    for (int depth = 1; depth <= 6; ++depth) CHECK(perft(international, depth) == internationalCounts[depth]);
+
+    VariantMoveList list;
+
+    // English kings move one square, men capture forward only and stop on promotion
+    REQUIRE(parseFen("W:WK18:B", english));
+    generateMoves(english, list);
+    CHECK(list.size() == 4);
+    REQUIRE(parseFen("B:W6:B9", english));
+    generateMoves(english, list);
+    CHECK(list.size() == 2);
+    CHECK(list[0].captured == 0);
+    REQUIRE(parseFen("W:W11:B6,7", english));
+    generateMoves(english, list);
+    REQUIRE(list.size() == 1);
+    CHECK(moveToString(list[0]) == "11x2");
+    CHECK(list[0].promotes);
+    REQUIRE(parseFen("W:W11:B6,7", russian));
+    VariantGenerator<RussianRules>::moves(russian, list);
+    CHECK(list.size() == 2);
+    CHECK(moveToString(list[0]) == "11x2x9");
+
+    // International: the majority rule, and a man passing the last row stays a man
+    REQUIRE(parseFen("W:W28,33:B12,22,23", international));
+    generateMoves(international, list);
+    REQUIRE(list.size() == 1);
+    CHECK(moveToString(list[0]) == "28x17x8");
+    REQUIRE(parseFen("W:W12:B8,9", international));
+    generateMoves(international, list);
+    REQUIRE(list.size() == 1);
+    CHECK(moveToString(list[0]) == "12x3x14");
+    CHECK(!list[0].promotes);
+    REQUIRE(parseFen("W:WK46:B23,41", international));
+    generateMoves(international, list);
+    CHECK(list.size() == 4);
+    for (const VariantMove& move : list) CHECK(popCount64(move.captured) == 2);
+}
+
+TEST_CASE("move notation") {
+    GameState game;
+    REQUIRE(parseFen("W:W22:B18,11", game));
+    MoveList list;
+    generateMoves(game, list);
+    REQUIRE(list.size() == 1);
+    CHECK(moveToString(list[0]) == "22x15x8");
+    CHECK(findMove("22x8", list) == 0);
+    CHECK(findMove("22x15x8", list) == 0);
+    CHECK(findMove("22-18", list) == -1);
+
+    // A full path wins over a chain that has the same ends
+    REQUIRE(parseFen("B:W11,18,19,21,23,25,26,27,29,30:B4,9,12,15", game));
+    generateMoves(game, list);
+    int jump = findMove("15x8", list);
+    int chain = findMove("15x22x31x24x15x8", list);
+    REQUIRE(jump >= 0);
+    REQUIRE(chain >= 0);
+    CHECK(list[jump].pathLength == 1);
+    CHECK(list[chain].pathLength == 5);
+}
+
+TEST_CASE("evaluation") {
+    GameState game;
+    initBoard(game);
+    EvalWeights weights;
+    // Symmetric start: only the tempo bonus remains
+    CHECK(evaluate(game) == weights.tempo);
+
+    REQUIRE(parseFen("W:WK29,22:B5", game));
+    // White: a king with one move and a man two rows up with two moves; black: a man one row down with one move
+    int white = weights.king + weights.man + weights.advance * 2 + weights.mobility * 3;
+    int black = weights.man + weights.advance * 1 + weights.mobility * 1;
+    int expected = white - black + weights.tempo;
+    CHECK(evaluate(game) == expected);
+    game.currentTurn = BLACK_TURN;
+    CHECK(evaluate(game) == -(expected - weights.tempo) + weights.tempo);
+
+    // Every kernel gives exactly the scalar scores, including the tail of a batch
+    std::vector<GameState> states;
+    MoveList list;
+    for (int start = 0; states.size() < 1003; ++start) {
+        initBoard(game);
+        for (int ply = 0; ply < 100; ++ply) {
+            generateMoves(game, list);
+            if (list.empty()) break;
+            makeMove(game, list[(ply * 7 + start) % list.size()]);
+            states.push_back(game);
+        }
+    }
+    weights.mobility = 3;
+    weights.tempo = -7;
+    std::vector<int> expectedScores(states.size());
+    for (size_t i = 0; i < states.size(); ++i) expectedScores[i] = evaluate(states[i], weights);
+    for (EvalKernel kernel : {EVAL_SCALAR, EVAL_SSE, EVAL_AVX2, EVAL_BEST}) {
+        std::vector<int> scores(states.size());
+        evaluateBatch(states.data(), states.size(), scores.data(), weights, kernel);
+        CHECK(scores == expectedScores);
+    }
+    CHECK(evalKernelSupported(EVAL_SCALAR));
+    CHECK(evalKernelSupported(bestEvalKernel()));
+
+    // The features weighted and signed by the side to move give the same score
+    for (size_t i = 0; i < states.size(); ++i) {
+        EvalFeatures features = evalFeatures(states[i]);
+        int score = 0;
+        for (int t = 0; t < EVAL_TERM_COUNT; ++t) score += features.value[t] * (weights.*EVAL_TERMS[t].weight);
+        if (states[i].currentTurn == BLACK_TURN) score = -score;
+        if (score != expectedScores[i]) {
+            CHECK(score == expectedScores[i]);
+            break;
+        }
+    }
+
+    // Weights file: written and read back, comments and partial files
+    std::stringstream file;
+    writeEvalWeights(file, weights);
+    EvalWeights loaded;
+    REQUIRE(readEvalWeights(file, loaded));
+    for (const EvalTerm& term : EVAL_TERMS) CHECK(loaded.*term.weight == weights.*term.weight);
+    std::istringstream partial("# tuned\n\nking 250\n  advance -3 \r\n");
+    REQUIRE(readEvalWeights(partial, loaded));
+    CHECK(loaded.king == 250);
+    CHECK(loaded.advance == -3);
+    CHECK(loaded.man == weights.man);
+    std::istringstream unknown("king 250\nqueen 900\n");
+    CHECK_FALSE(readEvalWeights(unknown, loaded));
+    std::istringstream garbage("king lots\n");
+    CHECK_FALSE(readEvalWeights(garbage, loaded));
+    CHECK(loaded.king == 250);
+}
+
+TEST_CASE("profile counters") {
+    GameState game;
+    initBoard(game);
+    MoveList list;
+    profileReset();
+    for (int i = 0; i < 10; ++i) generateMoves(game, list);
+    mustCapture(game);
+    evaluate(game);
+    ProfileTotals totals = profileTotals();
+    // Counted only in a CHECKERS_PROFILE build; other threads may add more
+    uint64_t expected = profileEnabled() ? 10 : 0;
+    CHECK(totals.calls[PROFILE_GENERATE_MOVES] >= expected);
+    CHECK(totals.calls[PROFILE_MUST_CAPTURE] >= expected / 10);
+    CHECK(totals.calls[PROFILE_EVALUATE] >= expected / 10);
+    if (!profileEnabled()) CHECK(totals.calls[PROFILE_GENERATE_MOVES] == 0);
+
+    std::ostringstream json;
+    writeProfileJson(json, totals);
+    CHECK(json.str().find("\"generateMoves\": {\"calls\": ") != std::string::npos);
+    CHECK(json.str().find("\"nsPerCall\"") != std::string::npos);
+    CHECK(std::string(profileCounterName(PROFILE_QUIESCENCE_NODE)) == "quiescenceNodes");
+}
+
+TEST_CASE("search") {
+    GameState game;
+    Searcher searcher;
+    SearchLimits limits;
+    limits.depth = 6;
+
+    // The only capture wins the game at once
+    REQUIRE(parseFen("W:W22:B18", game));
+    SearchResult result = searcher.search(game, limits);
+    REQUIRE(result.hasMove);
+    CHECK(moveToString(result.bestMove) == "22x15");
+    CHECK(result.score == SCORE_WIN - 1);
+
+    // A double capture that crowns the man wins the game
+    REQUIRE(parseFen("W:W17,21,27:B6,8,14", game));
+    result = searcher.search(game, limits);
+    CHECK(result.score > 0);
+    CHECK(result.pv.length > 0);
+    CHECK(sameMove(result.pv.moves[0], result.bestMove));
+
+    // No legal moves: the side to move has lost
+    REQUIRE(parseFen("B:W22:B", game));
+    result = searcher.search(game, limits);
+    CHECK(result.hasMove == false);
+    CHECK(result.score == -SCORE_WIN);
+
+    initBoard(game);
+    limits.depth = 5;
+    result = searcher.search(game, limits);
+    CHECK(result.depth == 5);
+    CHECK(result.nodes > 0);
+}
+
+TEST_CASE("parallel search") {
+    GameState game;
+    Searcher searcher;
+    searcher.setThreads(4);
+    CHECK(searcher.threads() == 4);
+    SearchLimits limits;
+    limits.depth = 6;
+
+    REQUIRE(parseFen("W:W22:B18", game));
+    SearchResult result = searcher.search(game, limits);
+    CHECK(moveToString(result.bestMove) == "22x15");
+    CHECK(result.score == SCORE_WIN - 1);
+    CHECK(result.threads == 4);
+
+    initBoard(game);
+    limits.depth = 8;
+    result = searcher.search(game, limits);
+    CHECK(result.depth == 8);
+    CHECK(result.pv.length > 0);
+    CHECK(sameMove(result.pv.moves[0], result.bestMove));
+
+    // The node limit counts the nodes of all threads
+    limits.depth = MAX_PLY - 1;
+    limits.nodes = 20000;
+    result = searcher.search(game, limits);
+    CHECK(result.hasMove);
+    CHECK(result.nodes < 2 * limits.nodes);
+
+    searcher.setThreads(1);
+    limits.nodes = 0;
+    limits.depth = 5;
+    result = searcher.search(game, limits);
+    CHECK(result.depth == 5);
+    CHECK(result.threads == 1);
+}
+
+TEST_CASE("mcts") {
+    GameState game;
+    MctsSearcher searcher;
+    searcher.setMemory(1);
+    MctsLimits limits;
+    limits.playouts = 4000;
+
+    for (MctsPolicy policy : {MCTS_UCT, MCTS_PUCT}) {
+        searcher.setPolicy(policy);
+        searcher.setThreads(1);
+
+        // The only capture wins the game at once
+        REQUIRE(parseFen("W:W22:B18", game));
+        MctsResult result = searcher.search(game, limits);
+        REQUIRE(result.hasMove);
+        CHECK(moveToString(result.bestMove) == "22x15");
+        CHECK(result.value > 0.99);
+
+        // Three moves, and alpha-beta proves that only one of them wins
+        REQUIRE(parseFen("W:W16,22:B12", game));
+        Searcher alphaBeta;
+        SearchLimits searchLimits;
+        searchLimits.depth = 12;
+        SearchResult expected = alphaBeta.search(game, searchLimits);
+        REQUIRE(expected.score > SCORE_WIN - MAX_PLY);
+        searcher.setThreads(4);
+        result = searcher.search(game, limits);
+        CHECK(result.threads == 4);
+        CHECK(result.playouts >= limits.playouts);
+        CHECK(result.playouts < limits.playouts + 4 * 64);
+        CHECK(sameMove(result.bestMove, expected.bestMove));
+        REQUIRE(result.pvLength > 0);
+        CHECK(sameMove(result.pv[0], result.bestMove));
+
+        // No legal moves
+        REQUIRE(parseFen("B:W22:B", game));
+        result = searcher.search(game, limits);
+        CHECK(result.hasMove == false);
+    }
+
+    // Without limits the search stops when the arena is full and never overruns it
+    initBoard(game);
+    searcher.setThreads(4);
+    MctsResult result = searcher.search(game, MctsLimits());
+    CHECK(result.hasMove);
+    CHECK(result.nodes <= searcher.capacity());
+    CHECK(result.nodes > searcher.capacity() / 2);
+    CHECK(searcher.capacity() == (size_t(1) << 20) / MctsSearcher::bytesPerNode());
+}
+
+TEST_CASE("incremental hash") {
+    GameState game;
+    REQUIRE(parseFen("W:W9,10,11,18,25,26,K30:B2,3,K20,K24,13,14,22", game));
+    MoveList list;
+    for (int ply = 0; ply < 40; ++ply) {
+        generateMoves(game, list);
+        if (list.empty()) break;
+        makeMove(game, list[(ply * 7) % list.size()]);
+        CHECK(game.hash == computeHash(game));
+    }
+}
+
+TEST_CASE("capture maps") {
+    // The incrementally updated maps always equal a full recomputation
+    const char* fens[] = {START_FEN, "W:WK1,K6,K18,K30:BK3,K20,K25,K32", "B:WK1,19,22,23,27:B5,6,K14,16,K31",
+                          "W:W9,10,11,18,25,26,K30:B2,3,K20,K24,13,14,22"};
+    for (const char* fen : fens) {
+        GameState game;
+        REQUIRE(parseFen(fen, game));
+        UndoStack history;
+        MoveList list;
+        for (int ply = 0; ply < 80; ++ply) {
+            generateMoves(game, list);
+            if (list.empty()) break;
+            for (const Move& move : list) {
+                GameState next = game;
+                makeMove(next, move);
+                CHECK(next.capturers[WHITE_TURN] == jumpers(next.board, WHITE_TURN));
+                CHECK(next.capturers[BLACK_TURN] == jumpers(next.board, BLACK_TURN));
+                CHECK(mustCapture(next) == (jumpers(next.board, next.currentTurn) != 0));
+            }
+            REQUIRE(history.make(game, list[(ply * 3) % list.size()]));
+        }
+        while (history.unmake(game)) {
+            CHECK(game.capturers[WHITE_TURN] == jumpers(game.board, WHITE_TURN));
+            CHECK(game.capturers[BLACK_TURN] == jumpers(game.board, BLACK_TURN));
+        }
+    }
+}
+
+TEST_CASE("make and unmake") {
+    // 15x22x31x24x15: a man is crowned mid-capture and ends on its own square
+    GameState crown;
+    REQUIRE(parseFen("B:W18,19,26,27,28,30:B3,4,8,10,13,15,20", crown));
+    MoveList crownMoves;
+    generateMoves(crown, crownMoves);
+    int index = findMove("15x22x31x24x15", crownMoves);
+    REQUIRE(index >= 0);
+    Undo crownUndo;
+    GameState crowned = crown;
+    makeMove(crowned, crownMoves[index], crownUndo);
+    CHECK(pieceAt(crowned.board, squareX(14), squareY(14)) == BLACK_KING);
+    unmakeMove(crowned, crownUndo);
+    CHECK(crowned.board == crown.board);
+    CHECK(crowned.hash == crown.hash);
+
+    const char* fens[] = {START_FEN, "W:W9,10,11,18,25,26,K30:B2,3,K20,K24,13,14,22",
+                          "B:W18,19,26,27,28,30:B3,4,8,10,13,15,20", "W:WK1,19,22,23,27:B5,6,K14,16,K31"};
+    for (const char* fen : fens) {
+        GameState game;
+        REQUIRE(parseFen(fen, game));
+        const GameState start = game;
+        UndoStack history;
+        MoveList list;
+        for (int ply = 0; ply < 60; ++ply) {
+            generateMoves(game, list);
+            if (list.empty()) break;
+            const GameState before = game;
+            for (const Move& move : list) {
+                Undo undo;
+                makeMove(game, move, undo);
+                CHECK(game.hash == computeHash(game));
+                unmakeMove(game, undo);
+                CHECK(game.board == before.board);
+                CHECK(game.currentTurn == before.currentTurn);
+                CHECK(game.hash == before.hash);
+            }
+            REQUIRE(history.make(game, list[(ply * 5) % list.size()]));
+        }
+        while (history.unmake(game)) {
+        }
+        CHECK(game.board == start.board);
+        CHECK(game.hash == start.hash);
+        CHECK(game.currentTurn == start.currentTurn);
+    }
+}
+
+TEST_CASE("transposition table") {
+    TranspositionTable tt(1);
+    GameState game;
+    initBoard(game);
+    MoveList list;
+    generateMoves(game, list);
+
+    TTEntry entry;
+    CHECK(tt.probe(game.hash, entry) == false);
+    tt.store(game.hash, -123, 7, BOUND_LOWER, &list[3]);
+    REQUIRE(tt.probe(game.hash, entry));
+    CHECK(entry.score == -123);
+    CHECK(entry.depth == 7);
+    CHECK(entry.bound == BOUND_LOWER);
+    CHECK(matchesEntry(list[3], entry));
+    CHECK(matchesEntry(list[2], entry) == false);
+
+    // A shallower result without a move keeps the stored move
+    tt.store(game.hash, 50, 6, BOUND_EXACT, nullptr);
+    REQUIRE(tt.probe(game.hash, entry));
+    CHECK(entry.score == 50);
+    CHECK(matchesEntry(list[3], entry));
+    CHECK(tt.probe(game.hash ^ 1, entry) == false);
+}
+
+TEST_CASE("tablebase") {
+    GameState game;
+    initBoard(game);
+    CHECK(flipPosition(game.board) == game.board);
+    REQUIRE(parseFen("W:WK1,19,22:B5,K14", game));
+    CHECK(flipPosition(flipPosition(game.board)) == game.board);
+
+    // Index and position are inverse
+    Material material{1, 1, 1, 1};
+    Position board;
+    int valid = 0;
+    for (uint64_t i = 0; i < tablebaseSize(material); i += 101) {
+        if (!tablebasePosition(material, i, board)) continue;
+        ++valid;
+        CHECK(materialOf(board).pieces() == 4);
+        CHECK(tablebaseIndex(board, material) == i);
+    }
+    CHECK(valid > 0);
+
+    // The files go to a temporary directory that is removed at the end
+    char directory[] = "/tmp/checkers-tb-XXXXXX";
+    REQUIRE(mkdtemp(directory) != nullptr);
+    std::vector<std::string> files;
+    REQUIRE(generateTablebases(directory, 3, 2, [&](const std::string& name, uint64_t) { files.push_back(name); }));
+    CHECK(files.size() == 16);
+    Tablebase tablebase;
+    CHECK(tablebase.load(directory, 3) > 0);
+    CHECK(tablebase.pieces() == 3);
+
+    REQUIRE(parseFen("W:W22:B18", game));
+    TBProbe probe = tablebase.probe(game);
+    CHECK(probe.outcome == TB_WIN);
+    CHECK(probe.plies == 1);
+    REQUIRE(parseFen("W:WK29:BK5", game));
+    CHECK(tablebase.probe(game).outcome == TB_DRAW);
+    REQUIRE(parseFen("W:WK29:BK4", game));
+    probe = tablebase.probe(game);
+    CHECK(probe.outcome == TB_LOSS);
+    CHECK(probe.plies == 2);
+    REQUIRE(parseFen("W:W21,22:B1,2", game));
+    CHECK(tablebase.probe(game).outcome == TB_UNKNOWN);
+
+    // Short wins and losses agree with a plain search
+    Searcher searcher;
+    SearchLimits limits;
+    limits.depth = 8;
+    material = Material{1, 0, 0, 2};
+    int checked = 0;
+    for (uint64_t i = 0; i < tablebaseSize(material); i += 37) {
+        if (!tablebasePosition(material, i, game.board)) continue;
+        game.currentTurn = WHITE_TURN;
+        game.hash = computeHash(game);
+        updateCaptureMaps(game);
+        probe = tablebase.probe(game);
+        if (probe.outcome == TB_DRAW || probe.plies > 6) continue;
+        ++checked;
+        int expected = probe.outcome == TB_WIN ? SCORE_WIN - probe.plies : -SCORE_WIN + probe.plies;
+        CHECK(searcher.search(game, limits).score == expected);
+    }
+    CHECK(checked > 0);
+
+    // With the tablebase the search sees the result at once
+    searcher.setTablebase(&tablebase);
+    REQUIRE(parseFen("W:WK29,K32:BK4", game));
+    probe = tablebase.probe(game);
+    REQUIRE(probe.outcome == TB_WIN);
+    CHECK(probe.plies == 3);
+    limits.depth = 2;
+    CHECK(searcher.search(game, limits).score == SCORE_WIN - 3);
+
+    for (const std::string& name : files) std::remove((std::string(directory) + "/" + name).c_str());
+    CHECK(rmdir(directory) == 0);
+}
+
+TEST_CASE("game records") {
+    std::istringstream pdn(
+        "[Event \"test \\\"one\\\"\"]\n"
+        "[Result \"2-0\"]\n"
+        "\n"
+        "1. 22-18 {opening} 11-15 2. 18x11 8x15 (2... 7x15 $1) 3. 24-19! 15x24 4.28x19 2-0\n"
+        "\n"
+        "[Event \"broken\"]\n"
+        "1. 22-17 5-9 2. 17-13 10-14 3. 13x6 *\n"
+        "\n"
+        "[FEN \"B:W18,K27:B11\"]\n"
+        "1... 11-15 18x11 1-1\n");
+    PdnReader reader(pdn);
+    Game game;
+    REQUIRE(reader.next(game));
+    CHECK(game.tag("Event") == "test \"one\"");
+    CHECK(game.moves.size() == 7);
+    CHECK(game.comments[0] == "opening");
+    CHECK(game.result == RESULT_WHITE_WINS);
+    Game first = game;
+
+    REQUIRE(reader.next(game));
+    CHECK(reader.errors() == 1);
+    CHECK(!reader.lastError().empty());
+    CHECK(game.tags.empty());
+    CHECK(game.start.currentTurn == BLACK_TURN);
+    CHECK(game.moves.size() == 2);
+    CHECK(game.result == RESULT_DRAW);
+    Game second = game;
+    CHECK(!reader.next(game));
+
+    // PDN and binary records both reproduce the games
+    for (int binary = 0; binary < 2; ++binary) {
+        std::stringstream stream;
+        PdnWriter pdnWriter(stream);
+        BinaryGameWriter binaryWriter(stream);
+        for (const Game* source : {&first, &second}) {
+            CHECK((binary ? binaryWriter.write(*source) : pdnWriter.write(*source)));
+        }
+        PdnReader pdnReader(stream);
+        BinaryGameReader binaryReader(stream);
+        for (const Game* source : {&first, &second}) {
+            REQUIRE((binary ? binaryReader.next(game) : pdnReader.next(game)));
+            CHECK(game.tags == source->tags);
+            CHECK(toFen(game.start) == toFen(source->start));
+            CHECK(game.result == source->result);
+            REQUIRE(game.moves.size() == source->moves.size());
+            for (size_t i = 0; i < game.moves.size(); ++i) CHECK(sameMove(game.moves[i], source->moves[i]));
+            if (!binary) CHECK(game.comments == source->comments);
+        }
+        CHECK(!(binary ? binaryReader.next(game) : pdnReader.next(game)));
+        CHECK(toFen(game.finalState()) == toFen(second.finalState()));
+    }
+
+    std::istringstream garbage("not a game record");
+    BinaryGameReader binaryReader(garbage);
+    CHECK(!binaryReader.next(game));
+    CHECK(!binaryReader.lastError().empty());
+
+    // Whole archives are read by extension
+    CHECK(isBinaryArchive("games.cgr"));
+    CHECK(!isBinaryArchive("games.pdn"));
+    {
+        std::ofstream file("test.cgr", std::ios::binary | std::ios::trunc);
+        BinaryGameWriter archiveWriter(file);
+        CHECK(archiveWriter.write(first));
+        CHECK(archiveWriter.write(second));
+    }
+    std::ostringstream archiveErrors;
+    size_t archiveMoves = 0;
+    CHECK(readArchive("test.cgr", [&](const Game& read) {
+        archiveMoves += read.moves.size();
+        return true;
+    }, archiveErrors) == 2);
+    CHECK(archiveMoves == first.moves.size() + second.moves.size());
+    CHECK(readArchive("test.cgr", [](const Game&) { return false; }, archiveErrors) == 1);
+    CHECK(archiveErrors.str().empty());
+    std::remove("test.cgr");
+    CHECK(readArchive("test.cgr", [](const Game&) { return true; }, archiveErrors) == -1);
+
+    // A huge game length is rejected before anything is allocated
+    const std::string header("CKGR\x01\x00\x00\x00", 8);
+    std::istringstream hugeLength(header + "\xff\xff\xff\xff\xff\xff\xff\xff\x7f");
+    BinaryGameReader hugeReader(hugeLength);
+    CHECK(!hugeReader.next(game));
+    CHECK(hugeReader.lastError() == "corrupt game length");
+
+    // A king on an empty square: 17 bytes with no tags, a custom start and no moves
+    std::string kingBody("\x00\x00\x01"
+                         "\x01\x00\x00\x00"
+                         "\x00\x00\x00\x80"
+                         "\x02\x00\x00\x00"
+                         "\x00\x00",
+                         17);
+    std::istringstream strayKing(header + "\x11" + kingBody);
+    BinaryGameReader kingReader(strayKing);
+    CHECK(!kingReader.next(game));
+    CHECK(kingReader.lastError() == "corrupt start position");
+    kingBody[11] = '\x01';
+    std::istringstream validKing(header + "\x11" + kingBody);
+    BinaryGameReader validReader(validKing);
+    CHECK(validReader.next(game));
+    CHECK(toFen(game.start) == "W:WK1:B32");
+}
+
+TEST_CASE("opening book") {
+    // A game from the start with the given moves and result
+    auto makeGame = [](std::initializer_list<const char*> moves, GameResult result) {
+        Game game;
+        GameState state = game.start;
+        MoveList list;
+        for (const char* text : moves) {
+            generateMoves(state, list);
+            int found = findMove(text, list);
+            REQUIRE(found >= 0);
+            game.addMove(list[found]);
+            makeMove(state, list[found]);
+        }
+        game.result = result;
+        return game;
+    };
+
+    BookBuilder builder(2);
+    builder.addGame(makeGame({"22-18", "11-15", "18x11"}, RESULT_WHITE_WINS));
+    builder.addGame(makeGame({"22-18", "11-15"}, RESULT_BLACK_WINS));
+    builder.addGame(makeGame({"22-18", "12-16"}, RESULT_DRAW));
+    builder.addGame(makeGame({"21-17", "9-13"}, RESULT_WHITE_WINS));
+    builder.addGame(makeGame({"21-17"}, RESULT_UNKNOWN));
+    CHECK(builder.size() == 5);
+    REQUIRE(builder.write("test.book") == 5);
+
+    OpeningBook book;
+    CHECK_FALSE(book.load("no such book"));
+    REQUIRE(book.load("test.book"));
+    CHECK(book.size() == 5);
+
+    GameState game;
+    initBoard(game);
+    std::vector<BookMove> moves = book.probe(game);
+    REQUIRE(moves.size() == 2);
+    for (const BookMove& move : moves) {
+        if (moveToString(move.move) == "22-18") {
+            CHECK(move.wins == 1);
+            CHECK(move.draws == 1);
+            CHECK(move.losses == 1);
+        }
+        else {
+            CHECK(moveToString(move.move) == "21-17");
+            CHECK(move.games() == 1);
+        }
+    }
+    // One win in one game beats one of each; more games are required with minGames
+    Move chosen;
+    REQUIRE(book.choose(game, chosen));
+    CHECK(moveToString(chosen) == "21-17");
+    REQUIRE(book.choose(game, chosen, 2));
+    CHECK(moveToString(chosen) == "22-18");
+
+    // Black's results after 22-18: a win and a loss with 11-15, a draw with 12-16
+    MoveList list;
+    generateMoves(game, list);
+    makeMove(game, list[findMove("22-18", list)]);
+    moves = book.probe(game);
+    REQUIRE(moves.size() == 2);
+    REQUIRE(book.choose(game, chosen));
+    CHECK(moveToString(chosen) == "11-15");
+    makeMove(game, chosen);
+    CHECK(book.probe(game).empty()); // Beyond the book depth
+    CHECK_FALSE(book.choose(game, chosen));
+
+    // The engine answers from the book without searching
+    std::istringstream in("setoption book test.book\nposition startpos\ngo depth 30\nquit\n");
+    std::ostringstream out;
+    EngineProtocol protocol(out);
+    protocol.run(in);
+    CHECK(out.str().find("bestmove 21-17\n") != std::string::npos);
+    CHECK(out.str().find("info depth") == std::string::npos);
+
+    // Interpolation search finds every entry of a larger book and nothing else
+    BookBuilder large(30);
+    for (int start = 0; start < 400; ++start) {
+        Game random;
+        GameState state = random.start;
+        for (int ply = 0; ply < 30; ++ply) {
+            generateMoves(state, list);
+            if (list.empty()) break;
+            const Move& move = list[(ply * 7 + start * 13 + start / 3) % list.size()];
+            random.addMove(move);
+            makeMove(state, move);
+        }
+        random.result = GameResult(1 + start % 3);
+        large.addGame(random);
+    }
+    REQUIRE(large.write("test.book") > 1000);
+    REQUIRE(book.load("test.book"));
+    int missed = 0;
+    for (size_t i = 0; i < book.size(); ++i) {
+        const BookEntry* first;
+        uint64_t hash = book.data()[i].hash;
+        size_t count = book.find(hash, first);
+        if (count == 0 || first > book.data() + i || first + count <= book.data() + i || first->hash != hash) ++missed;
+        if (i + 1 < book.size() && book.data()[i + 1].hash != hash + 1 && book.find(hash + 1, first) != 0) ++missed;
+    }
+    CHECK(missed == 0);
+
+    // An entry count whose size wraps around 64 bits must not pass for an empty book
+    REQUIRE(BookBuilder().write("test.book") == 0);
+    {
+        std::fstream file("test.book", std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t count = uint64_t(1) << 60;
+        file.seekp(16);
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    CHECK_FALSE(book.load("test.book"));
+    std::remove("test.book");
+}
+
+TEST_CASE("async engine") {
+    AsyncEngine engine;
+    // Waits for the best move of any search, collecting the ids of the reports
+    auto waitBestMove = [&](std::vector<uint64_t>* infos) {
+        EngineEvent event;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (!engine.poll(event)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (event.type == ENGINE_BEST_MOVE) return event;
+            if (infos) infos->push_back(event.searchId);
+        }
+        CHECK(event.type == ENGINE_BEST_MOVE); // Timed out
+        return event;
+    };
+
+    GameState game;
+    initBoard(game);
+    SearchLimits limits;
+    limits.depth = 4;
+    std::vector<uint64_t> infos;
+    uint64_t id = engine.go(game, limits);
+    EngineEvent event = waitBestMove(&infos);
+    CHECK(event.searchId == id);
+    CHECK(event.result.depth == 4);
+    CHECK(infos.size() == 4);
+    for (uint64_t info : infos) CHECK(info == id);
+
+    // A cancelled search never reports a best move
+    SearchLimits unlimited;
+    engine.go(game, unlimited);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    engine.cancel();
+    id = engine.go(game, limits);
+    CHECK(waitBestMove(nullptr).searchId == id);
+
+    // A ponder search that ends early is held back until the expected move and then reused
+    Move expected = event.result.bestMove;
+    uint64_t ponderId = engine.ponder(game, expected, limits);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!engine.poll(event) || event.type == ENGINE_INFO);
+    GameState after = game;
+    makeMove(after, expected);
+    CHECK(engine.opponentMoved(after, expected, limits) == ponderId);
+    event = waitBestMove(nullptr);
+    CHECK(event.searchId == ponderId);
+    CHECK(event.result.depth == 4);
+
+    // An unlimited ponder becomes a timed search on a hit
+    SearchLimits timed;
+    timed.timeMs = 100;
+    ponderId = engine.ponder(game, expected, timed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(!engine.poll(event) || event.type == ENGINE_INFO);
+    auto start = std::chrono::steady_clock::now();
+    CHECK(engine.opponentMoved(after, expected, timed) == ponderId);
+    event = waitBestMove(nullptr);
+    CHECK(event.searchId == ponderId);
+    CHECK(event.result.hasMove);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    // A different move starts a new search of the real position
+    MoveList legal;
+    generateMoves(game, legal);
+    Move other = sameMove(legal[0], expected) ? legal[1] : legal[0];
+    ponderId = engine.ponder(game, expected, unlimited);
+    after = game;
+    makeMove(after, other);
+    id = engine.opponentMoved(after, other, limits);
+    CHECK(id != ponderId);
+    event = waitBestMove(nullptr);
+    CHECK(event.searchId == id);
+    generateMoves(after, legal);
+    CHECK(findMove(moveToString(event.result.bestMove), legal) >= 0);
+}
+
+TEST_CASE("text protocol") {
+    // Lines of the engine output that start with the given word
+    auto linesStarting = [](const std::string& output, const std::string& word) {
+        std::vector<std::string> lines;
+        std::istringstream stream(output);
+        for (std::string line; std::getline(stream, line);) {
+            if (line.compare(0, word.size() + 1, word + " ") == 0 || line == word) lines.push_back(line);
+        }
+        return lines;
+    };
+
+    std::istringstream in(
+        "hello\n"
+        "position fen W:W22:B18\n"
+        "go depth 4\n"
+        "position startpos moves 22-18 11-15\n"
+        "go nodes 5000\n"
+        "position startpos moves 22-18 12-13\n"
+        "analyze depth 3\n"
+        "W:W22:B18\n"
+        "B:W18:B14\n"
+        "not a position\n"
+        "end\n"
+        "frobnicate\n"
+        "isready\n"
+        "quit\n"
+        "go depth 1\n");
+    std::ostringstream out;
+    EngineProtocol protocol(out);
+    protocol.run(in);
+    std::string output = out.str();
+
+    CHECK(linesStarting(output, "hellook").size() == 1);
+    std::vector<std::string> bestMoves = linesStarting(output, "bestmove");
+    REQUIRE(bestMoves.size() == 2);
+    CHECK(bestMoves[0] == "bestmove 22x15");
+    CHECK(bestMoves[1].compare(0, 14, "bestmove 18x11") == 0);
+    std::vector<std::string> info = linesStarting(output, "info depth");
+    REQUIRE(!info.empty());
+    CHECK(info[0].find(" hashfull ") != std::string::npos);
+
+    std::vector<std::string> analysis = linesStarting(output, "analysis");
+    REQUIRE(analysis.size() == 3);
+    CHECK(analysis[0].find("bestmove 22x15 score win 1") != std::string::npos);
+    CHECK(analysis[1].find("bestmove 14x23") != std::string::npos);
+    CHECK(analysis[2].find("error") != std::string::npos);
+    CHECK(linesStarting(output, "analyzedone").size() == 1);
+
+    // One error for the bad move, one for the unknown command; readyok comes last
+    CHECK(linesStarting(output, "info string error:").size() == 2);
+    CHECK(output.compare(output.size() - 8, 8, "readyok\n") == 0);
+
+    // stop ends an unlimited search that was sent before it, even if it has not started yet
+    std::istringstream infinite("position startpos\ngo infinite\nstop\nisready\n");
+    std::ostringstream stopped;
+    EngineProtocol second(stopped);
+    second.run(infinite);
+    CHECK(linesStarting(stopped.str(), "bestmove").size() == 1);
+    CHECK(linesStarting(stopped.str(), "readyok").size() == 1);
+
+    // A bad hash size is an error, not the end of the engine
+    std::istringstream badHash("setoption hash lots\nsetoption hash -3\nsetoption hash 2\nisready\n");
+    std::ostringstream hashOutput;
+    EngineProtocol fourth(hashOutput);
+    fourth.run(badHash);
+    CHECK(linesStarting(hashOutput.str(), "info string error:").size() == 2);
+    CHECK(linesStarting(hashOutput.str(), "readyok").size() == 1);
+
+    // Nobody can send stop after the input ends, so an unlimited search stops by itself
+    std::istringstream unfinished("position startpos\ngo infinite\n");
+    std::ostringstream ended;
+    EngineProtocol third(ended);
+    third.run(unfinished);
+    CHECK(linesStarting(ended.str(), "bestmove").size() == 1);
+}
+
+TEST_CASE("game server") {
+    std::vector<std::pair<int, std::string>> sent;
+    GameServer server([&](int client, const std::string& text) { sent.emplace_back(client, text); });
+    auto lastTo = [&](int client) {
+        for (size_t i = sent.size(); i-- > 0;) {
+            if (sent[i].first == client) return sent[i].second;
+        }
+        return std::string();
+    };
+
+    server.handle(1, "new");
+    REQUIRE(lastTo(1).compare(0, 8, "created ") == 0);
+    std::string id = lastTo(1).substr(8, lastTo(1).size() - 9);
+    server.handle(2, "join " + id);
+    GameState start;
+    initBoard(start);
+    CHECK(lastTo(2) == "joined " + id + " " + toFen(start) + "\n");
+    server.handle(3, "watch " + id);
+    CHECK(server.sessions().active() == 1);
+
+    // Only the side to move may move, and only legally
+    server.handle(2, "move " + id + " 11-15");
+    CHECK(lastTo(2) == "error " + id + " not your move\n");
+    server.handle(1, "move " + id + " 22-26");
+    CHECK(lastTo(1).compare(0, 6, "error ") == 0);
+    sent.clear();
+    server.handle(1, "move " + id + " 22-18");
+    CHECK(sent.size() == 3);
+    for (int client = 1; client <= 3; ++client) CHECK(lastTo(client).compare(0, 15 + id.size(), "update " + id + " 1 22-18") == 0);
+    server.handle(2, "move " + id + " 11-15");
+    CHECK(server.movesValidated() == 2);
+
+    server.handle(1, "bogus");
+    CHECK(lastTo(1) == "error - unknown command bogus\n");
+    server.handle(1, "move 999999 22-18");
+    CHECK(lastTo(1) == "error 999999 no such game\n");
+
+    // The game goes away when both players are gone, and its id is not reused
+    server.handle(1, "leave " + id);
+    CHECK(lastTo(2) == "opponentleft " + id + "\n");
+    server.disconnect(2);
+    CHECK(server.sessions().active() == 0);
+    server.handle(1, "new");
+    CHECK(lastTo(1) != "created " + id + "\n");
+    server.handle(3, "join " + id);
+    CHECK(lastTo(3) == "error " + id + " no such game\n");
+
+    // A game that ends announces the result
+    server.handle(4, "new");
+    std::string second = lastTo(4).substr(8, lastTo(4).size() - 9);
+    server.handle(4, "join " + second);
+    const char* moves[] = {"22-18", "11-15", "18x11", "8x15"};
+    for (const char* move : moves) server.handle(4, "move " + second + " " + move);
+    CHECK(lastTo(4).compare(0, 7 + second.size(), "update " + second) == 0);
+    server.handle(4, "stats");
+    CHECK(lastTo(4).compare(0, 16, "stats sessions 2") == 0);
+
+    SessionPool pool;
+    std::vector<uint64_t> ids;
+    for (uint32_t i = 0; i < SessionPool::BLOCK_SIZE + 10; ++i) ids.push_back(pool.create());
+    CHECK(pool.capacity() == 2 * SessionPool::BLOCK_SIZE);
+    for (uint64_t game : ids) pool.release(game);
+    CHECK(pool.active() == 0);
+    CHECK(pool.find(ids[0]) == nullptr);
+    pool.create();
+    CHECK(pool.capacity() == 2 * SessionPool::BLOCK_SIZE);
 }
@@ -0,0 +1,15 @@
+#include <iostream>
+
+#include "protocol.h"
+
+/**
+ * \brief Движок с текстовым протоколом (см. protocol.h) для внешних программ и пакетного анализа.
+ *
+ * Использование: textengine < команды
+ */
+int main() {
+    std::ios::sync_with_stdio(false);
+    EngineProtocol protocol(std::cout);
+    protocol.run(std::cin);
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "tt.h"
+
+#include <new>
+
+namespace {
+
+const size_t CACHE_LINE = 64;
+const int GENERATION_MASK = 63;
+
+// Раскладка 64-битного слова данных
+const int SCORE_SHIFT = 0;
+const int DEPTH_SHIFT = 16;
+const int BOUND_SHIFT = 24;
+const int GENERATION_SHIFT = 26;
+const int HAS_MOVE_SHIFT = 32;
+const int FROM_SHIFT = 33;
+const int TO_SHIFT = 38;
+const int CAPTURED_SHIFT = 43;
+
+uint64_t pack(int score, int depth, Bound bound, uint8_t generation, bool hasMove, uint8_t from, uint8_t to, uint16_t capturedKey) {
+    uint64_t data = uint64_t(uint16_t(int16_t(score))) << SCORE_SHIFT;
+    data |= uint64_t(depth < 0 ? 0 : depth > 255 ? 255 : depth) << DEPTH_SHIFT;
+    data |= uint64_t(bound) << BOUND_SHIFT;
+    data |= uint64_t(generation & GENERATION_MASK) << GENERATION_SHIFT;
+    if (hasMove) {
+        data |= uint64_t(1) << HAS_MOVE_SHIFT;
+        data |= uint64_t(from) << FROM_SHIFT;
+        data |= uint64_t(to) << TO_SHIFT;
+        data |= uint64_t(capturedKey) << CAPTURED_SHIFT;
+    }
+    return data;
+}
+
+TTEntry unpack(uint64_t data) {
+    TTEntry entry;
+    entry.score = int16_t(uint16_t(data >> SCORE_SHIFT));
+    entry.depth = int((data >> DEPTH_SHIFT) & 0xFF);
+    entry.bound = Bound((data >> BOUND_SHIFT) & 3);
+    entry.hasMove = (data >> HAS_MOVE_SHIFT) & 1;
+    entry.from = uint8_t((data >> FROM_SHIFT) & 31);
+    entry.to = uint8_t((data >> TO_SHIFT) & 31);
+    entry.capturedKey = uint16_t(data >> CAPTURED_SHIFT);
+    return entry;
+}
+
+int generationOf(uint64_t data) {
+    return int((data >> GENERATION_SHIFT) & GENERATION_MASK);
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes) : buckets(nullptr), bucketCount(0), generation(0) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t bytes = (megabytes ? megabytes : 1) * 1024 * 1024;
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= bytes) count *= 2;
+
+    storage.reset(new char[count * sizeof(Bucket) + CACHE_LINE]);
+    uintptr_t raw = reinterpret_cast<uintptr_t>(storage.get());
+    buckets = reinterpret_cast<Bucket*>((raw + CACHE_LINE - 1) & ~uintptr_t(CACHE_LINE - 1));
+    bucketCount = count;
+    for (size_t i = 0; i < bucketCount; ++i) {
+        new (buckets + i) Bucket;
+    }
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; ++i) {
+        for (auto& word : buckets[i].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void TranspositionTable::newSearch() {
+    generation = uint8_t((generation + 1) & GENERATION_MASK);
+}
+
+bool TranspositionTable::probe(uint64_t hash, TTEntry& entry) const {
+    const Bucket* bucket = bucketFor(hash);
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+        uint64_t key = bucket->words[2 * i].load(std::memory_order_relaxed);
+        uint64_t data = bucket->words[2 * i + 1].load(std::memory_order_relaxed);
+        if ((key ^ data) == hash && data) {
+            entry = unpack(data);
+            return entry.bound != BOUND_NONE;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t hash, int score, int depth, Bound bound, const Move* move) {
+    Bucket* bucket = bucketFor(hash);
+    bool hasMove = move != nullptr;
+    uint8_t from = move ? move->from : 0;
+    uint8_t to = move ? move->to : 0;
+    uint16_t capturedKey = move ? foldCaptured(move->captured) : 0;
+
+    int victim = 0;
+    int victimValue = 1 << 30;
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+        uint64_t key = bucket->words[2 * i].load(std::memory_order_relaxed);
+        uint64_t data = bucket->words[2 * i + 1].load(std::memory_order_relaxed);
+        if ((key ^ data) == hash && data) {
+            TTEntry old = unpack(data);
+            // Более глубокую оценку той же позиции из текущего перебора не затираем
+            if (bound != BOUND_EXACT && depth + 2 < old.depth && generationOf(data) == generation) return;
+            if (!hasMove && old.hasMove) {
+                hasMove = true;
+                from = old.from;
+                to = old.to;
+                capturedKey = old.capturedKey;
+            }
+            victim = i;
+            break;
+        }
+        if (!data) {
+            victim = i;
+            victimValue = -(1 << 30);
+            continue;
+        }
+        // Вытесняется самая мелкая и самая старая запись
+        int age = (generation - generationOf(data)) & GENERATION_MASK;
+        int value = int((data >> DEPTH_SHIFT) & 0xFF) - 8 * age;
+        if (value < victimValue) {
+            victimValue = value;
+            victim = i;
+        }
+    }
+
+    uint64_t data = pack(score, depth, bound, generation, hasMove, from, to, capturedKey);
+    bucket->words[2 * victim].store(hash ^ data, std::memory_order_relaxed);
+    bucket->words[2 * victim + 1].store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::prefetch(uint64_t hash) const {
+#if defined(__GNUC__)
+    __builtin_prefetch(bucketFor(hash));
+#else
+    (void)hash;
+#endif
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = bucketCount < 1000 ? bucketCount : 1000;
+    int used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (int j = 0; j < BUCKET_ENTRIES; ++j) {
+            uint64_t data = buckets[i].words[2 * j + 1].load(std::memory_order_relaxed);
+            if (data && generationOf(data) == generation) ++used;
+        }
+    }
+    return int(used * 1000 / (sample * BUCKET_ENTRIES));
+}
@@ -0,0 +1,127 @@
+/**
+ * \file tt.h
+ * \brief Таблица транспозиций, общая для всех потоков перебора.
+ *
+ * Таблица состоит из корзин размером в строку кэша (64 байта) по четыре
+ * записи. Запись — два 64-битных слова: данные и ключ, сложенный с данными
+ * по XOR. Потоки пишут и читают записи без блокировок; запись, которую
+ * одновременно меняли два потока, не пройдет проверку ключа и будет
+ * просто проигнорирована.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "movegen.h"
+
+/// Тип оценки, сохраненной в таблице.
+enum Bound {
+    BOUND_NONE, ///< Нет оценки
+    BOUND_UPPER, ///< Оценка не больше сохраненной
+    BOUND_LOWER, ///< Оценка не меньше сохраненной
+    BOUND_EXACT ///< Точная оценка
+};
+
+/**
+ * \brief Распакованная запись таблицы.
+ */
+struct TTEntry {
+    int score; ///< Оценка (выигрыши отсчитываются от этого узла)
+    int depth; ///< Глубина перебора
+    Bound bound; ///< Тип оценки
+    bool hasMove; ///< Есть ли лучший ход
+    uint8_t from; ///< Начальное поле лучшего хода
+    uint8_t to; ///< Конечное поле лучшего хода
+    uint16_t capturedKey; ///< Свертка маски взятых фигур лучшего хода
+};
+
+/**
+ * \brief Свертка маски взятых фигур для сравнения ходов из таблицы.
+ */
+inline uint16_t foldCaptured(Bitboard captured) {
+    return uint16_t(captured ^ (captured >> 16));
+}
+
+/**
+ * \brief Совпадает ли ход с лучшим ходом из записи.
+ */
+inline bool matchesEntry(const Move& move, const TTEntry& entry) {
+    return entry.hasMove && move.from == entry.from && move.to == entry.to && foldCaptured(move.captured) == entry.capturedKey;
+}
+
+/**
+ * \brief Таблица транспозиций фиксированного размера.
+ */
+class TranspositionTable {
+public:
+    /**
+     * \param megabytes Размер таблицы в мегабайтах (округляется вниз до степени двойки)
+     */
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    /**
+     * \brief Изменить размер таблицы; содержимое теряется.
+     */
+    void resize(size_t megabytes);
+
+    /**
+     * \brief Очистить таблицу.
+     */
+    void clear();
+
+    /**
+     * \brief Начать новый перебор: записи прошлых переборов вытесняются первыми.
+     */
+    void newSearch();
+
+    /**
+     * \brief Найти запись для позиции.
+     * \param hash Хеш позиции
+     * \param entry Найденная запись
+     * \return true, если запись найдена.
+     */
+    bool probe(uint64_t hash, TTEntry& entry) const;
+
+    /**
+     * \brief Сохранить результат перебора узла.
+     * \param hash Хеш позиции
+     * \param score Оценка (выигрыши отсчитываются от этого узла)
+     * \param depth Глубина перебора
+     * \param bound Тип оценки
+     * \param move Лучший ход или nullptr
+     */
+    void store(uint64_t hash, int score, int depth, Bound bound, const Move* move);
+
+    /**
+     * \brief Заранее загрузить корзину позиции в кэш.
+     */
+    void prefetch(uint64_t hash) const;
+
+    /**
+     * \brief Доля занятых записей текущего перебора в тысячных (по первым 1000 корзинам).
+     */
+    int hashfull() const;
+
+    /**
+     * \brief Размер таблицы в байтах.
+     */
+    size_t sizeBytes() const { return bucketCount * sizeof(Bucket); }
+
+private:
+    static const int BUCKET_ENTRIES = 4;
+
+    struct Bucket {
+        std::atomic<uint64_t> words[2 * BUCKET_ENTRIES]; ///< Пары (ключ ^ данные, данные)
+    };
+
+    Bucket* bucketFor(uint64_t hash) const { return buckets + (hash & (bucketCount - 1)); }
+
+    std::unique_ptr<char[]> storage;
+    Bucket* buckets;
+    size_t bucketCount;
+    uint8_t generation;
+};
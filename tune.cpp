@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eval.h"
+#include "gamerecord.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * \brief Позиция выборки: члены оценки и результат партии, 7 байт.
+ *
+ * Члены оценки не зависят от весов, поэтому считаются один раз при
+ * загрузке, а сама позиция больше не нужна.
+ */
+struct Sample {
+    EvalFeatures features;
+    uint8_t result; ///< Очки белых в половинах: 0, 1 или 2
+};
+
+static_assert(sizeof(Sample) == EVAL_TERM_COUNT + 1, "a sample is the feature bytes and the result byte");
+
+/**
+ * \brief Добавить в выборку спокойные позиции партии с известным результатом.
+ *
+ * Позиции, где есть обязательное взятие, пропускаются: их статическая
+ * оценка ничего не говорит об исходе.
+ */
+void addGame(const Game& game, int skipPlies, std::vector<Sample>& samples) {
+    uint8_t result;
+    switch (game.result) {
+    case RESULT_WHITE_WINS:
+        result = 2;
+        break;
+    case RESULT_BLACK_WINS:
+        result = 0;
+        break;
+    case RESULT_DRAW:
+        result = 1;
+        break;
+    default:
+        return;
+    }
+    GameState state = game.start;
+    for (size_t ply = 0;; ++ply) {
+        if (int(ply) >= skipPlies && !mustCapture(state)) samples.push_back(Sample{evalFeatures(state), result});
+        if (ply == game.moves.size()) break;
+        makeMove(state, game.moves[ply]);
+    }
+}
+
+/**
+ * \brief Сумма по выборке: квадрат ошибки и его производные по весам.
+ */
+struct Pass {
+    double error = 0;
+    double gradient[EVAL_TERM_COUNT] = {};
+};
+
+/**
+ * \brief Ошибка предсказания результата по оценке на всей выборке, параллельно.
+ *
+ * Предсказание — sigmoid(k * оценка с точки зрения белых). Каждый поток
+ * суммирует свой отрезок выборки, а суммы складываются в одном и том же
+ * порядке, поэтому результат не зависит от расписания потоков.
+ */
+class Tuner {
+public:
+    Tuner(const std::vector<Sample>& samples, int threads) : samples(samples), threads(threads), evaluated(0) {}
+
+    /**
+     * \brief Средний квадрат ошибки и, если нужно, его градиент по весам.
+     */
+    Pass run(const double* weights, double k, bool gradient) {
+        std::vector<Pass> parts(static_cast<size_t>(threads));
+        std::vector<std::thread> workers;
+        size_t chunk = (samples.size() + size_t(threads) - 1) / size_t(threads);
+        for (int i = 0; i < threads; ++i) {
+            size_t begin = std::min(samples.size(), chunk * size_t(i));
+            size_t end = std::min(samples.size(), begin + chunk);
+            workers.emplace_back([=, &parts] {
+                if (gradient) sum<true>(begin, end, weights, k, parts[size_t(i)]);
+                else sum<false>(begin, end, weights, k, parts[size_t(i)]);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        evaluated += samples.size();
+
+        Pass total;
+        double scale = samples.empty() ? 0 : 1.0 / double(samples.size());
+        for (const Pass& part : parts) {
+            total.error += part.error * scale;
+            for (int t = 0; t < EVAL_TERM_COUNT; ++t) total.gradient[t] += part.gradient[t] * scale;
+        }
+        return total;
+    }
+
+    /**
+     * \brief Средний квадрат ошибки.
+     */
+    double error(const double* weights, double k) { return run(weights, k, false).error; }
+
+    /**
+     * \brief Сколько позиций оценено за все проходы.
+     */
+    uint64_t positions() const { return evaluated; }
+
+private:
+    template <bool withGradient>
+    void sum(size_t begin, size_t end, const double* weights, double k, Pass& pass) const {
+        float w[EVAL_TERM_COUNT];
+        for (int t = 0; t < EVAL_TERM_COUNT; ++t) w[t] = float(weights[t]);
+        double error = 0;
+        double gradient[EVAL_TERM_COUNT] = {};
+        for (size_t i = begin; i < end; ++i) {
+            const Sample& sample = samples[i];
+            float score = 0;
+            for (int t = 0; t < EVAL_TERM_COUNT; ++t) score += float(sample.features.value[t]) * w[t];
+            float predicted = 1.0f / (1.0f + std::exp(-float(k) * score));
+            float difference = predicted - 0.5f * float(sample.result);
+            error += difference * difference;
+            if (withGradient) {
+                // d/dw (p - r)^2 = 2 (p - r) p (1 - p) k f
+                float g = 2.0f * float(k) * difference * predicted * (1.0f - predicted);
+                for (int t = 0; t < EVAL_TERM_COUNT; ++t) gradient[t] += g * float(sample.features.value[t]);
+            }
+        }
+        pass.error = error;
+        for (int t = 0; t < EVAL_TERM_COUNT; ++t) pass.gradient[t] = gradient[t];
+    }
+
+    const std::vector<Sample>& samples;
+    const int threads;
+    uint64_t evaluated;
+};
+
+/**
+ * \brief Подобрать масштаб k при данных весах: минимум ошибки золотым сечением.
+ */
+double fitScale(Tuner& tuner, const double* weights) {
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0, high = 0.05;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double errorA = tuner.error(weights, a), errorB = tuner.error(weights, b);
+    for (int i = 0; i < 40; ++i) {
+        if (errorA < errorB) {
+            high = b;
+            b = a;
+            errorB = errorA;
+            a = high - ratio * (high - low);
+            errorA = tuner.error(weights, a);
+        }
+        else {
+            low = a;
+            a = b;
+            errorA = errorB;
+            b = low + ratio * (high - low);
+            errorB = tuner.error(weights, b);
+        }
+    }
+    return (low + high) / 2;
+}
+
+void toArray(const EvalWeights& weights, double* values) {
+    for (int t = 0; t < EVAL_TERM_COUNT; ++t) values[t] = weights.*EVAL_TERMS[t].weight;
+}
+
+EvalWeights fromArray(const double* values) {
+    EvalWeights weights;
+    for (int t = 0; t < EVAL_TERM_COUNT; ++t) weights.*EVAL_TERMS[t].weight = int(std::lround(values[t]));
+    return weights;
+}
+
+void printWeights(const double* values) {
+    for (int t = 0; t < EVAL_TERM_COUNT; ++t) std::cout << " " << EVAL_TERMS[t].name << " " << values[t];
+}
+
+} // namespace
+
+/**
+ * \brief Подбор весов оценки по результатам партий (метод Тексела).
+ *
+ * Спокойные позиции из архивов партий (самоигры selfplay или чужих)
+ * сводятся к членам оценки и результату — 7 байт на позицию. Затем
+ * подбирается масштаб k, при котором sigmoid(k * оценка) лучше всего
+ * предсказывает результат, и при этом k веса уточняются градиентным
+ * спуском (Adam) по всей выборке; проходы по выборке делятся между
+ * потоками. Вес простой шашки не меняется: он задает единицу оценки.
+ *
+ * Веса пишутся в текстовый файл, который движок читает командой
+ * "setoption evalfile" или настройкой eval= в selfplay.
+ *
+ * Использование: tune [-j потоков] [-n итераций] [-r шаг] [-k масштаб]
+ *   [-s пропустить полуходов] [-w начальные веса] [-o файл весов] архив...
+ */
+int main(int argc, char* argv[]) {
+    int threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    int iterations = 300;
+    double rate = 1.0;
+    double k = 0;
+    int skipPlies = 8;
+    std::string initial;
+    std::string output = "weights.txt";
+    std::vector<std::string> archives;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-j" && hasValue) threads = atoi(argv[++i]);
+        else if (arg == "-n" && hasValue) iterations = atoi(argv[++i]);
+        else if (arg == "-r" && hasValue) rate = atof(argv[++i]);
+        else if (arg == "-k" && hasValue) k = atof(argv[++i]);
+        else if (arg == "-s" && hasValue) skipPlies = atoi(argv[++i]);
+        else if (arg == "-w" && hasValue) initial = argv[++i];
+        else if (arg == "-o" && hasValue) output = argv[++i];
+        else if (!arg.empty() && arg[0] != '-') archives.push_back(arg);
+        else {
+            archives.clear();
+            break;
+        }
+    }
+    if (archives.empty() || threads < 1 || iterations < 0 || rate <= 0 || k < 0 || skipPlies < 0) {
+        std::cerr << "Usage: tune [-j threads] [-n iterations] [-r rate] [-k scale] [-s skip plies] "
+                     "[-w initial weights] [-o output] archive..."
+                  << std::endl;
+        return 1;
+    }
+
+    EvalWeights start;
+    if (!initial.empty()) {
+        std::ifstream in(initial);
+        if (!in || !readEvalWeights(in, start)) {
+            std::cerr << "Cannot read weights from " << initial << std::endl;
+            return 1;
+        }
+    }
+
+    auto loadStart = Clock::now();
+    std::vector<Sample> samples;
+    long games = 0;
+    for (const std::string& path : archives) {
+        long loaded = readArchive(path, [&](const Game& game) {
+            addGame(game, skipPlies, samples);
+            return true;
+        }, std::cerr);
+        if (loaded < 0) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+        games += loaded;
+    }
+    samples.shrink_to_fit();
+    double loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+    std::cout << games << " games, " << samples.size() << " positions in " << std::fixed << std::setprecision(2)
+              << loadSeconds << " s; " << sizeof(Sample) << " bytes per position, "
+              << double(samples.size() * sizeof(Sample)) / (1 << 20) << " MB" << std::defaultfloat << std::endl;
+    if (samples.empty()) {
+        std::cerr << "No positions with a known result" << std::endl;
+        return 1;
+    }
+
+    Tuner tuner(samples, threads);
+    double weights[EVAL_TERM_COUNT];
+    toArray(start, weights);
+    if (k == 0) k = fitScale(tuner, weights);
+    double startError = tuner.error(weights, k);
+    std::cout << "Scale k " << k << ", start error " << std::setprecision(6) << startError << std::endl;
+
+    // Adam: шаг по каждому весу делится на среднеквадратичный градиент,
+    // так что веса разного масштаба сходятся одинаково
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-12;
+    double moment[EVAL_TERM_COUNT] = {}, velocity[EVAL_TERM_COUNT] = {};
+    auto tuneStart = Clock::now();
+    uint64_t before = tuner.positions();
+    double error = startError;
+    for (int iteration = 1; iteration <= iterations; ++iteration) {
+        Pass pass = tuner.run(weights, k, true);
+        error = pass.error;
+        for (int t = 0; t < EVAL_TERM_COUNT; ++t) {
+            if (EVAL_TERMS[t].weight == &EvalWeights::man) continue;
+            moment[t] = beta1 * moment[t] + (1 - beta1) * pass.gradient[t];
+            velocity[t] = beta2 * velocity[t] + (1 - beta2) * pass.gradient[t] * pass.gradient[t];
+            double m = moment[t] / (1 - std::pow(beta1, iteration));
+            double v = velocity[t] / (1 - std::pow(beta2, iteration));
+            weights[t] -= rate * m / (std::sqrt(v) + epsilon);
+        }
+        if (iteration % 50 == 0 || iteration == iterations) {
+            std::cout << "Iteration " << std::setw(5) << iteration << "  error " << error << " ";
+            printWeights(weights);
+            std::cout << std::endl;
+        }
+    }
+    double tuneSeconds = std::chrono::duration<double>(Clock::now() - tuneStart).count();
+    uint64_t evaluated = tuner.positions() - before;
+
+    EvalWeights tuned = fromArray(weights);
+    double rounded[EVAL_TERM_COUNT];
+    toArray(tuned, rounded);
+    double finalError = tuner.error(rounded, k);
+    std::cout << "Error " << startError << " -> " << finalError << " (integer weights)" << std::endl;
+    if (tuneSeconds > 0 && evaluated > 0) {
+        std::cout << std::setprecision(3) << evaluated / tuneSeconds / 1e6 << "M positions/s, "
+                  << evaluated / tuneSeconds / threads / 1e6 << "M positions/s per thread (" << threads << " threads)"
+                  << std::endl;
+    }
+
+    std::ofstream out(output, std::ios::trunc);
+    out << "# tune: " << samples.size() << " positions from " << games << " games, k " << k << ", error "
+        << finalError << "\n";
+    writeEvalWeights(out, tuned);
+    if (!out) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Weights written to " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,588 @@
+/**
+ * \file variant.h
+ * \brief Варианты правил на этапе компиляции: генератор ходов, выполнение хода и perft.
+ *
+ * Правила задаются классом-политикой (RussianRules, EnglishRules,
+ * InternationalRules): размер доски, дальнобойные дамки, взятие простыми
+ * шашками назад, превращение во время взятия и правило большинства.
+ * Все это константы, поэтому каждый вариант компилируется в отдельный
+ * генератор, в котором проверки правил свернуты компилятором. Таблицы
+ * соседей, лучей и рядов превращения строятся constexpr-функциями для
+ * каждого размера доски.
+ *
+ * Поля нумеруются так же, как в board.h: поле (x, y) имеет номер
+ * y * (N / 2) + x / 2, белые ходят вверх. Позиция хранится в 64-битных
+ * масках, поэтому подходят доски до 10x10 включительно (50 полей).
+ *
+ * Движок (поиск, хеш, таблицы эндшпиля) работает с 32-польным ядром
+ * русских шашек из movegen.h; генератор RussianRules совпадает с ним
+ * по perft и служит эталоном для остальных вариантов.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "board.h"
+#include "notation.h"
+
+/// Что происходит с простой шашкой, дошедшей до последнего ряда во время взятия.
+enum CapturePromotion {
+    PROMOTE_AND_CONTINUE, ///< Становится дамкой и продолжает бить как дамка
+    PROMOTE_AND_STOP, ///< Становится дамкой, и ход на этом заканчивается
+    PROMOTE_AT_END ///< Остается шашкой, пока не закончит ход на последнем ряду
+};
+
+/**
+ * \brief Русские шашки: доска 8x8, дальнобойные дамки, шашки бьют назад.
+ */
+struct RussianRules {
+    static constexpr int BOARD_SIZE = 8;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr CapturePromotion CAPTURE_PROMOTION = PROMOTE_AND_CONTINUE;
+    static constexpr bool MAXIMUM_CAPTURE = false; ///< Можно выбрать любое взятие
+    static constexpr Turn FIRST_TURN = WHITE_TURN;
+    static const char* name() { return "russian"; }
+};
+
+/**
+ * \brief Английские шашки (checkers): доска 8x8, дамки ходят на одно поле, начинают черные.
+ */
+struct EnglishRules {
+    static constexpr int BOARD_SIZE = 8;
+    static constexpr bool FLYING_KINGS = false;
+    static constexpr bool MEN_CAPTURE_BACKWARD = false;
+    static constexpr CapturePromotion CAPTURE_PROMOTION = PROMOTE_AND_STOP;
+    static constexpr bool MAXIMUM_CAPTURE = false;
+    static constexpr Turn FIRST_TURN = BLACK_TURN;
+    static const char* name() { return "english"; }
+};
+
+/**
+ * \brief Международные шашки: доска 10x10, бить нужно наибольшее число фигур.
+ */
+struct InternationalRules {
+    static constexpr int BOARD_SIZE = 10;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr CapturePromotion CAPTURE_PROMOTION = PROMOTE_AT_END;
+    static constexpr bool MAXIMUM_CAPTURE = true;
+    static constexpr Turn FIRST_TURN = WHITE_TURN;
+    static const char* name() { return "international"; }
+};
+
+/**
+ * \brief Маски и таблицы доски N x N.
+ *
+ * ray[d][s] — поля от s в направлении d (без самого s), next[d][s] —
+ * соседнее поле в направлении d или -1.
+ */
+template <int N>
+struct GeometryTables {
+    uint64_t all; ///< Все поля
+    uint64_t evenRows; ///< Ряды 0, 2, ... (тёмные поля на нечётных x)
+    uint64_t oddRows; ///< Ряды 1, 3, ...
+    uint64_t firstColumn; ///< Первое тёмное поле каждого ряда
+    uint64_t lastColumn; ///< Последнее тёмное поле каждого ряда
+    uint64_t topRow; ///< Ряд превращения белых
+    uint64_t bottomRow; ///< Ряд превращения черных
+    uint64_t ray[4][N * N / 2];
+    int8_t next[4][N * N / 2];
+};
+
+template <int N>
+constexpr GeometryTables<N> makeGeometry() {
+    GeometryTables<N> g{};
+    const int row = N / 2;
+    const int squares = N * N / 2;
+    g.all = squares == 64 ? ~uint64_t(0) : (uint64_t(1) << squares) - 1;
+    for (int s = 0; s < squares; ++s) {
+        uint64_t m = uint64_t(1) << s;
+        int y = s / row;
+        int x = 2 * (s % row) + (y % 2 == 0 ? 1 : 0);
+        if (y % 2 == 0) g.evenRows |= m;
+        else g.oddRows |= m;
+        if (s % row == 0) g.firstColumn |= m;
+        if (s % row == row - 1) g.lastColumn |= m;
+        if (y == 0) g.topRow |= m;
+        if (y == N - 1) g.bottomRow |= m;
+
+        // Порядок как в Direction: UP_LEFT, UP_RIGHT, DOWN_LEFT, DOWN_RIGHT
+        const int dx[4] = {-1, 1, -1, 1};
+        const int dy[4] = {-1, -1, 1, 1};
+        for (int d = 0; d < 4; ++d) {
+            g.next[d][s] = -1;
+            for (int cx = x + dx[d], cy = y + dy[d]; cx >= 0 && cx < N && cy >= 0 && cy < N;
+                 cx += dx[d], cy += dy[d]) {
+                int t = cy * row + cx / 2;
+                if (g.next[d][s] < 0) g.next[d][s] = int8_t(t);
+                g.ray[d][s] |= uint64_t(1) << t;
+            }
+        }
+    }
+    return g;
+}
+
+/**
+ * \brief Доска N x N: таблицы и сдвиг масок по диагонали.
+ */
+template <int N>
+struct BoardGeometry {
+    static constexpr int SIZE = N;
+    static constexpr int SQUARES = N * N / 2;
+    static constexpr GeometryTables<N> TABLES = makeGeometry<N>();
+
+    /**
+     * \brief Сдвинуть все поля набора на одну клетку по диагонали (как shift() в board.h).
+     */
+    static uint64_t shift(uint64_t b, Direction dir) {
+        const int row = N / 2;
+        switch (dir) {
+        case UP_LEFT:
+            return ((b & TABLES.evenRows) >> row) | ((b & TABLES.oddRows & ~TABLES.firstColumn) >> (row + 1));
+        case UP_RIGHT:
+            return ((b & TABLES.evenRows & ~TABLES.lastColumn) >> (row - 1)) | ((b & TABLES.oddRows) >> row);
+        case DOWN_LEFT:
+            return (((b & TABLES.evenRows) << row) | ((b & TABLES.oddRows & ~TABLES.firstColumn) << (row - 1))) &
+                   TABLES.all;
+        case DOWN_RIGHT:
+            return (((b & TABLES.evenRows & ~TABLES.lastColumn) << (row + 1)) | ((b & TABLES.oddRows) << row)) &
+                   TABLES.all;
+        }
+        return 0;
+    }
+};
+
+template <int N>
+constexpr GeometryTables<N> BoardGeometry<N>::TABLES;
+
+/**
+ * \brief Количество установленных битов 64-битной маски.
+ */
+inline int popCount64(uint64_t b) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(b);
+#else
+    int n = 0;
+    for (; b; b &= b - 1) ++n;
+    return n;
+#endif
+}
+
+/**
+ * \brief Номер младшего установленного бита (b != 0).
+ */
+inline int lowestBit64(uint64_t b) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(b);
+#else
+    int s = 0;
+    while (!(b & 1)) {
+        b >>= 1;
+        ++s;
+    }
+    return s;
+#endif
+}
+
+/**
+ * \brief Номер старшего установленного бита (b != 0).
+ */
+inline int highestBit64(uint64_t b) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(b);
+#else
+    int s = 63;
+    while (!(b >> s)) --s;
+    return s;
+#endif
+}
+
+/**
+ * \brief Ближайшее к началу луча поле из набора (b != 0).
+ *
+ * Номера полей убывают вверх и растут вниз, поэтому ближайшее поле луча
+ * вверх — старший бит, а вниз — младший.
+ */
+inline int nearestOnRay(uint64_t b, Direction dir) {
+    return dir == UP_LEFT || dir == UP_RIGHT ? highestBit64(b) : lowestBit64(b);
+}
+
+/**
+ * \brief Состояние партии варианта Rules.
+ */
+template <class Rules>
+struct VariantState {
+    uint64_t white; ///< Белые шашки и дамки
+    uint64_t black; ///< Черные шашки и дамки
+    uint64_t kings; ///< Дамки обоих цветов
+    Turn currentTurn; ///< Текущая очередь хода
+};
+
+const int MAX_VARIANT_PATH = 20; ///< Наибольшее число прыжков: все фигуры соперника на доске 10x10
+
+/**
+ * \brief Ход любого варианта; поля совпадают по смыслу с Move.
+ */
+struct VariantMove {
+    uint64_t captured; ///< Поля взятых фигур (0 для тихого хода)
+    uint8_t from; ///< Номер начального поля
+    uint8_t to; ///< Номер конечного поля
+    uint8_t pathLength; ///< Число полей приземления (1 для тихого хода)
+    uint8_t promotes; ///< Шашка становится дамкой
+    uint8_t path[MAX_VARIANT_PATH]; ///< Поля приземления по порядку, последнее равно to
+};
+
+/**
+ * \brief Список ходов варианта фиксированной вместимости.
+ */
+struct VariantMoveList {
+    VariantMove moves[MAX_MOVES]; ///< Ходы
+    int count = 0; ///< Число ходов в списке
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    VariantMove& operator[](int i) { return moves[i]; }
+    const VariantMove& operator[](int i) const { return moves[i]; }
+    VariantMove* begin() { return moves; }
+    VariantMove* end() { return moves + count; }
+    const VariantMove* begin() const { return moves; }
+    const VariantMove* end() const { return moves + count; }
+};
+
+/**
+ * \brief Генератор ходов варианта Rules.
+ *
+ * Устроен так же, как генератор в movegen.cpp: взятие ищется рекурсивно,
+ * взятые фигуры снимаются после хода и остаются препятствием до его конца,
+ * цепочки с одинаковым результатом добавляются один раз.
+ */
+template <class Rules>
+class VariantGenerator {
+public:
+    typedef BoardGeometry<Rules::BOARD_SIZE> Geometry;
+
+    static void captures(const VariantState<Rules>& state, VariantMoveList& list) {
+        list.clear();
+        const GeometryTables<Rules::BOARD_SIZE>& g = Geometry::TABLES;
+        bool white = state.currentTurn == WHITE_TURN;
+        uint64_t own = white ? state.white : state.black;
+        Context ctx;
+        ctx.list = &list;
+        ctx.side = state.currentTurn;
+        ctx.enemy = white ? state.black : state.white;
+        ctx.promotionRow = white ? g.topRow : g.bottomRow;
+        uint64_t empty = g.all & ~(state.white | state.black);
+        for (uint64_t rest = jumpers(state.currentTurn, own, ctx.enemy, empty, state.kings); rest; rest &= rest - 1) {
+            int s = lowestBit64(rest);
+            uint64_t from = uint64_t(1) << s;
+            ctx.from = uint8_t(s);
+            ctx.empty = empty | from;
+            addJumps(ctx, s, (state.kings & from) != 0, 0, 0, false);
+        }
+
+        if (Rules::MAXIMUM_CAPTURE && !list.empty()) {
+            int best = 0;
+            for (const VariantMove& move : list) best = std::max(best, popCount64(move.captured));
+            int kept = 0;
+            for (const VariantMove& move : list) {
+                if (popCount64(move.captured) == best) list.moves[kept++] = move;
+            }
+            list.count = kept;
+        }
+    }
+
+    static void moves(const VariantState<Rules>& state, VariantMoveList& list) {
+        captures(state, list);
+        if (!list.empty()) return;
+
+        const GeometryTables<Rules::BOARD_SIZE>& g = Geometry::TABLES;
+        bool white = state.currentTurn == WHITE_TURN;
+        uint64_t own = white ? state.white : state.black;
+        uint64_t empty = g.all & ~(state.white | state.black);
+        uint64_t promotionRow = white ? g.topRow : g.bottomRow;
+        VariantMove move;
+        move.captured = 0;
+        move.pathLength = 1;
+
+        const Direction forward[2] = {white ? UP_LEFT : DOWN_LEFT, white ? UP_RIGHT : DOWN_RIGHT};
+        for (Direction dir : forward) {
+            for (uint64_t targets = Geometry::shift(own & ~state.kings, dir) & empty; targets; targets &= targets - 1) {
+                int to = lowestBit64(targets);
+                move.from = uint8_t(g.next[opposite(dir)][to]);
+                move.to = uint8_t(to);
+                move.path[0] = move.to;
+                move.promotes = ((promotionRow >> to) & 1) != 0;
+                add(list, move);
+            }
+        }
+
+        move.promotes = 0;
+        for (uint64_t kings = own & state.kings; kings; kings &= kings - 1) {
+            int s = lowestBit64(kings);
+            move.from = uint8_t(s);
+            for (int d = 0; d < 4; ++d) {
+                uint64_t reach = Rules::FLYING_KINGS ? rayReach(s, Direction(d), empty)
+                                                     : (g.next[d][s] >= 0 ? (uint64_t(1) << g.next[d][s]) & empty : 0);
+                for (; reach; reach &= reach - 1) {
+                    move.to = uint8_t(lowestBit64(reach));
+                    move.path[0] = move.to;
+                    add(list, move);
+                }
+            }
+        }
+    }
+
+private:
+    struct Context {
+        VariantMoveList* list;
+        Turn side; ///< Бьющая сторона
+        uint64_t enemy; ///< Фигуры соперника
+        uint64_t empty; ///< Свободные поля (начальное поле бьющей фигуры считается свободным)
+        uint64_t promotionRow; ///< Ряд превращения бьющей стороны
+        uint8_t from; ///< Начальное поле бьющей фигуры
+        uint8_t path[MAX_VARIANT_PATH]; ///< Поля приземления текущей цепочки
+    };
+
+    static void add(VariantMoveList& list, const VariantMove& move) {
+        if (move.captured) {
+            for (int i = 0; i < list.count; ++i) {
+                const VariantMove& other = list.moves[i];
+                if (other.from == move.from && other.to == move.to && other.captured == move.captured) return;
+            }
+        }
+        if (list.count < MAX_MOVES) list.moves[list.count++] = move;
+    }
+
+    /**
+     * \brief Свободные поля луча от s до первой фигуры.
+     */
+    static uint64_t rayReach(int s, Direction dir, uint64_t empty) {
+        const GeometryTables<Rules::BOARD_SIZE>& g = Geometry::TABLES;
+        uint64_t ray = g.ray[dir][s];
+        uint64_t blockers = ray & ~empty;
+        if (!blockers) return ray;
+        int stop = nearestOnRay(blockers, dir);
+        return ray & ~(g.ray[dir][stop] | (uint64_t(1) << stop));
+    }
+
+    /**
+     * \brief Может ли фигура бить в направлении dir: шашки английских шашек бьют только вперед.
+     */
+    static bool mayCapture(Turn side, Direction dir, bool king) {
+        if (king || Rules::MEN_CAPTURE_BACKWARD) return true;
+        return side == WHITE_TURN ? dir == UP_LEFT || dir == UP_RIGHT : dir == DOWN_LEFT || dir == DOWN_RIGHT;
+    }
+
+    /**
+     * \brief Фигуры, которые могут бить; проверка сразу для всех фигур, как jumpers() в board.h.
+     */
+    static uint64_t jumpers(Turn side, uint64_t own, uint64_t enemy, uint64_t empty, uint64_t kings) {
+        uint64_t men = own & ~kings;
+        kings &= own;
+        uint64_t result = 0;
+        for (int d = 0; d < 4; ++d) {
+            Direction back = opposite(Direction(d));
+            uint64_t before = Geometry::shift(Geometry::shift(empty, back) & enemy, back);
+            if (mayCapture(side, Direction(d), false)) result |= before & men;
+            result |= before & kings;
+            if (Rules::FLYING_KINGS && kings) {
+                for (uint64_t run = before & empty; run; run &= empty) {
+                    run = Geometry::shift(run, back);
+                    result |= run & kings;
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * \brief Поле фигуры, которую можно бить из s в направлении dir, или -1.
+     */
+    static int victimSquare(const Context& ctx, int s, Direction dir, bool king, uint64_t captured) {
+        const GeometryTables<Rules::BOARD_SIZE>& g = Geometry::TABLES;
+        int victim;
+        if (Rules::FLYING_KINGS && king) {
+            uint64_t blockers = g.ray[dir][s] & ~ctx.empty;
+            if (!blockers) return -1;
+            victim = nearestOnRay(blockers, dir);
+        }
+        else {
+            victim = g.next[dir][s];
+            if (victim < 0) return -1;
+        }
+        if (!((ctx.enemy & ~captured) >> victim & 1)) return -1;
+        int after = g.next[dir][victim];
+        return after >= 0 && (ctx.empty >> after & 1) ? victim : -1;
+    }
+
+    static bool canContinue(const Context& ctx, int s, bool king, uint64_t captured) {
+        for (int d = 0; d < 4; ++d) {
+            if (mayCapture(ctx.side, Direction(d), king) && victimSquare(ctx, s, Direction(d), king, captured) >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void emit(Context& ctx, int s, int length, uint64_t captured, bool promoted) {
+        VariantMove move;
+        move.captured = captured;
+        move.from = ctx.from;
+        move.to = uint8_t(s);
+        move.pathLength = uint8_t(length);
+        move.promotes = promoted;
+        for (int i = 0; i < length; ++i) move.path[i] = ctx.path[i];
+        add(*ctx.list, move);
+    }
+
+    /**
+     * \brief Продолжить цепочку после приземления на поле s.
+     */
+    static void land(Context& ctx, int s, bool king, uint64_t captured, int depth, bool promoted) {
+        ctx.path[depth] = uint8_t(s);
+        bool lastRow = !king && (ctx.promotionRow >> s & 1);
+        if (lastRow && Rules::CAPTURE_PROMOTION == PROMOTE_AND_STOP) {
+            emit(ctx, s, depth + 1, captured, true);
+            return;
+        }
+        if (lastRow && Rules::CAPTURE_PROMOTION == PROMOTE_AND_CONTINUE) {
+            king = true;
+            promoted = true;
+        }
+        if (depth + 1 < MAX_VARIANT_PATH && canContinue(ctx, s, king, captured)) {
+            addJumps(ctx, s, king, captured, depth + 1, promoted);
+        }
+        else {
+            emit(ctx, s, depth + 1, captured, promoted || lastRow);
+        }
+    }
+
+    static void addJumps(Context& ctx, int s, bool king, uint64_t captured, int depth, bool promoted) {
+        const GeometryTables<Rules::BOARD_SIZE>& g = Geometry::TABLES;
+        for (int d = 0; d < 4; ++d) {
+            Direction dir = Direction(d);
+            if (!mayCapture(ctx.side, dir, king)) continue;
+            int victim = victimSquare(ctx, s, dir, king, captured);
+            if (victim < 0) continue;
+            uint64_t after = captured | uint64_t(1) << victim;
+
+            if (!(Rules::FLYING_KINGS && king)) {
+                land(ctx, g.next[dir][victim], king, after, depth, promoted);
+                continue;
+            }
+
+            // Русские правила: если с какого-то поля за взятой фигурой взятие
+            // продолжается, остановиться на другом нельзя. При правиле большинства
+            // это следует из него само, поэтому там перебираются все поля
+            uint64_t landings = rayReach(victim, dir, ctx.empty);
+            uint64_t chosen = landings;
+            if (!Rules::MAXIMUM_CAPTURE) {
+                uint64_t continuing = 0;
+                for (uint64_t rest = landings; rest; rest &= rest - 1) {
+                    int to = lowestBit64(rest);
+                    if (canContinue(ctx, to, true, after)) continuing |= uint64_t(1) << to;
+                }
+                if (continuing) chosen = continuing;
+            }
+            for (; chosen; chosen &= chosen - 1) {
+                land(ctx, lowestBit64(chosen), true, after, depth, promoted);
+            }
+        }
+    }
+};
+
+/**
+ * \brief Начальная позиция варианта: по (N - 2) / 2 ряда шашек у каждой стороны.
+ */
+template <class Rules>
+void initVariant(VariantState<Rules>& state) {
+    const int row = Rules::BOARD_SIZE / 2;
+    const int pieces = (Rules::BOARD_SIZE - 2) / 2 * row;
+    const uint64_t all = BoardGeometry<Rules::BOARD_SIZE>::TABLES.all;
+    state.black = (uint64_t(1) << pieces) - 1;
+    state.white = all & ~(all >> pieces);
+    state.kings = 0;
+    state.currentTurn = Rules::FIRST_TURN;
+}
+
+/**
+ * \brief Сгенерировать все допустимые ходы; взятия, если они есть, вытесняют тихие ходы.
+ */
+template <class Rules>
+void generateMoves(const VariantState<Rules>& state, VariantMoveList& list) {
+    VariantGenerator<Rules>::moves(state, list);
+}
+
+/**
+ * \brief Выполнить ход из списка, сгенерированного для этого состояния, и передать очередь.
+ */
+template <class Rules>
+void makeMove(VariantState<Rules>& state, const VariantMove& move) {
+    uint64_t from = uint64_t(1) << move.from;
+    uint64_t to = uint64_t(1) << move.to;
+    bool white = state.currentTurn == WHITE_TURN;
+    bool king = (state.kings & from) || move.promotes;
+    uint64_t& own = white ? state.white : state.black;
+    uint64_t& enemy = white ? state.black : state.white;
+    own = (own & ~from) | to;
+    enemy &= ~move.captured;
+    state.kings &= ~(from | move.captured);
+    if (king) state.kings |= to;
+    state.currentTurn = white ? BLACK_TURN : WHITE_TURN;
+}
+
+/**
+ * \brief Подсчитать число позиций на глубине depth.
+ */
+template <class Rules>
+uint64_t perft(const VariantState<Rules>& state, int depth) {
+    VariantMoveList list;
+    generateMoves(state, list);
+    if (depth <= 1) return depth == 1 ? list.size() : 1;
+
+    uint64_t nodes = 0;
+    for (const VariantMove& move : list) {
+        VariantState<Rules> next = state;
+        makeMove(next, move);
+        nodes += perft(next, depth - 1);
+    }
+    return nodes;
+}
+
+/**
+ * \brief Разобрать позицию варианта в формате FEN (номера полей до N * N / 2).
+ * \return true, если строка корректна, иначе false (state при этом не меняется).
+ */
+template <class Rules>
+bool parseFen(const std::string& fen, VariantState<Rules>& state) {
+    VariantState<Rules> result;
+    if (!parseFenSquares(fen, BoardGeometry<Rules::BOARD_SIZE>::SQUARES, result.currentTurn, result.white,
+                         result.black, result.kings)) {
+        return false;
+    }
+    state = result;
+    return true;
+}
+
+template <class Rules>
+std::string toFen(const VariantState<Rules>& state) {
+    return fenFromSquares(state.currentTurn, state.white, state.black, state.kings);
+}
+
+/**
+ * \brief Записать ход варианта так же, как moveToString().
+ */
+inline std::string moveToString(const VariantMove& move) {
+    std::string out = std::to_string(move.from + 1);
+    if (!move.captured) return out + "-" + std::to_string(move.to + 1);
+    for (int i = 0; i < move.pathLength; ++i) {
+        out += 'x';
+        out += std::to_string(move.path[i] + 1);
+    }
+    return out;
+}
@@ -0,0 +1,68 @@
+/**
+ * \file zobrist.h
+ * \brief Ключи Зобриста для хеширования позиций.
+ *
+ * Ключи вычисляются при компиляции из фиксированного зерна, поэтому
+ * хеш одной и той же позиции одинаков во всех процессах и запусках.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "board.h"
+
+/**
+ * \brief Таблица случайных ключей: по ключу на фигуру каждого типа на каждом поле и ключ очереди хода.
+ */
+struct ZobristTable {
+    uint64_t pieces[4][squareCount]; ///< Индекс типа: Piece - 1
+    uint64_t blackToMove; ///< Добавляется, когда ходят черные
+};
+
+/**
+ * \brief Генератор SplitMix64.
+ */
+constexpr uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristTable makeZobristTable() {
+    ZobristTable table{};
+    uint64_t seed = 0x436865636B657273ull;
+    for (int p = 0; p < 4; ++p) {
+        for (int s = 0; s < squareCount; ++s) {
+            table.pieces[p][s] = splitMix64(seed);
+        }
+    }
+    table.blackToMove = splitMix64(seed);
+    return table;
+}
+
+constexpr ZobristTable ZOBRIST = makeZobristTable(); ///< Ключи Зобриста
+
+/**
+ * \brief Ключ фигуры piece (не EMPTY) на поле square.
+ */
+inline uint64_t zobristKey(Piece piece, int square) {
+    return ZOBRIST.pieces[piece - 1][square];
+}
+
+/**
+ * \brief Хеш позиции без учета очереди хода.
+ */
+inline uint64_t hashPosition(const Position& pos) {
+    uint64_t hash = 0;
+    for (Bitboard b = pos.white; b; b &= b - 1) {
+        int s = lowestSquare(b);
+        hash ^= zobristKey((pos.kings >> s) & 1 ? WHITE_KING : WHITE, s);
+    }
+    for (Bitboard b = pos.black; b; b &= b - 1) {
+        int s = lowestSquare(b);
+        hash ^= zobristKey((pos.kings >> s) & 1 ? BLACK_KING : BLACK, s);
+    }
+    return hash;
+}